@@ -1,44 +1,118 @@
 #ifndef BPLUSTREE_H
 #define BPLUSTREE_H
 
+#include "PageManager.h"
+#include "BufferPool.h"
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
+#include <functional>
 using namespace std;
 
-// B+ Tree Node for disk-based indexing
+const int DEFAULT_BTREE_FANOUT = 0;  // as many keys as fit in a page
+const int DEFAULT_BTREE_FILL_FACTOR = 90;  // percent of each node a bulk load fills
+
+// B+ tree node stored in one page. After a fixed header comes a directory
+// of entry offsets in key order; entries ([u16 key length][key][u64 value])
+// are packed backward from the end of the page.
+// In a leaf, values are record ids and the link is the next leaf. In an
+// internal node, each value is the child holding keys >= its key, and the
+// link is the child holding keys below the first key.
 class BPlusTreeNode {
 public:
-    bool isLeaf;
-    vector<string> keys;
-    vector<int> values;  // Record offsets/pointers
-    vector<shared_ptr<BPlusTreeNode>> children;
-    shared_ptr<BPlusTreeNode> nextLeaf;  // For range queries
-    
-    BPlusTreeNode(bool leaf = true) : isLeaf(leaf), nextLeaf(nullptr) {}
+    static const int HEADER_SIZE = 24;  // lsn, leaf flag, count, free end, link
+    static const int MAX_KEY_SIZE = 1000;  // keeps at least four entries per page
+
+    typedef vector<pair<string, uint64_t>> Entries;
+
+    explicit BPlusTreeNode(Page& p) : page(p) {}
+
+    void init(bool leaf);
+    bool isLeaf() const;
+    int getCount() const;
+    int getLink() const;
+    void setLink(int pageID);
+
+    string getKey(int index) const;
+    int compareKey(int index, const string& key) const;
+    uint64_t getValue(int index) const;
+    int lowerBound(const string& key) const;  // first entry >= key
+    int upperBound(const string& key) const;  // first entry > key
+
+    bool insertAt(int index, const string& key, uint64_t value);  // false when full
+    void removeAt(int index);
+    Entries getEntries() const;
+    void setEntries(Entries::const_iterator begin, Entries::const_iterator end);
+
+    static int entrySize(const string& key) { return 2 + 2 + static_cast<int>(key.size()) + 8; }
+
+private:
+    Page& page;
+
+    uint16_t getU16(int pos) const;
+    void setU16(int pos, uint16_t value);
+    const char* entryAt(int index, uint16_t& keyLength) const;
 };
 
+// Disk-resident B+ tree over byte-string keys, paged through the shared
+// buffer pool. Keys are unique and compare with memcmp; callers encode
+// values so that byte order is the order they want (see Table::indexKey).
+// Page 0 holds the root, page count, fanout, fill factor and a clean flag:
+// the flag is set only once every page is flushed and is cleared on disk
+// before the first change after that, so a crash leaves an index known to
+// be stale.
+// Deleted keys are removed from their leaf without merging nodes.
 class BPlusTree {
 private:
-    shared_ptr<BPlusTreeNode> root;
-    const int maxKeys = 4;  // Branching factor
-    
-    void splitChild(shared_ptr<BPlusTreeNode> parent, int index);
-    void insertNonFull(shared_ptr<BPlusTreeNode> node, const string& key, int value);
-    void removeFromLeaf(shared_ptr<BPlusTreeNode> node, int index);
-    void removeFromNonLeaf(shared_ptr<BPlusTreeNode> node, int index);
-    void borrowFromPrev(shared_ptr<BPlusTreeNode> node, int index);
-    void borrowFromNext(shared_ptr<BPlusTreeNode> node, int index);
-    void merge(shared_ptr<BPlusTreeNode> node, int index);
-    
+    shared_ptr<BufferPool> pool;
+    int fileId;
+    string indexFile;
+    int rootPage;
+    int pageCount;
+    int fanout;  // most keys per node, 0 when bounded only by page space
+    int fillFactor;  // percent of a node's keys or bytes bulkLoad() fills
+    bool clean;
+
+    void writeMeta();
+    int allocatePage(bool leaf);
+    bool isFull(const BPlusTreeNode& node) const;
+    PinnedPage findLeaf(const string& key, vector<int>* path) const;
+    void insertIntoParent(vector<int>& path, const string& separator, int rightPage);
+    static size_t splitPoint(const BPlusTreeNode::Entries& entries);
+
 public:
-    BPlusTree();
-    
-    void insert(const string& key, int value);
-    int search(const string& key) const;
-    vector<int> rangeSearch(const string& start, const string& end) const;
-    void remove(const string& key);
+    BPlusTree(const string& filename, shared_ptr<BufferPool> bufferPool);
+    ~BPlusTree();
+
+    // New, empty index file
+    bool create(int maxKeys = DEFAULT_BTREE_FANOUT, int fillPercent = DEFAULT_BTREE_FILL_FACTOR);
+    bool open();  // false when the file is missing or not an index
+    bool isClean() const;
+    const string& getFileName() const;
+    int getFanout() const;
+    int getFillFactor() const;
+
+    bool insert(const string& key, RecordID value);  // false on a duplicate key
+    RecordID search(const string& key) const;
+    vector<RecordID> rangeSearch(const string& start, const string& end) const;
+    // Visits keys >= start in order until visit returns false
+    void scanFrom(const string& start, const function<bool(const string&, RecordID)>& visit) const;
+    // Replaces the contents with entries sorted by key, no key repeated.
+    // Leaves and then each level above are packed left to right on
+    // consecutive pages, every node filled to the fill factor. False, with
+    // the tree left as it was, when the entries are out of order or a key
+    // is too long.
+    bool bulkLoad(const vector<pair<string, RecordID>>& entries);
+    bool remove(const string& key);
     bool exists(const string& key) const;
+    void clear();
+
+    bool flush();  // writes every page and marks the index clean
+    // Clears the clean flag on disk; done before every change, and by
+    // callers about to change the rows the index covers without it
+    void markModified();
+    bool moveToFile(const string& filename);
 };
 
 #endif // BPLUSTREE_H
@@ -0,0 +1,137 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Table.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+using namespace std;
+
+const size_t BATCH_SIZE = 1024;
+
+// One column of a batch as a contiguous array of its type
+struct ColumnVector {
+    ColumnType type;
+    vector<int64_t> ints;
+    vector<double> doubles;
+    vector<string> texts;
+
+    bool isNumeric() const { return type != ColumnType::TEXT; }
+    void clear();
+    void append(const Value& value);  // converted to the column's type
+    Value get(size_t row) const;
+};
+
+// About BATCH_SIZE rows stored by column. selection lists the positions of
+// the rows still live, in order; filters shrink it instead of moving data.
+struct Batch {
+    vector<ColumnVector> columns;
+    size_t count;
+    vector<uint32_t> selection;
+
+    Batch() : count(0) {}
+    void reset(const vector<ColumnType>& types);
+};
+
+// Vectorized counterpart of Operator: each next() fills a whole batch
+class BatchOperator {
+public:
+    virtual ~BatchOperator() {}
+    virtual void open() = 0;
+    virtual bool next(Batch& batch) = 0;  // false once no rows are left
+    virtual void close() = 0;
+};
+
+// The listed table columns, read whole pages at a time until a batch is
+// full; from firstPage up to endPage, or to the end of the table when -1
+class BatchScan : public BatchOperator {
+private:
+    shared_ptr<const Table> table;
+    vector<int> columns;
+    vector<ColumnType> types;
+    int pageID;
+    int firstPage;
+    int endPage;
+
+public:
+    BatchScan(shared_ptr<const Table> source, const vector<int>& tableColumns, int first = 1, int end = -1);
+    void open() override;
+    bool next(Batch& batch) override;
+    void close() override;
+};
+
+// A predicate bound to a batch's columns, applied by narrowing the
+// selection. A "column op constant" term runs as a comparison kernel picked
+// once per batch for the column type, constant type and operator; others
+// are tested row by row on the live rows. It keeps scratch space, so each
+// thread filters with its own; the predicate must outlive it.
+class BatchPredicate {
+private:
+    // A term of the predicate, applied to the rows still selected
+    struct Step {
+        const BoundExpression* term;
+        bool simple;
+        BoundCondition condition;  // the term, when simple
+        vector<int> columns;       // read by the term
+    };
+
+    vector<Step> steps;  // the terms of an AND in its order, else the whole predicate
+    vector<uint64_t> mask;  // one bit per batch row
+    Record row;
+
+    void apply(const Step& step, Batch& batch);
+    void applyPerRow(const Step& step, Batch& batch);
+
+public:
+    explicit BatchPredicate(const BoundExpression& predicate);
+    void apply(Batch& batch);
+};
+
+class BatchFilter : public BatchOperator {
+private:
+    unique_ptr<BatchOperator> input;
+    unique_ptr<BoundExpression> predicate;
+    BatchPredicate filter;
+
+public:
+    BatchFilter(unique_ptr<BatchOperator> child, unique_ptr<BoundExpression> bound);
+    void open() override;
+    bool next(Batch& batch) override;
+    void close() override;
+};
+
+const int MORSEL_PAGES = 32;
+const size_t MORSELS_PER_THREAD = 4;
+
+// Morsel-driven scan: the table is cut into morsels of MORSEL_PAGES pages,
+// and the pool's threads each read and filter whole morsels into batches.
+// A wave of a few morsels per thread runs at a time. Its batches come out
+// in page order, the same rows a BatchScan and BatchFilter would give.
+class ParallelScan : public BatchOperator {
+private:
+    shared_ptr<const Table> table;
+    vector<int> columns;
+    unique_ptr<BoundExpression> predicate;  // bound to columns; null keeps every row
+    ThreadPool& pool;
+    int nextPage;
+    vector<vector<Batch>> wave;  // batches of each morsel of the current wave
+    size_t morsel;
+    size_t position;
+
+public:
+    ParallelScan(shared_ptr<const Table> source, const vector<int>& tableColumns,
+                 unique_ptr<BoundExpression> condition, ThreadPool& threads);
+    void open() override;
+    bool next(Batch& batch) override;
+    void close() override;
+
+    ThreadPool& getPool() const { return pool; }
+    size_t maxWaveSize() const { return pool.size() * MORSELS_PER_THREAD; }
+    // Reads the next wave, passing morsel i's filtered batches to
+    // visit(i, thread, batch) on the pool thread that reads it; morsels is
+    // set to the number in the wave. False once the table has been read.
+    bool nextWave(const function<void(size_t, size_t, Batch&)>& visit, size_t& morsels);
+};
+
+#endif // BATCH_H
@@ -0,0 +1,117 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "PageManager.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+using namespace std;
+
+const size_t DEFAULT_BUFFER_POOL_MB = 64;
+
+struct BufferPoolStats {
+    size_t capacityPages;
+    size_t residentPages;
+    size_t pinnedPages;
+    size_t dirtyPages;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t pageWrites;
+};
+
+class BufferPool;
+
+// Pins a page for as long as it is alive
+class PinnedPage {
+private:
+    BufferPool* pool;
+    int fileId;
+    Page* page;
+
+public:
+    PinnedPage() : pool(nullptr), fileId(-1), page(nullptr) {}
+    PinnedPage(BufferPool* p, int file, Page* pg) : pool(p), fileId(file), page(pg) {}
+    PinnedPage(PinnedPage&& other) noexcept : pool(other.pool), fileId(other.fileId), page(other.page) {
+        other.page = nullptr;
+    }
+    PinnedPage& operator=(PinnedPage&& other) noexcept;
+    PinnedPage(const PinnedPage&) = delete;
+    PinnedPage& operator=(const PinnedPage&) = delete;
+    ~PinnedPage();
+
+    Page* operator->() const { return page; }
+    Page& operator*() const { return *page; }
+    explicit operator bool() const { return page != nullptr; }
+};
+
+// Size-bounded page cache shared by every table file. Pages are pinned
+// while in use, tracked dirty, and evicted with the CLOCK algorithm;
+// dirty victims are written back after their log records are flushed.
+class BufferPool {
+private:
+    struct Frame {
+        Page page;
+        int fileId;
+        int pinCount;
+        bool referenced;
+        bool checkpointPending;  // copied by takeDirtyPages, not yet written
+
+        Frame() : page(0), fileId(-1), pinCount(0), referenced(false), checkpointPending(false) {}
+    };
+
+    struct FileInfo {
+        string path;
+        int fd;
+        function<bool(uint64_t)> flushLog;  // makes the WAL durable up to an LSN; false if it cannot
+    };
+
+    vector<unique_ptr<Frame>> frames;
+    unordered_map<uint64_t, size_t> pageTable;  // (fileId, pageID) -> frame index
+    unordered_map<int, FileInfo> files;
+    size_t capacity;    // in pages
+    size_t clockHand;
+    int nextFileId;
+    mutable mutex latch;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t pageWrites;
+
+    static uint64_t pageKey(int fileId, int pageID) {
+        return (static_cast<uint64_t>(fileId) << 32) | static_cast<uint32_t>(pageID);
+    }
+    size_t findVictim();
+    bool writeFrame(Frame& frame);
+    void evictDown();
+
+public:
+    BufferPool(size_t capacityMB = DEFAULT_BUFFER_POOL_MB);
+    ~BufferPool();
+
+    int openFile(const string& path, bool truncate, function<bool(uint64_t)> flushLog = nullptr);
+    void closeFile(int fileId);  // drops the file's pages without writing them
+    void renameFile(int fileId, const string& path);
+    void setLogFlusher(int fileId, function<bool(uint64_t)> flushLog);
+    size_t getFilePageCount(int fileId) const;
+
+    // Pages past the end of the file come back freshly initialized
+    PinnedPage fetchPage(int fileId, int pageID);
+    void unpinPage(int fileId, int pageID);
+
+    // Checkpoint support: copies of resident dirty pages, written later
+    // (possibly on another thread) unless the page was evicted meanwhile
+    vector<pair<int, vector<char>>> takeDirtyPages(int fileId, bool all = false);
+    bool writeSnapshot(int fileId, const vector<pair<int, vector<char>>>& snapshot);
+    bool flushFile(int fileId);
+
+    void setCapacityMB(size_t capacityMB);
+    BufferPoolStats getStats() const;
+};
+
+#endif // BUFFER_POOL_H
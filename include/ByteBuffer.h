@@ -0,0 +1,86 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+// Helpers for the little binary formats used on disk (WAL, pages, headers)
+class ByteWriter {
+private:
+    string& out;
+
+public:
+    ByteWriter(string& buffer) : out(buffer) {}
+
+    template<typename T>
+    void put(T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const string& s) {
+        put<uint32_t>(static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+
+    // LEB128: seven bits per byte, high bit set while more bytes follow
+    void putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+};
+
+// Bounds-checked reader; ok turns false on the first read past the end
+class ByteReader {
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+
+public:
+    bool ok;
+
+    ByteReader(const char* bytes, size_t length) : data(bytes), size(length), pos(0), ok(true) {}
+    ByteReader(const string& buffer) : ByteReader(buffer.data(), buffer.size()) {}
+
+    template<typename T>
+    T get() {
+        T value{};
+        if (!ok || pos + sizeof(T) > size) { ok = false; return value; }
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string getBytes(size_t length) {
+        if (!ok || length > size - pos) { ok = false; return ""; }
+        string s(data + pos, length);
+        pos += length;
+        return s;
+    }
+
+    string getString() {
+        uint32_t length = get<uint32_t>();
+        return getBytes(length);
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!ok || pos >= size) { ok = false; return 0; }
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    bool atEnd() const { return pos == size; }
+};
+
+#endif // BYTE_BUFFER_H
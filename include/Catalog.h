@@ -0,0 +1,52 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "Table.h"
+#include "Value.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+// What is known of a table without opening its files
+struct TableInfo {
+    vector<string> columns;
+    vector<ColumnType> types;
+    string primaryKey;
+    vector<pair<string, string>> indexes;  // (name, column)
+    uint64_t createLSN;
+    uint32_t pages;  // heap file pages when last recorded
+
+    TableInfo() : createLSN(0), pages(0) {}
+};
+
+// The tables of one database, kept in catalog.bin in its directory so that
+// tables are listed and described without reading their files. The table
+// files stay authoritative: an entry is brought up to date whenever its
+// table is loaded or changes shape, and a catalog that is missing or
+// damaged is rebuilt from the files.
+class Catalog {
+private:
+    string fileName;
+    map<string, TableInfo> tables;  // by table name
+
+public:
+    explicit Catalog(const string& directory);
+
+    bool load();  // false when the file is missing or damaged
+    bool save() const;
+
+    bool hasTable(const string& name) const;
+    const TableInfo* find(const string& name) const;
+    const map<string, TableInfo>& getTables() const { return tables; }
+    string findIndex(const string& indexName) const;  // the table holding it, or ""
+    uint64_t getMaxCreateLSN() const;
+
+    // Records the table as it is now; false when that changes nothing
+    bool update(const Table& table);
+    void remove(const string& name);
+    void clear();
+};
+
+#endif // CATALOG_H
@@ -0,0 +1,39 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// A run of whole rows within a block, read a row at a time
+struct CsvChunk {
+    size_t begin;  // advances past each row read
+    size_t end;
+    size_t line;   // line number of the byte at begin, from 1
+};
+
+// Reads a CSV file a block of whole rows at a time, so that the rows of a
+// block can be split up among threads. Fields are separated by commas; a
+// double quote starts or ends a quoted stretch, which may hold commas and
+// line breaks, and "" within it is a quote. Lines end with \n or \r\n, and
+// empty lines are skipped.
+class CsvReader {
+private:
+    ifstream in;
+    string carry;       // the start of a row cut off at the end of the last block
+    size_t lineNumber;  // lines in the blocks read so far
+
+public:
+    explicit CsvReader(const string& fileName);
+    bool isOpen() const { return in.is_open(); }
+
+    // Replaces block with about blockBytes of whole rows, cut into at most
+    // count chunks; false once the file is exhausted
+    bool readBlock(size_t blockBytes, size_t count, string& block, vector<CsvChunk>& chunks);
+    // The fields of the next row of the chunk and the line it starts on;
+    // false at the end of the chunk
+    static bool nextRow(const string& block, CsvChunk& chunk, vector<string>& fields, size_t& rowLine);
+};
+
+#endif // CSV_READER_H
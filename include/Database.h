@@ -2,40 +2,134 @@
 #define DATABASE_H
 
 #include "Table.h"
+#include "Catalog.h"
 #include "Parser.h"
+#include "PreparedStatement.h"
+#include "WriteAheadLog.h"
+#include "Operators.h"
 #include <string>
+#include <ostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <thread>
+#include <mutex>
 using namespace std;
 
 class Database {
 private:
-    unordered_map<string, unordered_map<string, shared_ptr<Table>>> databases;
+    // A table in memory, and when a statement last used it
+    struct OpenTable {
+        shared_ptr<Table> table;
+        uint64_t lastUsed;
+    };
+
+    // The work opening a database took
+    struct OpenReport {
+        size_t tablesLoaded;   // read to rebuild its catalog
+        size_t logRecords;     // redone from its log
+        size_t tablesRebuilt;  // whose indexes were rebuilt
+        double seconds;
+    };
+
+    shared_ptr<BufferPool> bufferPool;
+    // Every database's catalog is read at startup. Its log is opened, and
+    // replayed, when the database is first used; a table is read from its
+    // file when a statement first needs it, and once more than
+    // tableCacheSize are open the least recently used are written out
+    // and closed.
+    unordered_map<string, Catalog> catalogs;
+    unordered_set<string> staleCatalogs;  // rebuilt from the table files on open
+    unordered_map<string, unordered_map<string, OpenTable>> openTables;  // by database, then name
+    size_t tableCacheSize;
+    uint64_t tableClock;
+    double catalogSeconds;  // reading every catalog at startup
+    unordered_map<string, OpenReport> openReports;  // by database
     string currentDatabase;
     string baseDirectory;
 
+    // Write-ahead logging and background checkpointing
+    unordered_map<string, unique_ptr<WriteAheadLog>> wals;
+    WalSyncMode walSyncMode;
+    size_t checkpointThreshold;  // WAL segment size that triggers a checkpoint
+    int indexFanout;             // keys per B+ tree node for new indexes
+    int indexFillFactor;         // percent of each node bulk-built indexes fill
+    bool vectorized;             // scans without an index run on column batches
+    size_t queryMemory;          // bytes one query may hold before its operators spill
+    MemoryBudget memoryBudget;   // bytes all queries may hold together
+    shared_ptr<MemoryTracker> lastQueryMemory;
+    unique_ptr<ThreadPool> workers;  // runs morsels of large scans, table loads and index rebuilds
+    StatementCache statementCache;   // parses of recent statements, by their shape
+    unordered_map<string, shared_ptr<PreparedStatement>> preparedStatements;  // by PREPARE name
+    thread checkpointThread;
+    mutex checkpointMutex;
+    unordered_set<string> failedCheckpoints;
+
     void loadDatabasesFromDisk();
+    bool openDatabase(const string& dbName);
+    shared_ptr<Table> loadTable(const string& dbName, const string& tableName);
+    void addTable(const string& dbName, shared_ptr<Table> table);
+    shared_ptr<Table> findTable(const string& tableName);  // in the current database
+    void evictTables(size_t keep);
     string getDatabaseDirectory(const string& dbName) const;
     string getTableFilePath(const string& dbName, const string& tableName) const;
 
+    void attachLog(const string& dbName, Table& table);
+    void applyLogEntry(const string& dbName, const WalEntry& entry);
+    uint64_t nextLSN() const;
+    bool logChange(WalEntry& entry);
+    bool persistTable(Table& table);
+    void maybeCheckpoint();
+    void checkpoint(const string& dbName, bool background);
+    void waitForCheckpoint();
+    unique_ptr<Operator> planScan(shared_ptr<const Table> table, const vector<string>& names,
+                                  const vector<shared_ptr<Expression>>& terms, int orderColumn = -1);
+    unique_ptr<Operator> planJoin(const ParsedQuery& query, vector<string>& available, vector<ColumnType>& types,
+                                  shared_ptr<MemoryTracker> memory);
+    unique_ptr<Operator> planSelect(const ParsedQuery& query, vector<string>& header);
+    vector<Record> runSelect(const ParsedQuery& query);
+    void runQuery(const ParsedQuery& parsedQuery, ostream& result);
+
 public:
-    Database(const string& baseDir = "databases");
+    Database(const string& baseDir = "databases", WalSyncMode syncMode = WalSyncMode::BATCH);
+    ~Database();
 
     bool createDatabase(const string& databaseName);
     bool useDatabase(const string& databaseName);
     string getCurrentDatabase() const;
 
-    bool createTable(const string& tableName, const vector<string>& columns);
+    bool createTable(const string& tableName, const vector<string>& columns,
+                     const vector<ColumnType>& types, const string& primaryKey = "");
     bool dropTable(const string& tableName);
+    bool createIndex(const string& indexName, const string& tableName, const string& columnName);
+    bool dropIndex(const string& indexName, const string& tableName = "");
     bool insert(const string& tableName, const vector<string>& values);
-    bool updateRecords(const string& tableName, const vector<pair<string, string>>& updates, const Condition& condition);
+    bool insertRows(const string& tableName, const vector<vector<string>>& rows);  // all of them or none
+    // Loads the rows of a CSV file, all of them or none. count receives the
+    // rows loaded, or the line of an invalid row (0 for other failures).
+    // Each block is logged as it is loaded, so a crash part way through
+    // keeps the blocks before it.
+    bool copyFrom(const string& tableName, const string& fileName, bool header, size_t& count);
+    bool updateRecords(const string& tableName, const vector<pair<string, shared_ptr<Expression>>>& updates,
+                       const Condition& condition);
     bool alterTable(const string& tableName, const string& action, const string& columnName, const string& columnType);
     
     vector<Record> select(const string& tableName, const vector<string>& columns,
-                               const Condition* condition = nullptr);
+                               const Condition* condition = nullptr,
+                               const vector<OrderKey>& orderBy = {},
+                               size_t limit = NO_LIMIT, size_t offset = 0);
     bool deleteRecords(const string& tableName, const Condition& condition);
 
     string executeQuery(const string& query);
+    void executeQuery(const string& query, ostream& out);
+
+    // Parses sql, which may have ? placeholders, for running many times
+    // with values bound to them; null when it is not a valid statement
+    shared_ptr<PreparedStatement> prepare(const string& sql);
+    void execute(const PreparedStatement& statement, ostream& out);
+    vector<Record> select(const PreparedStatement& statement);  // empty unless a bound SELECT
+    bool setOption(const string& name, const string& value);
+    string getStats() const;
 
     bool tableExists(const string& tableName) const;
     const vector<string>& getTableColumns(const string& tableName) const;
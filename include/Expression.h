@@ -0,0 +1,117 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "Record.h"
+#include "Value.h"
+#include <string>
+#include <vector>
+#include <memory>
+using namespace std;
+
+// An expression as parsed from a WHERE clause or SET assignment; column
+// names are resolved when it is bound to a row layout
+struct Expression {
+    enum class Kind {
+        COLUMN,      // text is the column name
+        NUMBER,      // text is the literal as written
+        STRING,      // text is the unquoted literal
+        ARITHMETIC,  // text is + - * / or %; two operands
+        COMPARE,     // text is the operator; two operands
+        BETWEEN,     // value, low, high
+        IN,          // value, then the list
+        IS_NULL,     // one operand
+        AND,         // two or more operands
+        OR,          // two or more operands
+        NOT,         // one operand
+        PARAMETER    // text is the number of the ? it stands for
+    };
+
+    Kind kind;
+    string text;
+    bool negated;  // NOT BETWEEN, NOT IN, IS NOT NULL
+    vector<shared_ptr<Expression>> operands;
+
+    Expression(Kind k, const string& t = "") : kind(k), text(t), negated(false) {}
+
+    // "column op value", the shape of a hand-built Condition
+    static shared_ptr<Expression> comparison(const string& column, const string& op, const string& value);
+    // Names of the columns it mentions, in order of appearance
+    void collectColumns(vector<string>& names) const;
+
+    // The terms of a top-level AND (or the expression itself), and back
+    static void splitConjuncts(const shared_ptr<Expression>& expression, vector<shared_ptr<Expression>>& terms);
+    static shared_ptr<Expression> conjunction(const vector<shared_ptr<Expression>>& terms);  // null when empty
+    // The expression with each parameter replaced by its argument; parts
+    // without parameters are shared rather than copied
+    static shared_ptr<Expression> substitute(const shared_ptr<Expression>& expression,
+                                             const vector<shared_ptr<Expression>>& arguments);
+};
+
+struct Condition {
+    string columnName;
+    string op;
+    string value;
+    shared_ptr<Expression> expression;  // set by the parser; else built from the fields above
+
+    shared_ptr<Expression> toExpression() const;
+};
+
+// A condition resolved against a table's schema: the column position, the
+// operator and the constant converted to the column's type where it can be
+struct BoundCondition {
+    enum class Op { EQ, NE, LT, LE, GT, GE, INVALID };
+
+    int column;
+    Op op;
+    Value constant;
+
+    static Op parseOp(const string& op);
+};
+
+// An expression bound to a row layout, built once per statement: columns
+// are ordinals, constants are typed Values, subtrees without columns are
+// folded, and each comparison is a template instance for its operator.
+// NOT is pushed down into the comparisons below it, and the terms of AND
+// and OR are ordered so the cheapest, most decisive run first.
+// There are no NULLs in storage; IS NULL holds for empty text, and so do
+// the results of a division by zero.
+class BoundExpression {
+public:
+    virtual ~BoundExpression() {}
+
+    // The value for a row. The result may refer to scratch, to a constant
+    // or to a value of row, so it is only valid while they are.
+    virtual const Value& evaluate(const Record& row, Value& scratch) const = 0;
+    // Whether a predicate holds for the row; other expressions are true
+    // when they are a nonzero number
+    virtual bool test(const Record& row) const;
+
+    virtual ColumnType type() const = 0;  // the type it is expected to produce
+    virtual bool isConstant() const { return false; }
+    // The "column op constant" form that indexes and batch kernels handle
+    virtual bool asCondition(BoundCondition&) const { return false; }
+    // The terms of an AND (conjunction set) or an OR, in evaluation order
+    virtual bool asJunction(bool&, vector<const BoundExpression*>&) const { return false; }
+    virtual void collectColumns(vector<int>& columns) const = 0;
+
+    // Estimates for ordering the terms of AND and OR: the fraction of rows
+    // a predicate holds for, without statistics, and the relative cost of
+    // evaluating it on one row
+    virtual double selectivity() const { return 0.5; }
+    virtual double cost() const { return 1; }
+
+    // Position of a column name in a row layout, ignoring case. A name
+    // without a table qualifier also matches one "table.name" column of a
+    // joined row. -1 when unknown, -2 when it matches several columns.
+    static int findColumn(const vector<string>& columns, const string& name);
+
+    // Null when a column is unknown or ambiguous, a text column is used in
+    // arithmetic, or the operator is not recognized. Columns marked in
+    // padded may be empty whatever their type, as the right side of a LEFT
+    // JOIN is; comparisons on them fail for an empty value.
+    static unique_ptr<BoundExpression> bind(const Expression& expression, const vector<string>& columns,
+                                            const vector<ColumnType>& types,
+                                            const vector<bool>* padded = nullptr);
+};
+
+#endif // EXPRESSION_H
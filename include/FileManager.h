@@ -11,12 +11,17 @@ public:
     static bool fileExists(const string& filename);
     static bool createDirectory(const string& dirname);
     static vector<string> listFilesInDirectory(const string& dirname);
+    static vector<string> listDirectories(const string& dirname);
 
     // Read/Write operations
     static string readFile(const string& filename);
     static bool writeFile(const string& filename, const string& content);
     static vector<string> readLines(const string& filename);
     static bool writeLines(const string& filename, const vector<string>& lines);
+
+    // Writes to a temporary file, fsyncs it and renames it over filename
+    static bool writeFileAtomic(const string& filename, const string& content);
+    static bool writeLinesAtomic(const string& filename, const vector<string>& lines);
 };
 
 #endif // FILE_MANAGER_H
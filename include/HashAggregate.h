@@ -0,0 +1,93 @@
+#ifndef HASH_AGGREGATE_H
+#define HASH_AGGREGATE_H
+
+#include "Record.h"
+#include "Value.h"
+#include "ThreadPool.h"
+#include "SpillFile.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+struct Batch;
+
+// An aggregate call from a select list or HAVING clause, e.g. sum(score)
+struct Aggregate {
+    enum class Func { COUNT, SUM, AVG, MIN, MAX };
+
+    Func func;
+    string column;  // empty for COUNT(*)
+    string name;    // as written in the query, used to refer to the result
+
+    static bool parseFunc(const string& name, Func& func);
+};
+
+// One-pass GROUP BY. Groups are found through an open-addressing hash table
+// keyed by the typed group value; each group keeps running aggregates.
+class HashAggregate {
+private:
+    struct Accumulator {
+        int64_t count;
+        int64_t intSum;
+        double doubleSum;
+        bool exact;   // intSum is the sum: INT inputs only and no overflow
+        Value extreme;  // MIN / MAX so far
+
+        Accumulator() : count(0), intSum(0), doubleSum(0), exact(true) {}
+    };
+
+    struct Group {
+        Value key;
+        uint64_t hash;
+        vector<Accumulator> accumulators;
+    };
+
+    int groupColumn;
+    vector<Aggregate::Func> funcs;
+    vector<int> inputs;
+    vector<Group> groups;
+    vector<int32_t> slots;  // index into groups, -1 when empty; size is a power of two
+    vector<uint32_t> groupOf;  // group of each live row of the current batch
+    size_t groupBytes;  // memory of groups, roughly
+
+    static uint64_t hashValue(const Value& value);
+    size_t findGroup(const Value& key);
+    size_t findGroup(const Value& key, uint64_t hash);
+    // Radix partition of a group, from hash bits the slots do not use
+    static size_t partitionOf(uint64_t hash, size_t partitions) { return (hash >> 40) % partitions; }
+    void mergeGroup(const Group& source);
+    void grow();
+    Value finalValue(size_t aggregate, const Accumulator& accumulator) const;
+
+public:
+    // groupColumn is -1 for a single group over every row. inputs holds the
+    // input column of each aggregate, -1 for COUNT(*).
+    HashAggregate(int groupColumn, const vector<Aggregate::Func>& funcs, const vector<int>& inputs);
+
+    void add(const Record& record);
+    // Same as add() for each live row of the batch, whose columns are the
+    // ones groupColumn and inputs refer to
+    void addBatch(const Batch& batch);
+    // Folds in the groups of another aggregate with the same shape, as if
+    // its rows had been added here after the ones already seen
+    void merge(const HashAggregate& other);
+    // finish() after merging in aggregates that threads filled separately
+    // (null ones are skipped). Groups are split into radix partitions by
+    // hash, and each partition is merged by one pool task, so no table is
+    // shared.
+    vector<Record> finishWith(const vector<unique_ptr<HashAggregate>>& parts, ThreadPool& pool);
+    // One row per group in group value order: the group value when
+    // grouping, then each aggregate
+    vector<Record> finish() const;
+
+    // Memory the table holds, roughly
+    size_t getMemoryBytes() const { return groupBytes + slots.size() * sizeof(int32_t); }
+    // Writes the running state of every group to the file of its radix
+    // partition and empties the table. Merging the states of a partition
+    // back with mergeState() gives its groups as if nothing had been spilled.
+    void spill(vector<unique_ptr<SpillFile>>& partitions);
+    void mergeState(const Record& state);
+};
+
+#endif // HASH_AGGREGATE_H
@@ -0,0 +1,85 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+using namespace std;
+
+// Bytes all running queries may hold together, so one query cannot take
+// the memory every other one needs
+class MemoryBudget {
+private:
+    atomic<size_t> limit;
+    atomic<size_t> used;
+
+public:
+    explicit MemoryBudget(size_t limitBytes);
+
+    bool reserve(size_t bytes);  // false when the limit would be passed
+    void release(size_t bytes);
+    void setLimit(size_t limitBytes) { limit = limitBytes; }
+    size_t getLimit() const { return limit; }
+    size_t getUsed() const { return used; }
+};
+
+// Memory of one query. Operators that hold rows reserve their bytes here
+// first and spill to files in the spill directory when it refuses, which it
+// does once the query would pass its own limit or the shared budget would
+// run out. Threads of the query may reserve concurrently.
+class MemoryTracker {
+private:
+    size_t limit;
+    MemoryBudget* budget;  // may be null
+    string spillDirectory;
+    atomic<size_t> used;
+    atomic<size_t> peak;
+    atomic<size_t> spills;
+
+public:
+    MemoryTracker(size_t limitBytes, MemoryBudget* shared = nullptr, const string& directory = "");
+    ~MemoryTracker();
+    MemoryTracker(const MemoryTracker&) = delete;
+    MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+    bool reserve(size_t bytes);
+    void release(size_t bytes);
+    void noteSpill() { spills++; }  // an operator moved its state to disk
+
+    size_t getLimit() const { return limit; }
+    size_t getUsed() const { return used; }
+    size_t getPeak() const { return peak; }
+    size_t getSpillCount() const { return spills; }
+    const string& getSpillDirectory() const { return spillDirectory; }
+};
+
+// The bytes one operator holds of its query's tracker, returned when it is
+// released or destroyed. Without a tracker every reservation succeeds.
+class MemoryReservation {
+private:
+    shared_ptr<MemoryTracker> tracker;
+    size_t held;
+
+public:
+    explicit MemoryReservation(shared_ptr<MemoryTracker> memory = nullptr) : tracker(move(memory)), held(0) {}
+    MemoryReservation(MemoryReservation&& other) : tracker(move(other.tracker)), held(other.held) { other.held = 0; }
+    ~MemoryReservation() { release(); }
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+    // Holds at least bytes in total; false, holding what it did before,
+    // when the tracker refuses the difference
+    bool resize(size_t bytes);
+    void release();
+
+    size_t getHeld() const { return held; }
+    // The query's limit, or none without a tracker
+    size_t getLimit() const { return tracker ? tracker->getLimit() : SIZE_MAX; }
+    string getSpillDirectory() const { return tracker ? tracker->getSpillDirectory() : ""; }
+    void noteSpill() {
+        if (tracker) tracker->noteSpill();
+    }
+};
+
+#endif // MEMORY_TRACKER_H
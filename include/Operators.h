@@ -0,0 +1,291 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "Table.h"
+#include "Batch.h"
+#include "RowSort.h"
+#include "HashAggregate.h"
+#include "SpillFile.h"
+#include "MemoryTracker.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+using namespace std;
+
+// Pull-based (Volcano) query operators. open() prepares an operator and its
+// input, each next() hands out one row until it returns false, and close()
+// releases what open() acquired. Rows stream through the tree one at a
+// time; only Sort and GroupBy have to see their whole input first. The
+// operators holding many rows reserve their memory from the query's
+// MemoryTracker and spill to disk when it refuses.
+class Operator {
+public:
+    virtual ~Operator() {}
+    virtual void open() = 0;
+    virtual bool next(Record& row) = 0;
+    virtual void close() = 0;
+};
+
+// Every row of a table, read a page at a time
+class TableScan : public Operator {
+private:
+    shared_ptr<const Table> table;
+    int pageID;
+    vector<Record> page;  // rows of the current page
+    size_t position;
+
+public:
+    explicit TableScan(shared_ptr<const Table> source);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// The live rows of each batch as records of the listed batch columns
+class BatchToRows : public Operator {
+private:
+    unique_ptr<BatchOperator> input;
+    vector<int> columns;
+    Batch batch;
+    size_t position;  // into batch.selection
+
+public:
+    BatchToRows(unique_ptr<BatchOperator> child, const vector<int>& outputColumns);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Rows whose ids an index gives for the condition, rechecked against it
+class IndexScan : public Operator {
+private:
+    shared_ptr<const Table> table;
+    unique_ptr<BoundExpression> predicate;  // rechecked on every candidate row
+    vector<RecordID> rids;
+    size_t position;
+
+public:
+    IndexScan(shared_ptr<const Table> source, unique_ptr<BoundExpression> condition);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Every row of a table in the order of an index on one column
+class IndexOrderScan : public Operator {
+private:
+    shared_ptr<const Table> table;
+    int column;
+    vector<RecordID> rids;
+    size_t position;
+
+public:
+    IndexOrderScan(shared_ptr<const Table> source, int indexedColumn);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+class Filter : public Operator {
+private:
+    unique_ptr<Operator> input;
+    unique_ptr<BoundExpression> predicate;
+
+public:
+    Filter(unique_ptr<Operator> child, unique_ptr<BoundExpression> condition);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Keeps the listed columns, in the listed order
+class Project : public Operator {
+private:
+    unique_ptr<Operator> input;
+    vector<int> columns;
+    Record source;
+
+public:
+    Project(unique_ptr<Operator> child, const vector<int>& outputColumns);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Sorts its input; with a limit only that many rows are kept (TopN).
+// Otherwise input beyond the memory it may reserve is sorted in runs
+// written to spill files, which next() merges through a LoserTree together
+// with the rows still in memory as the last run.
+class Sort : public Operator {
+private:
+    unique_ptr<Operator> input;
+    vector<SortKey> keys;
+    size_t limit;
+    MemoryReservation memory;
+    vector<Record> rows;
+    size_t position;
+    vector<unique_ptr<SpillFile>> runs;  // sorted runs on disk, in input order
+    unique_ptr<LoserTree> merger;        // set while runs are being merged
+
+    size_t runBufferBytes() const;
+    size_t mergeFanIn() const;
+    bool spillRun();
+    unique_ptr<SpillFile> mergeRuns(size_t first, size_t last);
+    void reduceRuns(size_t target);
+    void startMerge();
+    void advanceRun(size_t run);
+
+public:
+    Sort(unique_ptr<Operator> child, const vector<SortKey>& sortKeys, size_t maxRows = NO_LIMIT,
+         shared_ptr<MemoryTracker> tracker = nullptr);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// GROUP BY through HashAggregate, optionally filtered by a HAVING predicate
+// bound to its output rows. The input is either rows or batches. A table
+// outgrowing the memory it may reserve has its group states spilled to
+// radix partitions; each partition is then aggregated on its own and the
+// sorted partitions are merged through a LoserTree.
+class GroupBy : public Operator {
+private:
+    unique_ptr<Operator> input;
+    unique_ptr<BatchOperator> batchInput;
+    unique_ptr<ParallelScan> parallelInput;
+    int groupColumn;
+    vector<Aggregate::Func> funcs;
+    vector<int> inputs;
+    shared_ptr<MemoryTracker> tracker;
+    unique_ptr<BoundExpression> having;
+    vector<Record> groups;
+    size_t position;
+
+    mutex spillLock;  // threads of a parallel scan share the partitions
+    bool canSpill;
+    vector<unique_ptr<SpillFile>> partitions;
+    unique_ptr<LoserTree> merger;
+
+    bool spill(HashAggregate& aggregate);
+    void mergePartitions();
+
+public:
+    GroupBy(unique_ptr<Operator> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+            const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory = nullptr);
+    GroupBy(unique_ptr<BatchOperator> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+            const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory = nullptr);
+    // Each morsel of the scan is aggregated on the thread reading it
+    GroupBy(unique_ptr<ParallelScan> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+            const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory = nullptr);
+    void setHaving(unique_ptr<BoundExpression> predicate);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// What a join matches on. Joined rows are the left row followed by the
+// right row, and the residual is checked on them. A LEFT join also returns
+// each left row nothing matched, followed by rightWidth empty values.
+struct JoinSpec {
+    vector<int> leftKeys;
+    vector<int> rightKeys;  // equal to leftKeys pairwise
+    unique_ptr<BoundExpression> residual;  // the rest of ON; may be null
+    bool leftOuter;
+    size_t rightWidth;
+
+    JoinSpec() : leftOuter(false), rightWidth(0) {}
+};
+
+// Equi-join that builds a hash table on one input (the right one, unless
+// buildLeft is set for an inner join) and streams the other past it. When
+// the build rows outgrow the memory it may reserve, both inputs are split
+// by key hash into spill files and joined one partition pair at a time.
+class HashJoin : public Operator {
+private:
+    unique_ptr<Operator> left;
+    unique_ptr<Operator> right;
+    JoinSpec spec;
+    MemoryReservation memory;
+    bool buildLeft;
+
+    vector<Record> buildRows;
+    unordered_map<string, vector<uint32_t>> buckets;  // key -> build rows
+    vector<unique_ptr<SpillFile>> buildParts;
+    vector<unique_ptr<SpillFile>> probeParts;
+    size_t partition;
+    bool probeOpen;
+
+    Record probeRow;
+    const vector<uint32_t>* matches;
+    size_t matchPosition;
+    bool pending;  // probeRow has not been answered yet
+    bool matched;
+    string key;
+
+    const vector<int>& buildKeys() const { return buildLeft ? spec.leftKeys : spec.rightKeys; }
+    const vector<int>& probeKeys() const { return buildLeft ? spec.rightKeys : spec.leftKeys; }
+    void indexBuildRows();
+    void partitionInputs(unique_ptr<SpillFile> overflow, size_t bytes);
+    void loadPartition();
+    bool nextProbe(Record& row);
+
+public:
+    HashJoin(unique_ptr<Operator> leftInput, unique_ptr<Operator> rightInput, JoinSpec join,
+             shared_ptr<MemoryTracker> tracker, bool buildOnLeft = false);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Equi-join on one key of two inputs that arrive sorted on it, as index
+// order scans do. Each input is read once; only the right rows of the
+// current key are held, in a spill file once they outgrow the memory it
+// may reserve.
+class MergeJoin : public Operator {
+private:
+    unique_ptr<Operator> left;
+    unique_ptr<Operator> right;
+    JoinSpec spec;
+    MemoryReservation memory;
+
+    Record rightRow;
+    bool haveRight;
+    vector<Record> group;  // right rows equal to groupKey
+    unique_ptr<SpillFile> groupOverflow;
+    Value groupKey;
+    bool haveGroup;
+    size_t groupPosition;
+    Record spilled;
+
+    Record leftRow;
+    bool pending;
+    bool matched;
+
+    void fillGroup(const Value& key);
+    const Record* nextInGroup();
+
+public:
+    MergeJoin(unique_ptr<Operator> leftInput, unique_ptr<Operator> rightInput, JoinSpec join,
+              shared_ptr<MemoryTracker> tracker);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+// Skips offset rows, then passes on at most limit rows without pulling more
+class Limit : public Operator {
+private:
+    unique_ptr<Operator> input;
+    size_t limit;
+    size_t offset;
+    size_t produced;
+
+public:
+    Limit(unique_ptr<Operator> child, size_t maxRows, size_t skip);
+    void open() override;
+    bool next(Record& row) override;
+    void close() override;
+};
+
+#endif // OPERATORS_H
@@ -4,33 +4,123 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <functional>
 using namespace std;
 
 const int PAGE_SIZE = 4096;  // 4KB pages like real databases
 
+// Record ids address a slot on a heap page: (pageID << 16) | slot
+typedef int64_t RecordID;
+
+inline RecordID makeRecordID(int pageID, int slot) {
+    return (static_cast<RecordID>(pageID) << 16) | slot;
+}
+inline int recordPage(RecordID rid) { return static_cast<int>(rid >> 16); }
+inline int recordSlot(RecordID rid) { return static_cast<int>(rid & 0xFFFF); }
+
+// Slotted page: a fixed header, a slot directory growing forward from the
+// header and record bytes growing backward from the end of the page.
 class Page {
 public:
+    static const int HEADER_SIZE = 16;  // lsn, slot count, free end, reserved
+                                        // (every page, page 0 included, starts with its lsn)
+    static const int SLOT_SIZE = 4;     // record offset, record length
+    static const int MAX_RECORD_SIZE = PAGE_SIZE - HEADER_SIZE - SLOT_SIZE;
+
     int pageID;
     vector<char> data;
-    int bytesUsed;
-    
-    Page(int id) : pageID(id), data(PAGE_SIZE, 0), bytesUsed(0) {}
-    
-    bool hasSpace(int recordSize) const { return bytesUsed + recordSize <= PAGE_SIZE; }
+    bool dirty;
+
+    Page(int id);
+    void reset(int id);  // reinitializes as an empty page
+
+    static uint64_t readLSN(const char* pageData);
+    uint64_t getLSN() const;
+    void setLSN(uint64_t lsn);
+    int getSlotCount() const;
+    int getFreeSpace() const;  // largest record that still fits, including a new slot
+    bool hasSpace(int recordSize) const { return recordSize <= getFreeSpace(); }
+
+    bool isLive(int slot) const;
+    bool readRecord(int slot, string& out) const;
+    const char* recordData(int slot, int& length) const;
+    int insertRecord(const string& bytes);  // returns the slot, or -1 when full
+    bool insertRecordAt(int slot, const string& bytes);
+    bool updateRecord(int slot, const string& bytes);
+    bool deleteRecord(int slot);
+
+private:
+    uint16_t getU16(int pos) const;
+    void setU16(int pos, uint16_t value);
+    int getFreeEnd() const;
+    int getContiguousFree() const;
+    void compact();
 };
 
+class BufferPool;
+
+// Heap file of slotted pages. Page 0 holds the table metadata; data pages
+// start at 1 and are fetched on demand through the shared buffer pool.
+// A free-space map avoids scanning pages on insert; it learns a page's
+// free space whenever the page is read.
 class PageManager {
+public:
+    static const int MAX_HEADER_SIZE;  // table metadata must fit the header page
+
 private:
-    vector<shared_ptr<Page>> pages;
+    shared_ptr<BufferPool> pool;
+    int fileId;
+    int pageCount;               // including the header page
+    mutable vector<uint16_t> freeSpace;  // free-space map, indexed by page id
     string tableFile;
-    
+    string header;
+
+    int findPageWithSpace(int recordSize) const;
+    void extendTo(int pageID);
+    void touch(Page& page, uint64_t lsn);
+
 public:
-    PageManager(const string& filename);
-    
-    int appendRecord(const vector<string>& record);
-    vector<string> readRecord(int pageID, int offset);
-    void savePages();
-    void loadPages();
+    PageManager(const string& filename, shared_ptr<BufferPool> bufferPool);
+    ~PageManager();
+
+    bool create();     // starts an empty heap file, replacing any existing one
+    bool loadPages();  // opens an existing file; only the header page is read
+
+    const string& getFileName() const;
+    bool moveToFile(const string& filename);
+    void setLogFlusher(function<bool(uint64_t)> flushLog);
+
+    const string& getHeader() const;
+    bool setHeader(const string& data);  // false if it does not fit the header page
+
+    RecordID insertRecord(const string& bytes, uint64_t lsn = 0);
+    // Fills the last page and then new pages at the end, fetching each page
+    // once; rids receives the ids. False at a record too large for a page.
+    bool appendRecords(const vector<string>& records, uint64_t lsn, vector<RecordID>& rids);
+    bool readRecord(RecordID rid, string& out) const;
+    RecordID updateRecord(RecordID rid, const string& bytes, uint64_t lsn = 0);  // may relocate
+    bool deleteRecord(RecordID rid, uint64_t lsn = 0);
+
+    // Redo of logged changes; skipped when the page holds a later LSN. Rows
+    // of one statement share its LSN, so a page stamped with exactly that
+    // LSN gets every row replayed (each redo is a blind write of its slot).
+    void redoInsert(RecordID rid, const string& bytes, uint64_t lsn);
+    void redoUpdate(RecordID rid, const string& bytes, uint64_t lsn);
+    void redoDelete(RecordID rid, uint64_t lsn);
+
+    int getPageCount() const;
+    // Visits every record in page order until visit returns false
+    void scan(const function<bool(RecordID, const char*, int)>& visit) const;
+    // Visits the records of one data page; lets a caller walk the heap a
+    // page at a time without holding a pin between pages
+    void scanPage(int pageID, const function<void(RecordID, const char*, int)>& visit) const;
+
+    // Copies of dirty pages (or all resident pages) for a checkpoint
+    vector<pair<int, vector<char>>> takeDirtyPages(bool all = false);
+    bool writeSnapshot(const vector<pair<int, vector<char>>>& snapshot);
+
+    bool savePages();  // writes every dirty page and syncs the file
 };
 
 #endif // PAGEMANAGER_H
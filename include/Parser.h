@@ -7,38 +7,75 @@
 #include <vector>
 using namespace std;
 
+// [INNER | LEFT [OUTER]] JOIN table [[AS] alias] ON condition
+struct JoinClause {
+    string tableName;
+    string alias;  // "" when the columns are qualified by the table name
+    bool left;     // unmatched rows of the tables before it are kept
+    Condition on;
+
+    JoinClause() : left(false) {}
+};
+
 struct ParsedQuery {
     enum class QueryType {
         CREATE_DATABASE,
         USE_DATABASE,
         CREATE_TABLE,
         DROP_TABLE,
+        CREATE_INDEX,
+        DROP_INDEX,
         INSERT,
+        COPY,
         SELECT,
         DELETE,
         UPDATE,
         ALTER_TABLE,
+        SET_OPTION,
+        SHOW_STATS,
+        PREPARE,
+        EXECUTE,
+        DEALLOCATE,
         INVALID
     };
 
     QueryType type;
     string databaseName;
     string tableName;
+    string indexName;
     vector<string> columns;
-    vector<string> values;
-    vector<Condition> conditions;
-    string orderByColumn;
-    bool orderByDesc;
+    vector<string> columnTypes;  // declared type names, "" when omitted
+    string primaryKeyColumn;
+    vector<vector<string>> values;  // INSERT: one per row
+    vector<int> valueParameters;    // per value of every row, the ? it is or -1; empty when none is
+    string fileName;  // COPY table FROM 'file'
+    bool header;      // the file's first row names the columns
+    string tableAlias;
+    vector<JoinClause> joins;
+    vector<Condition> conditions;  // the WHERE clause, as one boolean expression
+    vector<OrderKey> orderBy;
+    size_t limit;   // NO_LIMIT when absent
+    size_t offset;
     string groupByColumn;
+    vector<Aggregate> aggregates;  // from the select list and HAVING
+    vector<Condition> havingConditions;
     bool selectAll;
     
-    vector<pair<string, string>> updateValues;
+    vector<pair<string, shared_ptr<Expression>>> updateValues;  // SET column = expression
     string alterColumnName;
     string alterColumnType;
     string alterAction; // ADD, DROP, MODIFY
 
+    string optionName;
+    string optionValue;
+
+    size_t parameterCount;  // ? placeholders, numbered in order of appearance
+    string statementName;   // PREPARE, EXECUTE, DEALLOCATE
+    shared_ptr<ParsedQuery> statement;         // PREPARE name AS statement
+    vector<shared_ptr<Expression>> arguments;  // EXECUTE name(literal, ...)
+
     ParsedQuery()
-        : type(QueryType::INVALID), selectAll(false), orderByDesc(false) {}
+        : type(QueryType::INVALID), header(false), limit(NO_LIMIT), offset(0), selectAll(false), parameterCount(0) {}
 };
 
 class Parser {
@@ -56,13 +93,32 @@ private:
     ParsedQuery parseCreateDatabase();
     ParsedQuery parseUseDatabase();
     ParsedQuery parseCreateTable();
+    ParsedQuery parseCreateIndex();
+    ParsedQuery parseDropIndex();
     ParsedQuery parseDropTable();
     ParsedQuery parseInsert();
+    ParsedQuery parseCopy();
     ParsedQuery parseSelect();
     ParsedQuery parseDelete();
     ParsedQuery parseUpdate();
     ParsedQuery parseAlterTable();
-    Condition parseCondition();
+    ParsedQuery parseSetOption();
+    ParsedQuery parseShow();
+    ParsedQuery parsePrepare();
+    ParsedQuery parseExecute();
+    ParsedQuery parseDeallocate();
+    // With aggregates given, calls such as count(*) may appear as columns;
+    // they are added to the list and named as in the select list
+    Condition parseCondition(vector<Aggregate>* aggregates = nullptr);
+    shared_ptr<Expression> parseDisjunction(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parseConjunction(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parseNegation(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parsePredicate(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parseSum(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parseProduct(vector<Aggregate>* aggregates);
+    shared_ptr<Expression> parseOperand(vector<Aggregate>* aggregates);
+    bool parseAggregate(const string& func, Aggregate& aggregate);
+    string parseAlias();
 
 public:
     Parser(const vector<Token>& toks);
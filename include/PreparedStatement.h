@@ -0,0 +1,65 @@
+#ifndef PREPARED_STATEMENT_H
+#define PREPARED_STATEMENT_H
+
+#include "Parser.h"
+#include "Value.h"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// A statement parsed once, with ? placeholders for the values it is run
+// with. Copies share the parse, so values bound to a copy leave the
+// original as it was.
+class PreparedStatement {
+private:
+    shared_ptr<const ParsedQuery> statement;
+    vector<shared_ptr<Expression>> arguments;  // literal per ?, null while unbound
+
+public:
+    explicit PreparedStatement(shared_ptr<const ParsedQuery> parsed);
+
+    ParsedQuery::QueryType getType() const { return statement->type; }
+    size_t getParameterCount() const { return arguments.size(); }
+
+    // Binds the ? numbered index, counting from 0; false when there is none
+    bool bind(size_t index, const Value& value);
+    bool bind(size_t index, const shared_ptr<Expression>& literal);  // a NUMBER or STRING
+    void clearBindings();
+
+    // The statement with the bound values in place of its ?s; false while
+    // one of them is unbound
+    bool instantiate(ParsedQuery& query) const;
+};
+
+// Parses of recent statements keyed by their text with the literals taken
+// out (Tokenizer::normalize), least recently used first to go. A statement
+// that differs from a cached one only in its literals skips tokenizing and
+// parsing: the cached parse, whose literals are ?s, gets its values bound.
+// Only SELECT, INSERT, UPDATE and DELETE are kept.
+class StatementCache {
+private:
+    typedef list<pair<string, PreparedStatement>> Entries;
+
+    size_t capacity;
+    Entries entries;  // most recently used first
+    unordered_map<string, Entries::iterator> index;
+    uint64_t hits;
+    uint64_t misses;
+
+public:
+    explicit StatementCache(size_t maxEntries);
+
+    // Parses sql into query, through the cache where it can
+    void parse(const string& sql, ParsedQuery& query);
+
+    void setCapacity(size_t maxEntries);  // 0 turns the cache off
+    size_t getCapacity() const { return capacity; }
+    size_t size() const { return entries.size(); }
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+};
+
+#endif // PREPARED_STATEMENT_H
@@ -4,27 +4,32 @@
 #include <string>
 #include <vector>
 #include "Utils.h"
+#include "Value.h"
 using namespace std;
 
 // Represents a single row/record in a table
 class Record {
 private:
-    vector<string> values;
+    vector<Value> values;
 
 public:
     Record();
-    Record(const vector<string>& vals);
+    Record(const vector<Value>& vals);
 
     // Getters and setters
-    void addValue(const string& value);
-    const string& getValue(size_t index) const;
-    string& getValue(size_t index);
+    void addValue(const Value& value);
+    const Value& get(size_t index) const;
+    void set(size_t index, const Value& value);
+    string getValue(size_t index) const;  // the value as text
     size_t getSize() const;
 
     // Convert to/from CSV format
     string toCSV() const;
     static Record fromCSV(const string& line);
-    void setValue(int index, const string& newValue);
+
+    // Binary form stored in heap pages
+    string serialize() const;
+    static Record deserialize(const char* data, int length);
 };
 
 #endif // RECORD_H
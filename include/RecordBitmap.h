@@ -0,0 +1,27 @@
+#ifndef RECORDBITMAP_H
+#define RECORDBITMAP_H
+
+#include "PageManager.h"
+#include <map>
+#include <vector>
+using namespace std;
+
+// A set of record ids, one bit per slot grouped by heap page. The
+// candidates of several index lookups are combined with AND and OR a word
+// at a time, and come out in heap order.
+class RecordBitmap {
+private:
+    map<int, vector<uint64_t>> pages;
+
+public:
+    void add(RecordID rid);
+    void add(const vector<RecordID>& rids);
+    void intersectWith(const RecordBitmap& other);
+    void unionWith(const RecordBitmap& other);
+
+    bool empty() const { return pages.empty(); }
+    size_t count() const;
+    void toVector(vector<RecordID>& rids) const;
+};
+
+#endif // RECORDBITMAP_H
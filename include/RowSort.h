@@ -0,0 +1,83 @@
+#ifndef ROW_SORT_H
+#define ROW_SORT_H
+
+#include "Record.h"
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+struct SortKey {
+    int column;
+    bool descending;
+};
+
+// In-memory ORDER BY. Row positions are radix sorted on a 64-bit prefix of
+// the first key that preserves its order (the whole value for numbers, the
+// first eight bytes for text); runs with equal prefixes are then finished
+// by comparing the typed values of every key. Ties keep their input order.
+class RowSort {
+private:
+    static bool prefixKeys(const vector<Record>& rows, const SortKey& key, vector<uint64_t>& prefixes, bool& exact);
+    static void radixSort(vector<uint64_t>& prefixes, vector<uint32_t>& order);
+
+public:
+    static vector<uint32_t> order(const vector<Record>& rows, const vector<SortKey>& keys);
+    static void sort(vector<Record>& rows, const vector<SortKey>& keys);
+    // Negative, zero or positive as a sorts before, with or after b
+    static int compare(const Record& a, const Record& b, const vector<SortKey>& keys);
+};
+
+// Tournament tree of losers for merging k sorted runs. Every inner node
+// keeps the run that lost the match played there and the root the overall
+// winner, so replacing the winner's row replays only its leaf-to-root path:
+// log2(k) comparisons per row. Rows that sort equal come from the lower
+// numbered run first, which keeps a merge of consecutive runs stable.
+class LoserTree {
+private:
+    vector<SortKey> keys;
+    vector<Record> heads;    // current row of each run
+    vector<bool> exhausted;  // runs without a current row
+    vector<size_t> nodes;    // nodes[0] the winner, nodes[1 .. k-1] the losers
+
+    bool beats(size_t a, size_t b) const;
+    size_t play(size_t node);
+
+public:
+    LoserTree(const vector<SortKey>& sortKeys, size_t runs);
+
+    Record& head(size_t run) { return heads[run]; }
+    void setExhausted(size_t run) { exhausted[run] = true; }
+    void build();  // once every run has its first row or is exhausted
+
+    bool empty() const { return heads.empty() || exhausted[nodes[0]]; }
+    size_t winner() const { return nodes[0]; }
+    // After the winner's head was replaced by its run's next row or the run
+    // was marked exhausted
+    void replay();
+};
+
+// ORDER BY ... LIMIT: keeps the first `limit` rows in sort order out of a
+// stream in a max-heap, in O(n log limit) time and O(limit) memory. Rows
+// that sort equal keep their arrival order, as with RowSort.
+class TopN {
+private:
+    struct Entry {
+        Record record;
+        uint64_t sequence;
+    };
+
+    vector<SortKey> keys;
+    size_t limit;
+    uint64_t added;
+    vector<Entry> heap;  // worst row on top
+
+    bool before(const Entry& a, const Entry& b) const;
+
+public:
+    TopN(const vector<SortKey>& sortKeys, size_t maxRows);
+
+    void add(const Record& record);
+    vector<Record> finish();  // the kept rows in order
+};
+
+#endif // ROW_SORT_H
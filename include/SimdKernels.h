@@ -0,0 +1,25 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include "Expression.h"
+#include <string>
+#include <cstdint>
+using namespace std;
+
+// Predicate kernels over contiguous column arrays. Each sets bit i % 64 of
+// mask[i / 64] when values[i] compares true against the constant and clears
+// the rest; mask needs (n + 63) / 64 words. AVX2 or SSE4.2 versions are
+// picked once from CPUID, with plain loops on other CPUs.
+class SimdKernels {
+public:
+    static void compareInts(const int64_t* values, size_t n, BoundCondition::Op op,
+                            int64_t constant, uint64_t* mask);
+    static void compareDoubles(const double* values, size_t n, BoundCondition::Op op,
+                               double constant, uint64_t* mask);
+    // Length check first, so only strings of the right size reach memcmp
+    static void equalTexts(const string* values, size_t n, const string& constant, uint64_t* mask);
+
+    static const char* instructionSet();  // "avx2", "sse4.2" or "scalar"
+};
+
+#endif // SIMD_KERNELS_H
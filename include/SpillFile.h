@@ -0,0 +1,43 @@
+#ifndef SPILLFILE_H
+#define SPILLFILE_H
+
+#include "Record.h"
+#include <cstdio>
+#include <string>
+#include <memory>
+using namespace std;
+
+// A temporary file of rows for operators whose state outgrows memory. It is
+// written once, then read back from the start as often as needed, and
+// removed when closed. Given a directory, the file is created there under a
+// name removeLeftovers() recognizes, so files left by a crash can be found;
+// otherwise it is an anonymous tmpfile(). A large bufferBytes makes reads
+// and writes reach the disk in pieces of that size rather than stdio's few KB.
+class SpillFile {
+private:
+    FILE* file;
+    string path;
+    unique_ptr<char[]> ioBuffer;
+    size_t rows;
+    size_t bytes;
+    string buffer;
+
+public:
+    explicit SpillFile(const string& directory = "", size_t bufferBytes = 0);
+    ~SpillFile();
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+    bool write(const Record& row);  // false when the file cannot be written
+    void rewind();                  // back to the first row, for reading
+    bool read(Record& row);         // false after the last row
+
+    size_t getRowCount() const { return rows; }
+    size_t getByteCount() const { return bytes; }
+
+    // Deletes the spill files a previous run left in directory
+    static void removeLeftovers(const string& directory);
+};
+
+#endif // SPILLFILE_H
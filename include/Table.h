@@ -2,57 +2,182 @@
 #define TABLE_H
 
 #include "Record.h"
+#include "Expression.h"
 #include "Utils.h"
 #include "BPlusTree.h"
+#include "PageManager.h"
+#include "BufferPool.h"
+#include "HashAggregate.h"
+#include "RowSort.h"
+#include "RecordBitmap.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <functional>
 using namespace std;
 
-struct Condition {
-    string columnName;
-    string op;
-    string value;
+const size_t NO_LIMIT = SIZE_MAX;
+
+struct OrderKey {
+    string column;
+    bool descending;
+};
+
+// Non-unique index on one column. Tree keys are the column's index key
+// followed by the big-endian record id, which keeps duplicates distinct.
+struct SecondaryIndex {
+    string name;
+    string column;
+    unique_ptr<BPlusTree> tree;
 };
 
 class Table {
 private:
     string tableName;
     vector<string> columns;
-    vector<Record> rows;
-    unique_ptr<BPlusTree> primaryIndex;
+    vector<ColumnType> columnTypes;
+    shared_ptr<BufferPool> bufferPool;
+    unique_ptr<PageManager> heap;  // slotted-page heap file holding the rows
+    unique_ptr<BPlusTree> primaryIndex;  // null without a primary key
     string primaryKeyColumn;
+    vector<SecondaryIndex> secondaryIndexes;
+    uint64_t createLSN;  // WAL entries at or before it predate this table file
+    bool indexesStale;   // index files no longer match the heap
+    // Per index, the primary one first: the keys of rows a bulk load has
+    // appended but not yet indexed
+    vector<vector<pair<string, RecordID>>> bulkKeys;
+
+    // Index keys compare bytewise in the order of the values they encode
+    static string indexKey(const Value& value);
+    static string secondaryKey(const Value& value, RecordID rid);
+    static void appendRecordID(string& key, RecordID rid);  // big-endian, as secondary keys end
+    string primaryKeyOf(const Record& record) const;
+    const Value& columnValue(const Record& record, const string& column) const;
+    bool indexKeysFit(const Record& record) const;
+    void indexRow(RecordID rid, const Record& record);
+    void unindexRow(RecordID rid, const Record& record);
+    static void addSortedKeys(BPlusTree& tree, vector<pair<string, RecordID>>& keys);
+    const BPlusTree* indexFor(const BoundCondition& condition, bool& unique) const;
+    const BPlusTree* indexOn(int column, bool& unique) const;
+    bool indexCandidates(const BoundExpression& predicate, RecordBitmap& candidates) const;
+
+    string serializeHeader() const;
+    bool deserializeHeader(const string& data);
+    static Table* importLegacyFile(const string& filename, const string& name,
+                                   shared_ptr<BufferPool> pool);
 
-    int getColumnIndex(const string& columnName) const;
-    double toNumber(const string& val) const;
+    Table(const string& name, shared_ptr<BufferPool> pool, unique_ptr<PageManager> existingHeap);
 
 public:
+    // The file of an index on the table in tableFile
+    static string indexFileFor(const string& tableFile, const string& indexName);
+
+    // Creates a new, empty table file
     Table(const string& name, 
           const vector<string>& cols, 
-          const string& primaryKey = "");
+          const vector<ColumnType>& types,
+          const string& filename,
+          shared_ptr<BufferPool> pool,
+          const string& primaryKey = "",
+          int indexFanout = DEFAULT_BTREE_FANOUT,
+          int indexFillFactor = DEFAULT_BTREE_FILL_FACTOR);
 
     // Getters
     const string& getTableName() const;
     const vector<string>& getColumns() const;
+    const vector<ColumnType>& getColumnTypes() const;
+    int getColumnIndex(const string& columnName) const;  // -1 when unknown
+    const string& getFileName() const;
+    const string& getPrimaryKeyColumn() const;
+
+    // Secondary indexes; definitions live in the table header
+    bool createIndex(const string& name, const string& column, int fanout = DEFAULT_BTREE_FANOUT,
+                     int fillFactor = DEFAULT_BTREE_FILL_FACTOR);
+    bool dropIndex(const string& name);
+    bool hasIndex(const string& name) const;
+    vector<pair<string, string>> getIndexes() const;  // (name, column)
+
+    // Converts text values to a row of the column types; false when a
+    // value is not valid for its column
+    bool makeRecord(const vector<string>& values, Record& record) const;
+
+    // Row access by record id
+    void scan(const function<void(RecordID, const Record&)>& visit) const;
+    void scanWhile(const function<bool(RecordID, const Record&)>& visit) const;  // until visit returns false
+    int getPageCount() const;
+    void scanPage(int pageID, const function<void(RecordID, const Record&)>& visit) const;
+    bool readRow(RecordID rid, Record& record) const;
 
-    const vector<Record>& getRows() const;  // const getter
-    vector<Record>& getRows();              // non-const getter
+    // Operations; lsn stamps the touched pages for write-ahead logging
+    RecordID insertRow(const Record& record, uint64_t lsn = 0);
+    // The rows of one statement; none is written unless each one fits and
+    // their primary keys are new and distinct
+    bool insertRows(const vector<Record>& records, uint64_t lsn, vector<RecordID>& rids);
+    RecordID updateRow(RecordID rid, const Record& record, uint64_t lsn = 0);
+    bool deleteRow(RecordID rid, uint64_t lsn = 0);
+    vector<pair<RecordID, Record>> deleteWhere(const BoundExpression& predicate, uint64_t lsn = 0);  // the rows deleted
+    // Stop once limit rows have been found
+    vector<pair<RecordID, Record>> findWhere(const BoundExpression& predicate, size_t limit = NO_LIMIT) const;
+    bool violatesPrimaryKey(const vector<pair<RecordID, Record>>& updated) const;
+    bool rowFits(const Record& record) const;  // on a page, with every index key
 
-    // Operations
-    void insertRow(const Record& record);
-    void deleteWhere(const Condition& condition);
-    vector<Record> selectWhere(const Condition& condition) const;
-    vector<Record> selectAll() const;
+    // The condition bound to this table's columns; null when it names an
+    // unknown column or cannot be evaluated
+    unique_ptr<BoundExpression> bindCondition(const Condition& condition) const;
+    // Candidate record ids for a condition from an index on its column.
+    // Callers recheck the condition; false when no index applies.
+    bool canUseIndex(const BoundCondition& condition) const;
+    bool indexLookup(const BoundCondition& condition, vector<RecordID>& rids) const;
+    // The same for a whole predicate: an AND intersects the candidates of
+    // its indexed terms, an OR unites them when every term is indexed
+    bool canUseIndex(const BoundExpression& predicate) const;
+    bool indexLookup(const BoundExpression& predicate, vector<RecordID>& rids) const;
+    // Every record id in the order of an index on the column, for inputs
+    // that must arrive sorted; false without such an index
+    bool hasIndexOn(int column) const;
+    bool indexOrder(int column, vector<RecordID>& rids) const;
 
-    vector<Record> selectOrderBy(const string& columnName, 
-                                      bool descending = false) const;
+    // Bulk loading. prepareRow() serializes a row and works out its index
+    // keys (false when one is too long); it may run on any thread.
+    // appendRows() puts prepared rows on pages at the end of the heap and
+    // leaves the indexes alone; finishBulkLoad() then adds the keys of all
+    // rows appended, sorted, or adds none and fails when a primary key
+    // repeats. abortBulkLoad() takes the appended rows out again.
+    bool prepareRow(const Record& record, string& bytes, vector<string>& keys) const;
+    bool appendRows(const vector<string>& rows, const vector<string>& keys, uint64_t lsn, vector<RecordID>& rids);
+    bool finishBulkLoad();
+    void abortBulkLoad(const vector<RecordID>& rids, uint64_t lsn);
 
-    vector<Record> selectGroupBy(const string& columnName) const;
+    // Redo of logged changes during recovery
+    void redoInsert(RecordID rid, const Record& record, uint64_t lsn);
+    void redoUpdate(RecordID rid, RecordID movedTo, const Record& record, uint64_t lsn);
+    void redoDelete(RecordID rid, uint64_t lsn);
+    // Takes back a change of a statement that could not be completed or
+    // logged, putting the row back at its record id. Changes are taken
+    // back in the reverse of the order they were made.
+    void undoUpdate(RecordID rid, RecordID movedTo, const Record& old, uint64_t lsn);
+    void undoDelete(RecordID rid, const Record& old, uint64_t lsn);
+    void rebuildIndexes();
+    void recoverIndexes();  // rebuilds indexes left stale by a crash or by redo
+    bool hasStaleIndexes() const { return indexesStale; }
+    bool flushIndexes();
+    void markIndexesModified();  // clears the clean flag of every index on disk
+    vector<string> getIndexFiles() const;
 
-    bool evaluateCondition(const Record& record, const Condition& condition) const;
+    // Write-ahead log bookkeeping
+    uint64_t getCreateLSN() const;
+    void setCreateLSN(uint64_t lsn);
+    vector<pair<int, vector<char>>> takeDirtyPages(bool all = false);
+    bool writeSnapshot(const vector<pair<int, vector<char>>>& snapshot);
+    void setLogFlusher(function<bool(uint64_t)> flushLog);
 
-    bool saveToFile(const string& filename) const;
-    static Table* loadFromFile(const string& filename);
+    bool headerFits() const;  // whether the metadata fits the table's header page
+    bool saveToFile();  // writes every dirty page of the table and its indexes
+    bool moveToFile(const string& filename);
+    static Table* loadFromFile(const string& filename, shared_ptr<BufferPool> pool);
+    // Deletes the files of table rebuilds a previous run left in directory
+    static void removeLeftovers(const string& directory);
 };
 
 #endif // TABLE_H
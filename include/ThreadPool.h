@@ -0,0 +1,47 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+using namespace std;
+
+// Fixed set of worker threads for running one piece of work in parallel.
+// Every thread has its own task deque: it takes its newest task first and,
+// once that is empty, steals the oldest task of another thread. The thread
+// calling run() takes part as thread 0 until all of its tasks are done.
+class ThreadPool {
+private:
+    struct Queue {
+        mutex lock;
+        deque<function<void(size_t)>> tasks;  // called with the running thread
+    };
+
+    vector<unique_ptr<Queue>> queues;  // one per thread, the caller's first
+    vector<thread> threads;
+    atomic<size_t> queued;  // tasks waiting in any queue
+    mutex sleepLock;
+    condition_variable wake;
+    bool stopping;
+
+    bool runOne(size_t self);
+    void work(size_t self);
+
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return queues.size(); }  // threads, the caller included
+    // Runs task(i, thread) for i in 0 .. count - 1, thread being the index
+    // (below size()) of the thread running it; returns once all finished
+    void run(size_t count, const function<void(size_t, size_t)>& task);
+};
+
+#endif // THREAD_POOL_H
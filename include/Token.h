@@ -11,7 +11,8 @@ enum class TokenType {
     IDENTIFIER,   // Table names, column names
     NUMBER,       // Integer values
     STRING,       // Quoted string values
-    OPERATOR,     // =, ==, >, <, >=, <=, !=
+    PARAMETER,    // ? placeholder; the value is its number, counting from 0
+    OPERATOR,     // =, ==, >, <, >=, <=, !=, +, -, /, %
     PUNCTUATION,  // (, ), ,, ;
     UNKNOWN,      // Unknown token
     END_OF_INPUT  // End of input marker
@@ -10,6 +10,7 @@ class Tokenizer {
 private:
     string input;
     size_t position;
+    size_t parameters;  // ? placeholders read so far
 
     // Helper functions for tokenization
     bool isWhitespace(char c);
@@ -26,6 +27,13 @@ public:
     // Main tokenization method
     vector<Token> tokenize();
 
+    // The statement as a cache key: one space after each token, words in
+    // lower case and every literal replaced by ?, so statements differing
+    // only in their literals share it. The literals go to literals in
+    // order; the counts after LIMIT and OFFSET stay in the key. False when
+    // the statement has a ? placeholder of its own.
+    bool normalize(string& key, vector<Token>& literals);
+
     // Check if a keyword is recognized
     static bool isKeyword(const string& word);
 };
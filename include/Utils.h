@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 using namespace std;
 
 class Utils {
@@ -16,6 +17,9 @@ public:
     // Validation
     static bool isValidIdentifier(const string& name);
     static bool isValidNumber(const string& str);
+
+    // Checksums
+    static uint32_t crc32(const string& data);
 };
 
 #endif // UTILS_H
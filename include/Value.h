@@ -0,0 +1,54 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <string>
+#include <cstdint>
+using namespace std;
+
+// Declared column types; the numbers are also the value tags stored on disk
+enum class ColumnType : uint8_t {
+    TEXT = 0,
+    INT = 1,
+    DOUBLE = 2
+};
+
+// A single typed column value. Numbers compare numerically with each other
+// and sort before all text, which compares bytewise.
+class Value {
+private:
+    ColumnType type;
+    union {
+        int64_t intValue;
+        double doubleValue;
+    };
+    string textValue;
+
+public:
+    Value() : type(ColumnType::TEXT), intValue(0) {}
+    static Value fromInt(int64_t value);
+    static Value fromDouble(double value);
+    static Value fromText(const string& value);
+
+    // Converts text to the given type; false when it is not a valid literal
+    static bool parse(const string& text, ColumnType type, Value& out);
+    // Types a constant from the query text: INT, DOUBLE or else TEXT
+    static Value fromLiteral(const string& text);
+
+    static ColumnType parseType(const string& name);
+    static string typeName(ColumnType type);
+    static Value defaultFor(ColumnType type);
+
+    ColumnType getType() const { return type; }
+    bool isNumeric() const { return type != ColumnType::TEXT; }
+    int64_t asInt() const { return intValue; }
+    double asDouble() const { return type == ColumnType::INT ? static_cast<double>(intValue) : doubleValue; }
+    const string& asText() const { return textValue; }
+
+    string toString() const;
+    int compare(const Value& other) const;
+    bool operator==(const Value& other) const { return compare(other) == 0; }
+    bool operator!=(const Value& other) const { return compare(other) != 0; }
+    bool operator<(const Value& other) const { return compare(other) < 0; }
+};
+
+#endif // VALUE_H
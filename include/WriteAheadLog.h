@@ -0,0 +1,87 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+using namespace std;
+
+// When appended entries are forced to stable storage
+enum class WalSyncMode {
+    ALWAYS,   // fdatasync after every entry
+    BATCH,    // fdatasync every groupCommitSize entries (and on checkpoint)
+    OFF       // leave flushing to the OS
+};
+
+// One logged change: the records of a single table touched by one statement
+struct WalEntry {
+    enum class Type : uint8_t {
+        INSERT = 1,
+        UPDATE = 2,
+        DELETE = 3
+    };
+
+    uint64_t lsn;
+    Type type;
+    string tableName;
+    vector<int64_t> recordIds;       // heap record ids the change applies to
+    vector<int64_t> movedTo;         // UPDATE only: id after the update (differs when relocated)
+    vector<vector<string>> records;  // new values (INSERT / UPDATE only)
+
+    WalEntry() : lsn(0), type(Type::INSERT) {}
+};
+
+// Append-only, segmented redo log kept in each database directory
+// as wal.<segment>.log files.
+class WriteAheadLog {
+private:
+    string directory;
+    int fd;
+    uint64_t segmentNumber;
+    uint64_t nextLSN;
+    uint64_t syncedLSN;
+    size_t segmentBytes;
+    WalSyncMode syncMode;
+    int groupCommitSize;
+    int unsyncedEntries;
+
+    string getSegmentPath(uint64_t segment) const;
+    string getCheckpointPath() const;
+    vector<uint64_t> listSegments() const;
+    bool openSegment(uint64_t segment);
+
+    static string serialize(const WalEntry& entry);
+    static bool deserialize(const string& payload, WalEntry& entry);
+
+public:
+    WriteAheadLog(const string& dir, WalSyncMode mode = WalSyncMode::BATCH);
+    ~WriteAheadLog();
+
+    // Assigns the entry its LSN and appends it to the current segment; on
+    // failure nothing of it is left in the log
+    bool append(WalEntry& entry);
+    bool sync();  // false when fdatasync fails; nothing more counts as durable then
+    bool syncTo(uint64_t lsn);  // write-ahead rule: called before a page with this LSN is written;
+                                // false for an LSN not appended yet
+
+    // Reads every intact entry of every segment, oldest first
+    void replay(const function<void(const WalEntry&)>& apply) const;
+
+    // Closes the current segment and starts a new one; returns the closed
+    // segment, or 0 (changing nothing) when it cannot be made durable
+    uint64_t rotate();
+    // Records that everything up to lsn is in the data files, then drops
+    // the segments up to and including segment
+    void finishCheckpoint(uint64_t segment, uint64_t lsn);
+
+    uint64_t getLastLSN() const;
+    uint64_t getNextLSN() const;  // the LSN the next append will assign
+    void advanceLSN(uint64_t lsn);
+    size_t getSegmentBytes() const;
+
+    WalSyncMode getSyncMode() const;
+    void setSyncMode(WalSyncMode mode);
+};
+
+#endif // WRITE_AHEAD_LOG_H
@@ -1,73 +1,401 @@
 #include "BPlusTree.h"
 #include <algorithm>
+#include <cstring>
+#include <cstdio>
 using namespace std;
-BPlusTree::BPlusTree() : root(make_shared<BPlusTreeNode>(true)) {}
-
-void BPlusTree::insert(const string& key, int value) {
-    if (root->keys.size() >= maxKeys) {
-        auto newRoot = make_shared<BPlusTreeNode>(false);
-        newRoot->children.push_back(root);
-        splitChild(newRoot, 0);
-        root = newRoot;
-    }
-    insertNonFull(root, key, value);
-}
-
-void BPlusTree::insertNonFull(shared_ptr<BPlusTreeNode> node, const string& key, int value) {
-    int i = node->keys.size() - 1;
-    
-    if (node->isLeaf) {
-        node->keys.push_back("");
-        node->values.push_back(0);
-        while (i >= 0 && key < node->keys[i]) {
-            node->keys[i + 1] = node->keys[i];
-            node->values[i + 1] = node->values[i];
-            i--;
+
+namespace {
+
+// Node header layout; bytes 0-7 are the page lsn
+const int LEAF_POS = 8;
+const int COUNT_POS = 10;
+const int FREE_END_POS = 12;
+const int LINK_POS = 16;
+
+// Meta page layout
+const char INDEX_MAGIC[8] = {'M', 'S', 'Q', 'L', 'B', 'T', 'R', 'E'};
+const int META_MAGIC_POS = 8;
+const int META_ROOT_POS = 16;
+const int META_PAGES_POS = 20;
+const int META_FANOUT_POS = 24;
+const int META_CLEAN_POS = 28;
+const int META_FILL_POS = 32;
+
+uint32_t readU32(const Page& page, int pos) {
+    uint32_t value;
+    memcpy(&value, page.data.data() + pos, sizeof(value));
+    return value;
+}
+
+void writeU32(Page& page, int pos, uint32_t value) {
+    memcpy(page.data.data() + pos, &value, sizeof(value));
+}
+
+int compareBytes(const char* a, size_t aLength, const string& b) {
+    int c = memcmp(a, b.data(), min(aLength, b.size()));
+    if (c != 0) return c;
+    return aLength < b.size() ? -1 : (aLength > b.size() ? 1 : 0);
+}
+
+} // namespace
+
+uint16_t BPlusTreeNode::getU16(int pos) const {
+    uint16_t value;
+    memcpy(&value, page.data.data() + pos, sizeof(value));
+    return value;
+}
+
+void BPlusTreeNode::setU16(int pos, uint16_t value) {
+    memcpy(page.data.data() + pos, &value, sizeof(value));
+}
+
+void BPlusTreeNode::init(bool leaf) {
+    fill(page.data.begin(), page.data.end(), 0);
+    page.data[LEAF_POS] = leaf ? 1 : 0;
+    setU16(FREE_END_POS, PAGE_SIZE);
+    setLink(-1);
+    page.dirty = true;
+}
+
+bool BPlusTreeNode::isLeaf() const {
+    return page.data[LEAF_POS] != 0;
+}
+
+int BPlusTreeNode::getCount() const {
+    return getU16(COUNT_POS);
+}
+
+int BPlusTreeNode::getLink() const {
+    int32_t link;
+    memcpy(&link, page.data.data() + LINK_POS, sizeof(link));
+    return link;
+}
+
+void BPlusTreeNode::setLink(int pageID) {
+    int32_t link = pageID;
+    memcpy(page.data.data() + LINK_POS, &link, sizeof(link));
+}
+
+const char* BPlusTreeNode::entryAt(int index, uint16_t& keyLength) const {
+    const char* entry = page.data.data() + getU16(HEADER_SIZE + index * 2);
+    memcpy(&keyLength, entry, sizeof(keyLength));
+    return entry + 2;
+}
+
+string BPlusTreeNode::getKey(int index) const {
+    uint16_t length;
+    const char* key = entryAt(index, length);
+    return string(key, length);
+}
+
+int BPlusTreeNode::compareKey(int index, const string& key) const {
+    uint16_t length;
+    const char* stored = entryAt(index, length);
+    return compareBytes(stored, length, key);
+}
+
+uint64_t BPlusTreeNode::getValue(int index) const {
+    uint16_t length;
+    const char* key = entryAt(index, length);
+    uint64_t value;
+    memcpy(&value, key + length, sizeof(value));
+    return value;
+}
+
+int BPlusTreeNode::lowerBound(const string& key) const {
+    int low = 0, high = getCount();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compareKey(mid, key) < 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+int BPlusTreeNode::upperBound(const string& key) const {
+    int low = 0, high = getCount();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compareKey(mid, key) <= 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+bool BPlusTreeNode::insertAt(int index, const string& key, uint64_t value) {
+    int count = getCount();
+    int needed = entrySize(key);
+    int directoryEnd = HEADER_SIZE + count * 2;
+    if (getU16(FREE_END_POS) - directoryEnd < needed) {
+        // Space freed by removals is only reclaimed by repacking the page
+        Entries entries = getEntries();
+        int used = 0;
+        for (const auto& entry : entries) used += entrySize(entry.first);
+        if (PAGE_SIZE - HEADER_SIZE - used < needed) {
+            return false;
+        }
+        setEntries(entries.begin(), entries.end());
+    }
+
+    int offset = getU16(FREE_END_POS) - (needed - 2);
+    uint16_t keyLength = static_cast<uint16_t>(key.size());
+    char* entry = page.data.data() + offset;
+    memcpy(entry, &keyLength, sizeof(keyLength));
+    memcpy(entry + 2, key.data(), key.size());
+    memcpy(entry + 2 + key.size(), &value, sizeof(value));
+
+    char* directory = page.data.data() + HEADER_SIZE;
+    memmove(directory + (index + 1) * 2, directory + index * 2, (count - index) * 2);
+    setU16(HEADER_SIZE + index * 2, static_cast<uint16_t>(offset));
+    setU16(COUNT_POS, static_cast<uint16_t>(count + 1));
+    setU16(FREE_END_POS, static_cast<uint16_t>(offset));
+    page.dirty = true;
+    return true;
+}
+
+void BPlusTreeNode::removeAt(int index) {
+    int count = getCount();
+    char* directory = page.data.data() + HEADER_SIZE;
+    memmove(directory + index * 2, directory + (index + 1) * 2, (count - index - 1) * 2);
+    setU16(COUNT_POS, static_cast<uint16_t>(count - 1));
+    page.dirty = true;
+}
+
+BPlusTreeNode::Entries BPlusTreeNode::getEntries() const {
+    Entries entries;
+    int count = getCount();
+    entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        entries.push_back({getKey(i), getValue(i)});
+    }
+    return entries;
+}
+
+void BPlusTreeNode::setEntries(Entries::const_iterator begin, Entries::const_iterator end) {
+    bool leaf = isLeaf();
+    int link = getLink();
+    uint64_t lsn = page.getLSN();
+    init(leaf);
+    setLink(link);
+    page.setLSN(lsn);
+    int index = 0;
+    for (auto it = begin; it != end; ++it) {
+        insertAt(index++, it->first, it->second);
+    }
+}
+
+BPlusTree::BPlusTree(const string& filename, shared_ptr<BufferPool> bufferPool)
+    : pool(bufferPool), fileId(-1), indexFile(filename), rootPage(1), pageCount(0),
+      fanout(DEFAULT_BTREE_FANOUT), fillFactor(DEFAULT_BTREE_FILL_FACTOR), clean(false) {}
+
+BPlusTree::~BPlusTree() {
+    if (fileId >= 0) {
+        pool->closeFile(fileId);
+    }
+}
+
+bool BPlusTree::create(int maxKeys, int fillPercent) {
+    if (fileId >= 0) {
+        pool->closeFile(fileId);
+    }
+    fileId = pool->openFile(indexFile, true);
+    if (fileId < 0) return false;
+
+    fanout = maxKeys > 0 ? max(maxKeys, 3) : 0;
+    fillFactor = fillPercent > 0 ? min(fillPercent, 100) : DEFAULT_BTREE_FILL_FACTOR;
+    pageCount = 1;
+    rootPage = allocatePage(true);
+    clean = false;
+    writeMeta();
+    return true;
+}
+
+bool BPlusTree::open() {
+    fileId = pool->openFile(indexFile, false);
+    if (fileId < 0) return false;
+
+    PinnedPage meta = pool->getFilePageCount(fileId) > 1 ? pool->fetchPage(fileId, 0) : PinnedPage();
+    if (!meta || memcmp(meta->data.data() + META_MAGIC_POS, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+    rootPage = static_cast<int>(readU32(*meta, META_ROOT_POS));
+    pageCount = static_cast<int>(readU32(*meta, META_PAGES_POS));
+    fanout = static_cast<int>(readU32(*meta, META_FANOUT_POS));
+    // 0 in files written before the fill factor was kept
+    fillFactor = static_cast<int>(readU32(*meta, META_FILL_POS));
+    if (fillFactor <= 0 || fillFactor > 100) {
+        fillFactor = DEFAULT_BTREE_FILL_FACTOR;
+    }
+    clean = meta->data[META_CLEAN_POS] != 0;
+    return rootPage > 0 && rootPage < pageCount;
+}
+
+bool BPlusTree::isClean() const {
+    return clean;
+}
+
+const string& BPlusTree::getFileName() const {
+    return indexFile;
+}
+
+int BPlusTree::getFanout() const {
+    return fanout;
+}
+
+int BPlusTree::getFillFactor() const {
+    return fillFactor;
+}
+
+void BPlusTree::writeMeta() {
+    PinnedPage meta = pool->fetchPage(fileId, 0);
+    if (!meta) return;
+    fill(meta->data.begin(), meta->data.end(), 0);
+    memcpy(meta->data.data() + META_MAGIC_POS, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeU32(*meta, META_ROOT_POS, static_cast<uint32_t>(rootPage));
+    writeU32(*meta, META_PAGES_POS, static_cast<uint32_t>(pageCount));
+    writeU32(*meta, META_FANOUT_POS, static_cast<uint32_t>(fanout));
+    writeU32(*meta, META_FILL_POS, static_cast<uint32_t>(fillFactor));
+    meta->data[META_CLEAN_POS] = clean ? 1 : 0;
+    meta->dirty = true;
+}
+
+// The on-disk clean flag must be gone before any changed page can be written
+void BPlusTree::markModified() {
+    if (clean) {
+        clean = false;
+        writeMeta();
+        pool->flushFile(fileId);
+    }
+}
+
+int BPlusTree::allocatePage(bool leaf) {
+    int pageID = pageCount++;
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    if (page) {
+        BPlusTreeNode(*page).init(leaf);
+    }
+    return pageID;
+}
+
+bool BPlusTree::isFull(const BPlusTreeNode& node) const {
+    return fanout > 0 && node.getCount() >= fanout;
+}
+
+PinnedPage BPlusTree::findLeaf(const string& key, vector<int>* path) const {
+    int pageID = rootPage;
+    while (true) {
+        PinnedPage page = pool->fetchPage(fileId, pageID);
+        if (!page) return page;
+        BPlusTreeNode node(*page);
+        if (node.isLeaf()) {
+            return page;
         }
-        node->keys[i + 1] = key;
-        node->values[i + 1] = value;
-    } else {
-        while (i >= 0 && key < node->keys[i]) i--;
-        i++;
-        if (node->children[i]->keys.size() >= maxKeys) {
-            splitChild(node, i);
-            if (key > node->keys[i]) i++;
+        if (path) path->push_back(pageID);
+        int index = node.upperBound(key);
+        pageID = index == 0 ? node.getLink() : static_cast<int>(node.getValue(index - 1));
+    }
+}
+
+// Splits by bytes so that both halves fit however long the keys are
+size_t BPlusTree::splitPoint(const BPlusTreeNode::Entries& entries) {
+    size_t total = 0;
+    for (const auto& entry : entries) total += BPlusTreeNode::entrySize(entry.first);
+    size_t used = 0, mid = 0;
+    while (mid < entries.size() && used < total / 2) {
+        used += BPlusTreeNode::entrySize(entries[mid++].first);
+    }
+    return max<size_t>(1, min(mid, entries.size() - 1));
+}
+
+bool BPlusTree::insert(const string& key, RecordID value) {
+    if (key.size() > static_cast<size_t>(BPlusTreeNode::MAX_KEY_SIZE)) {
+        return false;
+    }
+
+    vector<int> path;
+    string separator;
+    int rightID;
+    {
+        PinnedPage page = findLeaf(key, &path);
+        if (!page) return false;
+        BPlusTreeNode leaf(*page);
+        int index = leaf.lowerBound(key);
+        if (index < leaf.getCount() && leaf.compareKey(index, key) == 0) {
+            return false;
         }
-        insertNonFull(node->children[i], key, value);
-    }
-}
-
-void BPlusTree::splitChild(shared_ptr<BPlusTreeNode> parent, int index) {
-    auto fullChild = parent->children[index];
-    auto newChild = make_shared<BPlusTreeNode>(fullChild->isLeaf);
-    
-    int mid = maxKeys / 2;
-    newChild->keys.assign(fullChild->keys.begin() + mid, fullChild->keys.end());
-    fullChild->keys.erase(fullChild->keys.begin() + mid, fullChild->keys.end());
-    
-    if (fullChild->isLeaf) {
-        newChild->values.assign(fullChild->values.begin() + mid, fullChild->values.end());
-        fullChild->values.erase(fullChild->values.begin() + mid, fullChild->values.end());
-        newChild->nextLeaf = fullChild->nextLeaf;
-        fullChild->nextLeaf = newChild;
-    } else {
-        newChild->children.assign(fullChild->children.begin() + mid + 1, fullChild->children.end());
-        fullChild->children.erase(fullChild->children.begin() + mid + 1, fullChild->children.end());
-    }
-    
-    parent->keys.insert(parent->keys.begin() + index, fullChild->keys[mid - 1]);
-    parent->children.insert(parent->children.begin() + index + 1, newChild);
-}
-
-int BPlusTree::search(const string& key) const {
-    auto node = root;
-    while (!node->isLeaf) {
-        int i = 0;
-        while (i < node->keys.size() && key > node->keys[i]) i++;
-        node = node->children[i];
-    }
-    for (size_t i = 0; i < node->keys.size(); i++) {
-        if (node->keys[i] == key) return node->values[i];
+
+        markModified();
+        if (!isFull(leaf) && leaf.insertAt(index, key, static_cast<uint64_t>(value))) {
+            return true;
+        }
+
+        auto entries = leaf.getEntries();
+        entries.insert(entries.begin() + index, {key, static_cast<uint64_t>(value)});
+        size_t mid = splitPoint(entries);
+
+        rightID = allocatePage(true);
+        PinnedPage rightPage = pool->fetchPage(fileId, rightID);
+        BPlusTreeNode right(*rightPage);
+        right.setLink(leaf.getLink());
+        right.setEntries(entries.begin() + mid, entries.end());
+        leaf.setLink(rightID);
+        leaf.setEntries(entries.begin(), entries.begin() + mid);
+        separator = entries[mid].first;  // copied up; it stays in the right leaf
+    }
+
+    insertIntoParent(path, separator, rightID);
+    return true;
+}
+
+void BPlusTree::insertIntoParent(vector<int>& path, const string& separator, int rightPage) {
+    if (path.empty()) {
+        int newRoot = allocatePage(false);
+        PinnedPage page = pool->fetchPage(fileId, newRoot);
+        BPlusTreeNode root(*page);
+        root.setLink(rootPage);
+        root.insertAt(0, separator, static_cast<uint64_t>(rightPage));
+        rootPage = newRoot;
+        writeMeta();
+        return;
+    }
+
+    int parentID = path.back();
+    path.pop_back();
+
+    string upSeparator;
+    int newRight;
+    {
+        PinnedPage page = pool->fetchPage(fileId, parentID);
+        BPlusTreeNode parent(*page);
+        int index = parent.upperBound(separator);
+        if (!isFull(parent) && parent.insertAt(index, separator, static_cast<uint64_t>(rightPage))) {
+            return;
+        }
+
+        auto entries = parent.getEntries();
+        entries.insert(entries.begin() + index, {separator, static_cast<uint64_t>(rightPage)});
+        size_t mid = splitPoint(entries);
+
+        // The middle key moves up; its child becomes the right node's link
+        newRight = allocatePage(false);
+        PinnedPage rightPageRef = pool->fetchPage(fileId, newRight);
+        BPlusTreeNode right(*rightPageRef);
+        right.setLink(static_cast<int>(entries[mid].second));
+        right.setEntries(entries.begin() + mid + 1, entries.end());
+        parent.setEntries(entries.begin(), entries.begin() + mid);
+        upSeparator = entries[mid].first;
+    }
+
+    insertIntoParent(path, upSeparator, newRight);
+}
+
+RecordID BPlusTree::search(const string& key) const {
+    PinnedPage page = findLeaf(key, nullptr);
+    if (!page) return -1;
+    BPlusTreeNode leaf(*page);
+    int index = leaf.lowerBound(key);
+    if (index < leaf.getCount() && leaf.compareKey(index, key) == 0) {
+        return static_cast<RecordID>(leaf.getValue(index));
     }
     return -1;
 }
@@ -76,25 +404,143 @@ bool BPlusTree::exists(const string& key) const {
     return search(key) != -1;
 }
 
-vector<int> BPlusTree::rangeSearch(const string& start, const string& end) const {
-    vector<int> results;
-    auto node = root;
-    while (!node->isLeaf) {
-        int i = 0;
-        while (i < node->keys.size() && start > node->keys[i]) i++;
-        node = node->children[i];
-    }
-    while (node) {
-        for (size_t i = 0; i < node->keys.size(); i++) {
-            if (node->keys[i] >= start && node->keys[i] <= end) {
-                results.push_back(node->values[i]);
+void BPlusTree::scanFrom(const string& start, const function<bool(const string&, RecordID)>& visit) const {
+    PinnedPage page = findLeaf(start, nullptr);
+    bool first = true;
+    while (page) {
+        BPlusTreeNode leaf(*page);
+        int count = leaf.getCount();
+        for (int i = first ? leaf.lowerBound(start) : 0; i < count; ++i) {
+            if (!visit(leaf.getKey(i), static_cast<RecordID>(leaf.getValue(i)))) {
+                return;
             }
         }
-        node = node->nextLeaf;
+        first = false;
+        int next = leaf.getLink();
+        page = next > 0 ? pool->fetchPage(fileId, next) : PinnedPage();
     }
+}
+
+vector<RecordID> BPlusTree::rangeSearch(const string& start, const string& end) const {
+    vector<RecordID> results;
+    scanFrom(start, [&](const string& key, RecordID rid) {
+        if (key > end) return false;
+        results.push_back(rid);
+        return true;
+    });
     return results;
 }
 
-void BPlusTree::remove(const string& key) {
-    // Simplified delete - mark as deleted
+bool BPlusTree::remove(const string& key) {
+    PinnedPage page = findLeaf(key, nullptr);
+    if (!page) return false;
+    BPlusTreeNode leaf(*page);
+    int index = leaf.lowerBound(key);
+    if (index >= leaf.getCount() || leaf.compareKey(index, key) != 0) {
+        return false;
+    }
+    markModified();
+    leaf.removeAt(index);
+    return true;
+}
+
+bool BPlusTree::bulkLoad(const vector<pair<string, RecordID>>& entries) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first.size() > static_cast<size_t>(BPlusTreeNode::MAX_KEY_SIZE) ||
+            (i > 0 && !(entries[i - 1].first < entries[i].first))) {
+            return false;
+        }
+    }
+    if (!create(fanout, fillFactor)) {
+        return false;
+    }
+    if (entries.empty()) {
+        return true;
+    }
+
+    // A node takes entries while they fit in its share of the page; each
+    // takes at least one, so every level above has fewer nodes
+    const int maxBytes = (PAGE_SIZE - BPlusTreeNode::HEADER_SIZE) * fillFactor / 100;
+    const int maxKeys = fanout > 0 ? max(1, fanout * fillFactor / 100) : PAGE_SIZE;
+    auto fits = [&](const BPlusTreeNode& node, int used, const string& key) {
+        return node.getCount() == 0 ||
+               (node.getCount() < maxKeys && used + BPlusTreeNode::entrySize(key) <= maxBytes);
+    };
+
+    // Leaves in key order, each linked to the next. level holds the first
+    // key and page of each node of the level just built.
+    vector<pair<string, int>> level;
+    PinnedPage previous;
+    for (size_t i = 0; i < entries.size();) {
+        int pageID = level.empty() ? rootPage : allocatePage(true);  // create() made the first
+        PinnedPage page = pool->fetchPage(fileId, pageID);
+        if (!page) return false;
+        BPlusTreeNode leaf(*page);
+        level.push_back({entries[i].first, pageID});
+        int used = 0;
+        for (; i < entries.size() && fits(leaf, used, entries[i].first); ++i) {
+            leaf.insertAt(leaf.getCount(), entries[i].first, static_cast<uint64_t>(entries[i].second));
+            used += BPlusTreeNode::entrySize(entries[i].first);
+        }
+        if (previous) {
+            BPlusTreeNode(*previous).setLink(pageID);
+            previous->dirty = true;
+        }
+        previous = move(page);
+    }
+    previous = PinnedPage();
+
+    // Each internal node links to its first child and holds the first key
+    // of each later one, which is where the child's keys start
+    while (level.size() > 1) {
+        vector<pair<string, int>> parents;
+        for (size_t i = 0; i < level.size();) {
+            int pageID = allocatePage(false);
+            PinnedPage page = pool->fetchPage(fileId, pageID);
+            if (!page) return false;
+            BPlusTreeNode node(*page);
+            parents.push_back({level[i].first, pageID});
+            node.setLink(level[i++].second);
+            int used = 0;
+            for (; i < level.size() && fits(node, used, level[i].first); ++i) {
+                node.insertAt(node.getCount(), level[i].first, static_cast<uint64_t>(level[i].second));
+                used += BPlusTreeNode::entrySize(level[i].first);
+            }
+        }
+        level.swap(parents);
+    }
+
+    rootPage = level[0].second;
+    writeMeta();
+    return true;
+}
+
+void BPlusTree::clear() {
+    create(fanout, fillFactor);
+}
+
+// Pages first, then the clean flag, so the flag never covers unwritten pages
+bool BPlusTree::flush() {
+    if (clean) {
+        return true;
+    }
+    if (!pool->flushFile(fileId)) {
+        return false;
+    }
+    clean = true;
+    writeMeta();
+    if (!pool->flushFile(fileId)) {
+        clean = false;
+        return false;
+    }
+    return true;
+}
+
+bool BPlusTree::moveToFile(const string& filename) {
+    if (rename(indexFile.c_str(), filename.c_str()) != 0) {
+        return false;
+    }
+    indexFile = filename;
+    pool->renameFile(fileId, filename);
+    return true;
 }
@@ -0,0 +1,305 @@
+#include "Batch.h"
+#include "SimdKernels.h"
+#include <cmath>
+#include <functional>
+#include <algorithm>
+using namespace std;
+
+void ColumnVector::clear() {
+    ints.clear();
+    doubles.clear();
+    texts.clear();
+}
+
+void ColumnVector::append(const Value& value) {
+    switch (type) {
+        case ColumnType::INT:
+            ints.push_back(value.getType() == ColumnType::INT ? value.asInt()
+                                                              : static_cast<int64_t>(value.asDouble()));
+            break;
+        case ColumnType::DOUBLE:
+            doubles.push_back(value.asDouble());
+            break;
+        default:
+            texts.push_back(value.isNumeric() ? value.toString() : value.asText());
+            break;
+    }
+}
+
+Value ColumnVector::get(size_t row) const {
+    switch (type) {
+        case ColumnType::INT: return Value::fromInt(ints[row]);
+        case ColumnType::DOUBLE: return Value::fromDouble(doubles[row]);
+        default: return Value::fromText(texts[row]);
+    }
+}
+
+void Batch::reset(const vector<ColumnType>& types) {
+    columns.resize(types.size());
+    for (size_t i = 0; i < types.size(); ++i) {
+        columns[i].type = types[i];
+        columns[i].clear();
+    }
+    count = 0;
+    selection.clear();
+}
+
+BatchScan::BatchScan(shared_ptr<const Table> source, const vector<int>& tableColumns, int first, int end)
+    : table(source), columns(tableColumns), pageID(0), firstPage(first), endPage(end) {
+    for (int column : columns) {
+        types.push_back(table->getColumnTypes()[column]);
+    }
+}
+
+void BatchScan::open() {
+    pageID = firstPage - 1;
+}
+
+bool BatchScan::next(Batch& batch) {
+    batch.reset(types);
+    int pageCount = endPage < 0 ? table->getPageCount() : min(endPage, table->getPageCount());
+    while (batch.count < BATCH_SIZE && ++pageID < pageCount) {
+        table->scanPage(pageID, [this, &batch](RecordID, const Record& record) {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                batch.columns[i].append(record.get(columns[i]));
+            }
+            batch.count++;
+        });
+    }
+    for (size_t row = 0; row < batch.count; ++row) {
+        batch.selection.push_back(static_cast<uint32_t>(row));
+    }
+    return batch.count > 0;
+}
+
+void BatchScan::close() {}
+
+// Keeps the rows of in whose value passes compare, writing their positions
+// to out (which may be in). The store is unconditional so the loop has no
+// data-dependent branch.
+template <typename T, typename C, typename Compare>
+static size_t selectRows(const T* values, const C& constant, const uint32_t* in, size_t n,
+                         uint32_t* out, Compare compare) {
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t row = in[i];
+        out[kept] = row;
+        kept += compare(values[row], constant) ? 1 : 0;
+    }
+    return kept;
+}
+
+template <typename T, typename C>
+static size_t selectRows(BoundCondition::Op op, const T* values, const C& constant,
+                         const uint32_t* in, size_t n, uint32_t* out) {
+    switch (op) {
+        case BoundCondition::Op::EQ: return selectRows(values, constant, in, n, out, equal_to<>());
+        case BoundCondition::Op::NE: return selectRows(values, constant, in, n, out, not_equal_to<>());
+        case BoundCondition::Op::LT: return selectRows(values, constant, in, n, out, less<>());
+        case BoundCondition::Op::LE: return selectRows(values, constant, in, n, out, less_equal<>());
+        case BoundCondition::Op::GT: return selectRows(values, constant, in, n, out, greater<>());
+        case BoundCondition::Op::GE: return selectRows(values, constant, in, n, out, greater_equal<>());
+        default: return 0;
+    }
+}
+
+// The terms of an AND narrow the selection one after another, so each
+// runs only on the rows the ones before it kept
+BatchPredicate::BatchPredicate(const BoundExpression& predicate) {
+    bool conjunction;
+    vector<const BoundExpression*> terms;
+    if (!predicate.asJunction(conjunction, terms) || !conjunction) {
+        terms.assign(1, &predicate);
+    }
+    for (const BoundExpression* term : terms) {
+        Step step;
+        step.term = term;
+        step.simple = term->asCondition(step.condition);
+        term->collectColumns(step.columns);
+        sort(step.columns.begin(), step.columns.end());
+        step.columns.erase(unique(step.columns.begin(), step.columns.end()), step.columns.end());
+        steps.push_back(step);
+    }
+}
+
+// Same results as the bound predicate row by row: INT against INT compares
+// exactly, other numbers as doubles, and every number sorts before text.
+// Numeric comparisons and text equality go through the SIMD kernels to a
+// bitmask over the batch; ordered text comparisons loop over the selection.
+// Only the columns the term reads are copied into the row
+void BatchPredicate::applyPerRow(const Step& step, Batch& batch) {
+    if (row.getSize() != batch.columns.size()) {
+        row = Record(vector<Value>(batch.columns.size()));
+    }
+    size_t kept = 0;
+    for (uint32_t position : batch.selection) {
+        for (int column : step.columns) {
+            row.set(column, batch.columns[column].get(position));
+        }
+        batch.selection[kept] = position;
+        kept += step.term->test(row) ? 1 : 0;
+    }
+    batch.selection.resize(kept);
+}
+
+void BatchPredicate::apply(const Step& step, Batch& batch) {
+    if (!step.simple) {
+        applyPerRow(step, batch);
+        return;
+    }
+
+    const BoundCondition& condition = step.condition;
+    vector<uint32_t>& selection = batch.selection;
+    if (condition.column < 0 || condition.column >= static_cast<int>(batch.columns.size())) {
+        selection.clear();
+        return;
+    }
+
+    const ColumnVector& column = batch.columns[condition.column];
+    const Value& constant = condition.constant;
+    BoundCondition::Op op = condition.op;
+    uint32_t* rows = selection.data();
+    size_t n = selection.size();
+
+    if (column.isNumeric() != constant.isNumeric()) {
+        // The whole column is on one side of the constant
+        bool below = column.isNumeric();
+        bool keep = op == BoundCondition::Op::NE ||
+                    (below && (op == BoundCondition::Op::LT || op == BoundCondition::Op::LE)) ||
+                    (!below && (op == BoundCondition::Op::GT || op == BoundCondition::Op::GE));
+        if (!keep) selection.clear();
+        return;
+    }
+
+    mask.resize((batch.count + 63) / 64);
+    if (column.type == ColumnType::TEXT) {
+        if (op != BoundCondition::Op::EQ && op != BoundCondition::Op::NE) {
+            selection.resize(selectRows(op, column.texts.data(), constant.asText(), rows, n, rows));
+            return;
+        }
+        SimdKernels::equalTexts(column.texts.data(), batch.count, constant.asText(), mask.data());
+        if (op == BoundCondition::Op::NE) {
+            for (auto& word : mask) word = ~word;
+        }
+    } else if (column.type == ColumnType::DOUBLE) {
+        SimdKernels::compareDoubles(column.doubles.data(), batch.count, op, constant.asDouble(), mask.data());
+    } else if (constant.getType() == ColumnType::INT) {
+        SimdKernels::compareInts(column.ints.data(), batch.count, op, constant.asInt(), mask.data());
+    } else {
+        // An integral DOUBLE constant can be compared as an INT
+        double number = constant.asDouble();
+        if (number != floor(number) || fabs(number) >= 9.2e18) {
+            selection.resize(selectRows(op, column.ints.data(), number, rows, n, rows));
+            return;
+        }
+        SimdKernels::compareInts(column.ints.data(), batch.count, op, static_cast<int64_t>(number), mask.data());
+    }
+
+    size_t kept = 0;
+    if (n == batch.count) {
+        // Every row was live, so the set bits are the new selection
+        for (size_t word = 0; word < mask.size(); ++word) {
+            for (uint64_t bits = mask[word]; bits; bits &= bits - 1) {
+                uint32_t row = static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits));
+                if (row < batch.count) rows[kept++] = row;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t row = rows[i];
+            rows[kept] = row;
+            kept += (mask[row / 64] >> (row % 64)) & 1;
+        }
+    }
+    selection.resize(kept);
+}
+
+void BatchPredicate::apply(Batch& batch) {
+    for (size_t i = 0; i < steps.size() && !batch.selection.empty(); ++i) {
+        apply(steps[i], batch);
+    }
+}
+
+BatchFilter::BatchFilter(unique_ptr<BatchOperator> child, unique_ptr<BoundExpression> bound)
+    : input(move(child)), predicate(move(bound)), filter(*predicate) {}
+
+void BatchFilter::open() {
+    input->open();
+}
+
+bool BatchFilter::next(Batch& batch) {
+    // Batches left empty by the filter are skipped
+    while (input->next(batch)) {
+        filter.apply(batch);
+        if (!batch.selection.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchFilter::close() {
+    input->close();
+}
+
+ParallelScan::ParallelScan(shared_ptr<const Table> source, const vector<int>& tableColumns,
+                           unique_ptr<BoundExpression> condition, ThreadPool& threads)
+    : table(source), columns(tableColumns), predicate(move(condition)), pool(threads), nextPage(1),
+      morsel(0), position(0) {}
+
+void ParallelScan::open() {
+    nextPage = 1;
+    wave.clear();
+    morsel = 0;
+    position = 0;
+}
+
+bool ParallelScan::nextWave(const function<void(size_t, size_t, Batch&)>& visit, size_t& morsels) {
+    int pageCount = table->getPageCount();
+    if (nextPage >= pageCount) {
+        return false;
+    }
+    int first = nextPage;
+    morsels = min(maxWaveSize(), static_cast<size_t>((pageCount - first + MORSEL_PAGES - 1) / MORSEL_PAGES));
+    nextPage = min(pageCount, first + static_cast<int>(morsels) * MORSEL_PAGES);
+
+    pool.run(morsels, [&](size_t i, size_t thread) {
+        int begin = first + static_cast<int>(i) * MORSEL_PAGES;
+        BatchScan scan(table, columns, begin, min(begin + MORSEL_PAGES, pageCount));
+        unique_ptr<BatchPredicate> filter(predicate ? new BatchPredicate(*predicate) : nullptr);
+        Batch batch;
+        scan.open();
+        while (scan.next(batch)) {
+            if (filter) {
+                filter->apply(batch);
+            }
+            if (!batch.selection.empty()) {
+                visit(i, thread, batch);
+            }
+        }
+    });
+    return true;
+}
+
+bool ParallelScan::next(Batch& batch) {
+    while (true) {
+        for (; morsel < wave.size(); ++morsel, position = 0) {
+            if (position < wave[morsel].size()) {
+                batch = move(wave[morsel][position++]);
+                return true;
+            }
+        }
+        size_t morsels;
+        wave.assign(maxWaveSize(), vector<Batch>());
+        morsel = 0;
+        position = 0;
+        if (!nextWave([this](size_t i, size_t, Batch& read) { wave[i].push_back(move(read)); }, morsels)) {
+            wave.clear();
+            return false;
+        }
+    }
+}
+
+void ParallelScan::close() {
+    wave.clear();
+}
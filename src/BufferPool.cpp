@@ -0,0 +1,288 @@
+#include "BufferPool.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+using namespace std;
+
+PinnedPage& PinnedPage::operator=(PinnedPage&& other) noexcept {
+    if (this != &other) {
+        if (page) pool->unpinPage(fileId, page->pageID);
+        pool = other.pool;
+        fileId = other.fileId;
+        page = other.page;
+        other.page = nullptr;
+    }
+    return *this;
+}
+
+PinnedPage::~PinnedPage() {
+    if (page) {
+        pool->unpinPage(fileId, page->pageID);
+    }
+}
+
+BufferPool::BufferPool(size_t capacityMB)
+    : clockHand(0), nextFileId(1), hits(0), misses(0), evictions(0), pageWrites(0) {
+    capacity = max<size_t>(capacityMB * 1024 * 1024 / PAGE_SIZE, 16);
+}
+
+BufferPool::~BufferPool() {
+    for (auto& file : files) {
+        close(file.second.fd);
+    }
+}
+
+int BufferPool::openFile(const string& path, bool truncate, function<bool(uint64_t)> flushLog) {
+    int flags = O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    lock_guard<mutex> lock(latch);
+    int fileId = nextFileId++;
+    files[fileId] = FileInfo{path, fd, flushLog};
+    return fileId;
+}
+
+void BufferPool::closeFile(int fileId) {
+    lock_guard<mutex> lock(latch);
+    for (auto& frame : frames) {
+        if (frame->fileId == fileId) {
+            pageTable.erase(pageKey(fileId, frame->page.pageID));
+            frame->fileId = -1;
+            frame->pinCount = 0;
+            frame->page.dirty = false;
+            frame->checkpointPending = false;
+        }
+    }
+
+    auto it = files.find(fileId);
+    if (it != files.end()) {
+        close(it->second.fd);
+        files.erase(it);
+    }
+}
+
+void BufferPool::renameFile(int fileId, const string& path) {
+    lock_guard<mutex> lock(latch);
+    auto it = files.find(fileId);
+    if (it != files.end()) {
+        it->second.path = path;
+    }
+}
+
+void BufferPool::setLogFlusher(int fileId, function<bool(uint64_t)> flushLog) {
+    lock_guard<mutex> lock(latch);
+    auto it = files.find(fileId);
+    if (it != files.end()) {
+        it->second.flushLog = flushLog;
+    }
+}
+
+size_t BufferPool::getFilePageCount(int fileId) const {
+    lock_guard<mutex> lock(latch);
+    auto it = files.find(fileId);
+    struct stat info;
+    if (it == files.end() || fstat(it->second.fd, &info) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(info.st_size) / PAGE_SIZE;
+}
+
+// Writes a dirty frame back, honouring the write-ahead rule
+bool BufferPool::writeFrame(Frame& frame) {
+    auto it = files.find(frame.fileId);
+    if (it == files.end()) {
+        return false;
+    }
+    if (it->second.flushLog && !it->second.flushLog(frame.page.getLSN())) {
+        return false;
+    }
+
+    off_t offset = static_cast<off_t>(frame.page.pageID) * PAGE_SIZE;
+    if (pwrite(it->second.fd, frame.page.data.data(), PAGE_SIZE, offset) != PAGE_SIZE) {
+        return false;
+    }
+    frame.page.dirty = false;
+    frame.checkpointPending = false;
+    pageWrites++;
+    return true;
+}
+
+// CLOCK: sweep the frames, giving referenced pages a second chance
+size_t BufferPool::findVictim() {
+    if (frames.size() < capacity) {
+        frames.push_back(unique_ptr<Frame>(new Frame()));
+        return frames.size() - 1;
+    }
+
+    for (size_t scanned = 0; scanned < 2 * frames.size(); ++scanned) {
+        size_t index = clockHand;
+        clockHand = (clockHand + 1) % frames.size();
+
+        Frame& frame = *frames[index];
+        if (frame.fileId < 0) {
+            return index;
+        }
+        if (frame.pinCount > 0) {
+            continue;
+        }
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        if ((frame.page.dirty || frame.checkpointPending) && !writeFrame(frame)) {
+            continue;
+        }
+
+        pageTable.erase(pageKey(frame.fileId, frame.page.pageID));
+        frame.fileId = -1;
+        evictions++;
+        return index;
+    }
+
+    // Everything is pinned: go over capacity rather than fail the caller
+    frames.push_back(unique_ptr<Frame>(new Frame()));
+    return frames.size() - 1;
+}
+
+PinnedPage BufferPool::fetchPage(int fileId, int pageID) {
+    lock_guard<mutex> lock(latch);
+
+    auto it = pageTable.find(pageKey(fileId, pageID));
+    if (it != pageTable.end()) {
+        Frame& frame = *frames[it->second];
+        frame.pinCount++;
+        frame.referenced = true;
+        hits++;
+        return PinnedPage(this, fileId, &frame.page);
+    }
+
+    auto file = files.find(fileId);
+    if (file == files.end()) {
+        return PinnedPage();
+    }
+
+    misses++;
+    size_t index = findVictim();
+    Frame& frame = *frames[index];
+    frame.page.pageID = pageID;
+    frame.page.dirty = false;
+
+    off_t offset = static_cast<off_t>(pageID) * PAGE_SIZE;
+    ssize_t n = pread(file->second.fd, frame.page.data.data(), PAGE_SIZE, offset);
+    if (n != PAGE_SIZE) {
+        frame.page.reset(pageID);  // past the end of the file
+    }
+
+    frame.fileId = fileId;
+    frame.pinCount = 1;
+    frame.referenced = true;
+    pageTable[pageKey(fileId, pageID)] = index;
+    return PinnedPage(this, fileId, &frame.page);
+}
+
+void BufferPool::unpinPage(int fileId, int pageID) {
+    lock_guard<mutex> lock(latch);
+    auto it = pageTable.find(pageKey(fileId, pageID));
+    if (it != pageTable.end() && frames[it->second]->pinCount > 0) {
+        frames[it->second]->pinCount--;
+    }
+}
+
+vector<pair<int, vector<char>>> BufferPool::takeDirtyPages(int fileId, bool all) {
+    lock_guard<mutex> lock(latch);
+    vector<pair<int, vector<char>>> snapshot;
+    for (auto& frame : frames) {
+        if (frame->fileId == fileId && (frame->page.dirty || all)) {
+            snapshot.push_back({frame->page.pageID, frame->page.data});
+            frame->page.dirty = false;
+            frame->checkpointPending = true;
+        }
+    }
+    sort(snapshot.begin(), snapshot.end(),
+         [](const pair<int, vector<char>>& a, const pair<int, vector<char>>& b) { return a.first < b.first; });
+    return snapshot;
+}
+
+// A page evicted since the snapshot was taken was written in its current
+// (newer) version at eviction; writing the snapshot over it would lose changes.
+bool BufferPool::writeSnapshot(int fileId, const vector<pair<int, vector<char>>>& snapshot) {
+    bool ok = true;
+    int fd = -1;
+    for (const auto& page : snapshot) {
+        lock_guard<mutex> lock(latch);
+        auto file = files.find(fileId);
+        if (file == files.end()) {
+            return false;
+        }
+        fd = file->second.fd;
+
+        auto it = pageTable.find(pageKey(fileId, page.first));
+        if (it == pageTable.end() || !frames[it->second]->checkpointPending) {
+            continue;
+        }
+        frames[it->second]->checkpointPending = false;
+
+        off_t offset = static_cast<off_t>(page.first) * PAGE_SIZE;
+        if (pwrite(fd, page.second.data(), PAGE_SIZE, offset) != PAGE_SIZE) {
+            ok = false;
+        } else {
+            pageWrites++;
+        }
+    }
+    return (fd < 0 || fsync(fd) == 0) && ok;
+}
+
+bool BufferPool::flushFile(int fileId) {
+    lock_guard<mutex> lock(latch);
+    auto file = files.find(fileId);
+    if (file == files.end()) {
+        return false;
+    }
+
+    bool ok = true;
+    for (auto& frame : frames) {
+        if (frame->fileId == fileId && (frame->page.dirty || frame->checkpointPending)) {
+            ok = writeFrame(*frame) && ok;
+        }
+    }
+    return fsync(file->second.fd) == 0 && ok;
+}
+
+void BufferPool::evictDown() {
+    // Shrink by evicting unpinned frames from the end of the frame table
+    while (frames.size() > capacity) {
+        Frame& frame = *frames.back();
+        if (frame.pinCount > 0) break;
+        if (frame.fileId >= 0) {
+            if ((frame.page.dirty || frame.checkpointPending) && !writeFrame(frame)) break;
+            pageTable.erase(pageKey(frame.fileId, frame.page.pageID));
+            evictions++;
+        }
+        frames.pop_back();
+    }
+    if (clockHand >= frames.size()) {
+        clockHand = 0;
+    }
+}
+
+void BufferPool::setCapacityMB(size_t capacityMB) {
+    lock_guard<mutex> lock(latch);
+    capacity = max<size_t>(capacityMB * 1024 * 1024 / PAGE_SIZE, 16);
+    evictDown();
+}
+
+BufferPoolStats BufferPool::getStats() const {
+    lock_guard<mutex> lock(latch);
+    BufferPoolStats stats{capacity, 0, 0, 0, hits, misses, evictions, pageWrites};
+    for (const auto& frame : frames) {
+        if (frame->fileId < 0) continue;
+        stats.residentPages++;
+        if (frame->pinCount > 0) stats.pinnedPages++;
+        if (frame->page.dirty) stats.dirtyPages++;
+    }
+    return stats;
+}
@@ -0,0 +1,144 @@
+#include "Catalog.h"
+#include "ByteBuffer.h"
+#include "FileManager.h"
+#include "Utils.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+const char CATALOG_MAGIC[8] = {'M', 'S', 'Q', 'L', 'C', 'A', 'T', 'L'};
+const uint32_t CATALOG_VERSION = 1;
+
+bool sameInfo(const TableInfo& a, const TableInfo& b) {
+    return a.columns == b.columns && a.types == b.types && a.primaryKey == b.primaryKey &&
+           a.indexes == b.indexes && a.createLSN == b.createLSN && a.pages == b.pages;
+}
+
+} // namespace
+
+Catalog::Catalog(const string& directory) : fileName(directory + "/catalog.bin") {}
+
+// Layout: magic, version, table count, the tables, then a CRC of all before it
+bool Catalog::load() {
+    tables.clear();
+    string data = FileManager::readFile(fileName);
+    if (data.size() < sizeof(CATALOG_MAGIC) + 4 ||
+        memcmp(data.data(), CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0) {
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&crc, data.data() + data.size() - 4, sizeof(crc));
+    data.resize(data.size() - 4);
+    if (Utils::crc32(data) != crc) {
+        return false;
+    }
+
+    ByteReader reader(data.data() + sizeof(CATALOG_MAGIC), data.size() - sizeof(CATALOG_MAGIC));
+    if (reader.get<uint32_t>() != CATALOG_VERSION) {
+        return false;
+    }
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count && reader.ok; ++i) {
+        string name = reader.getString();
+        TableInfo info;
+        info.createLSN = reader.get<uint64_t>();
+        info.pages = reader.get<uint32_t>();
+        uint32_t columnCount = reader.get<uint32_t>();
+        for (uint32_t c = 0; c < columnCount && reader.ok; ++c) {
+            info.columns.push_back(reader.getString());
+            info.types.push_back(static_cast<ColumnType>(reader.get<uint8_t>()));
+        }
+        info.primaryKey = reader.getString();
+        uint32_t indexCount = reader.get<uint32_t>();
+        for (uint32_t x = 0; x < indexCount && reader.ok; ++x) {
+            string indexName = reader.getString();
+            info.indexes.push_back({indexName, reader.getString()});
+        }
+        tables[name] = move(info);
+    }
+    if (!reader.ok) {
+        tables.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Catalog::save() const {
+    string data(CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    ByteWriter writer(data);
+    writer.put<uint32_t>(CATALOG_VERSION);
+    writer.put<uint32_t>(static_cast<uint32_t>(tables.size()));
+    for (const auto& entry : tables) {
+        const TableInfo& info = entry.second;
+        writer.putString(entry.first);
+        writer.put<uint64_t>(info.createLSN);
+        writer.put<uint32_t>(info.pages);
+        writer.put<uint32_t>(static_cast<uint32_t>(info.columns.size()));
+        for (size_t c = 0; c < info.columns.size(); ++c) {
+            writer.putString(info.columns[c]);
+            writer.put<uint8_t>(static_cast<uint8_t>(info.types[c]));
+        }
+        writer.putString(info.primaryKey);
+        writer.put<uint32_t>(static_cast<uint32_t>(info.indexes.size()));
+        for (const auto& index : info.indexes) {
+            writer.putString(index.first);
+            writer.putString(index.second);
+        }
+    }
+    writer.put<uint32_t>(Utils::crc32(data));
+    return FileManager::writeFileAtomic(fileName, data);
+}
+
+bool Catalog::hasTable(const string& name) const {
+    return tables.find(name) != tables.end();
+}
+
+const TableInfo* Catalog::find(const string& name) const {
+    auto it = tables.find(name);
+    return it != tables.end() ? &it->second : nullptr;
+}
+
+string Catalog::findIndex(const string& indexName) const {
+    for (const auto& entry : tables) {
+        for (const auto& index : entry.second.indexes) {
+            if (index.first == indexName) {
+                return entry.first;
+            }
+        }
+    }
+    return "";
+}
+
+uint64_t Catalog::getMaxCreateLSN() const {
+    uint64_t lsn = 0;
+    for (const auto& entry : tables) {
+        lsn = max(lsn, entry.second.createLSN);
+    }
+    return lsn;
+}
+
+bool Catalog::update(const Table& table) {
+    TableInfo info;
+    info.columns = table.getColumns();
+    info.types = table.getColumnTypes();
+    info.primaryKey = table.getPrimaryKeyColumn();
+    info.indexes = table.getIndexes();
+    info.createLSN = table.getCreateLSN();
+    info.pages = static_cast<uint32_t>(table.getPageCount());
+
+    auto it = tables.find(table.getTableName());
+    if (it != tables.end() && sameInfo(it->second, info)) {
+        return false;
+    }
+    tables[table.getTableName()] = move(info);
+    return true;
+}
+
+void Catalog::remove(const string& name) {
+    tables.erase(name);
+}
+
+void Catalog::clear() {
+    tables.clear();
+}
@@ -0,0 +1,113 @@
+#include "CsvReader.h"
+using namespace std;
+
+CsvReader::CsvReader(const string& fileName) : in(fileName, ios::binary), lineNumber(0) {}
+
+bool CsvReader::readBlock(size_t blockBytes, size_t count, string& block, vector<CsvChunk>& chunks) {
+    block.swap(carry);
+    carry.clear();
+    chunks.clear();
+
+    // Rows end at a line break outside quotes. Reading goes on until the
+    // block holds one, so a row longer than blockBytes still fits.
+    size_t scanned = 0;
+    size_t lines = 0;
+    bool quoted = false;
+    size_t lastRowEnd = 0;
+    size_t linesAtEnd = 0;
+    size_t target = max<size_t>(blockBytes / max<size_t>(count, 1), 1);
+    size_t nextCut = target;
+    vector<pair<size_t, size_t>> cuts;  // (offset, lines before it)
+    while (true) {
+        for (; scanned < block.size(); ++scanned) {
+            char c = block[scanned];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (c == '\n') {
+                lines++;
+                if (!quoted) {
+                    lastRowEnd = scanned + 1;
+                    linesAtEnd = lines;
+                    if (lastRowEnd >= nextCut) {
+                        cuts.push_back({lastRowEnd, lines});
+                        nextCut = lastRowEnd + target;
+                    }
+                }
+            }
+        }
+        if (!in || (block.size() >= blockBytes && lastRowEnd > 0)) {
+            break;
+        }
+        size_t size = block.size();
+        block.resize(size + max<size_t>(blockBytes, 4096));
+        in.read(&block[size], static_cast<streamsize>(block.size() - size));
+        block.resize(size + static_cast<size_t>(in.gcount()));
+    }
+
+    if (in) {
+        // The rest starts the next block
+        carry.assign(block, lastRowEnd, string::npos);
+        block.resize(lastRowEnd);
+        while (!cuts.empty() && cuts.back().first >= lastRowEnd) {
+            cuts.pop_back();
+        }
+    } else {
+        linesAtEnd = lines;
+    }
+    if (block.empty()) {
+        return false;
+    }
+
+    size_t begin = 0;
+    size_t beginLines = 0;
+    cuts.push_back({block.size(), linesAtEnd});
+    for (const auto& cut : cuts) {
+        if (cut.first > begin) {
+            chunks.push_back({begin, cut.first, lineNumber + beginLines + 1});
+        }
+        begin = cut.first;
+        beginLines = cut.second;
+    }
+    lineNumber += linesAtEnd;
+    return true;
+}
+
+bool CsvReader::nextRow(const string& block, CsvChunk& chunk, vector<string>& fields, size_t& rowLine) {
+    size_t& pos = chunk.begin;
+    // Empty lines are not rows
+    while (pos < chunk.end && (block[pos] == '\n' || (block[pos] == '\r' && pos + 1 < chunk.end && block[pos + 1] == '\n'))) {
+        if (block[pos] == '\n') chunk.line++;
+        pos++;
+    }
+    if (pos >= chunk.end) {
+        return false;
+    }
+
+    rowLine = chunk.line;
+    fields.clear();
+    fields.emplace_back();
+    bool quoted = false;
+    for (; pos < chunk.end; ++pos) {
+        char c = block[pos];
+        if (c == '"') {
+            if (quoted && pos + 1 < chunk.end && block[pos + 1] == '"') {
+                fields.back() += '"';
+                pos++;
+            } else {
+                quoted = !quoted;
+            }
+        } else if (quoted) {
+            if (c == '\n') chunk.line++;
+            fields.back() += c;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c == '\n') {
+            chunk.line++;
+            pos++;
+            break;
+        } else if (c != '\r' || pos + 1 >= chunk.end || block[pos + 1] != '\n') {
+            fields.back() += c;
+        }
+    }
+    return true;
+}
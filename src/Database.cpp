@@ -1,37 +1,445 @@
 #include "Database.h"
 #include "Tokenizer.h"
 #include "Parser.h"
+#include "CsvReader.h"
 #include "FileManager.h"
 #include "Utils.h"
 #include "Colors.h"
+#include "SimdKernels.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
 using namespace std;
 
-Database::Database(const string& baseDir)
-    : baseDirectory(baseDir), currentDatabase("") {
+// Bytes of CSV text COPY parses at a time
+static const size_t COPY_BLOCK_BYTES = 16 * 1024 * 1024;
+// Rows ALTER TABLE copies to the new heap at a time
+static const size_t ALTER_BATCH_ROWS = 4096;
+
+Database::Database(const string& baseDir, WalSyncMode syncMode)
+    : bufferPool(make_shared<BufferPool>(DEFAULT_BUFFER_POOL_MB)), tableCacheSize(256), tableClock(0), catalogSeconds(0),
+      currentDatabase(""), baseDirectory(baseDir), walSyncMode(syncMode),
+      checkpointThreshold(4 * 1024 * 1024), indexFanout(DEFAULT_BTREE_FANOUT),
+      indexFillFactor(DEFAULT_BTREE_FILL_FACTOR), vectorized(true),
+      queryMemory(64 * 1024 * 1024), memoryBudget(1024 * 1024 * 1024), workers(new ThreadPool(max(1u, thread::hardware_concurrency()))),
+      statementCache(256) {
     FileManager::createDirectory(baseDirectory);
     loadDatabasesFromDisk();
 }
 
+Database::~Database() {
+    waitForCheckpoint();
+    for (const auto& wal : wals) {
+        checkpoint(wal.first, false);
+    }
+}
+
+// Only the catalogs are read, across the workers; see openDatabase()
 void Database::loadDatabasesFromDisk() {
-    vector<string> dbDirs = FileManager::listFilesInDirectory(baseDirectory);
-    for (const auto& dbDir : dbDirs) {
-        string dbName = dbDir.substr(dbDir.find_last_of("/\\") + 1);
-        databases[dbName] = unordered_map<string, shared_ptr<Table>>();
-        
+    auto start = chrono::steady_clock::now();
+    vector<string> names;
+    vector<Catalog*> loading;
+    for (const auto& dbDir : FileManager::listDirectories(baseDirectory)) {
+        names.push_back(dbDir.substr(dbDir.find_last_of("/\\") + 1));
+        loading.push_back(&catalogs.emplace(names.back(), Catalog(dbDir)).first->second);
+    }
+    vector<char> loaded(loading.size());
+    workers->run(loading.size(), [&](size_t i, size_t) { loaded[i] = loading[i]->load(); });
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!loaded[i]) {
+            staleCatalogs.insert(names[i]);
+        }
+    }
+    catalogSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Opens a database's log the first time the database is used. Only the
+// tables the log names are loaded to redo it; the rest wait on disk.
+// Table files and index rebuilds are spread over the workers.
+bool Database::openDatabase(const string& dbName) {
+    if (wals.count(dbName)) {
+        return true;
+    }
+    auto catalogIt = catalogs.find(dbName);
+    if (catalogIt == catalogs.end()) {
+        return false;
+    }
+    Catalog& catalog = catalogIt->second;
+    auto start = chrono::steady_clock::now();
+    OpenReport report = {0, 0, 0, 0};
+    string dbDir = getDatabaseDirectory(dbName);
+    // Sort runs and ALTER TABLE rebuilds cut short by a crash
+    SpillFile::removeLeftovers(dbDir);
+    Table::removeLeftovers(dbDir);
+
+    wals[dbName].reset(new WriteAheadLog(dbDir, walSyncMode));
+    WriteAheadLog* wal = wals[dbName].get();
+
+    // Without a usable catalog every table file is read to make one
+    if (staleCatalogs.erase(dbName) > 0) {
+        catalog.clear();
         vector<string> files = FileManager::listFilesInDirectory(dbDir);
-        for (const auto& filepath : files) {
-            Table* table = Table::loadFromFile(filepath);
+        vector<shared_ptr<Table>> tables(files.size());
+        workers->run(files.size(), [&](size_t i, size_t) {
+            tables[i].reset(Table::loadFromFile(files[i], bufferPool));
+        });
+        for (auto& table : tables) {
             if (table) {
-                databases[dbName][table->getTableName()] = shared_ptr<Table>(table);
+                addTable(dbName, table);
+                report.tablesLoaded++;
+            }
+        }
+        catalog.save();
+    }
+    uint64_t maxLSN = max(wal->getLastLSN(), catalog.getMaxCreateLSN());
+
+    // Redo everything logged after each page was last written, then
+    // flush it into the table files so the log starts out empty.
+    wal->replay([&](const WalEntry& entry) {
+        maxLSN = max(maxLSN, entry.lsn);
+        applyLogEntry(dbName, entry);
+        report.logRecords++;
+    });
+    vector<Table*> stale;
+    for (auto& entry : openTables[dbName]) {
+        if (entry.second.table->hasStaleIndexes()) {
+            stale.push_back(entry.second.table.get());
+        }
+    }
+    workers->run(stale.size(), [&](size_t i, size_t) { stale[i]->recoverIndexes(); });
+    report.tablesRebuilt = stale.size();
+    wal->advanceLSN(maxLSN);
+    if (report.logRecords > 0) {
+        checkpoint(dbName, false);
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    openReports[dbName] = report;
+    return true;
+}
+
+// The table if it is open, else read from its file; null when the catalog
+// does not list it or the file cannot be read
+shared_ptr<Table> Database::loadTable(const string& dbName, const string& tableName) {
+    auto& open = openTables[dbName];
+    auto it = open.find(tableName);
+    if (it != open.end()) {
+        it->second.lastUsed = ++tableClock;
+        return it->second.table;
+    }
+    auto catalog = catalogs.find(dbName);
+    if (catalog == catalogs.end() || !catalog->second.hasTable(tableName)) {
+        return nullptr;
+    }
+    shared_ptr<Table> table(Table::loadFromFile(getTableFilePath(dbName, tableName), bufferPool));
+    if (table) {
+        addTable(dbName, table);
+    }
+    return table;
+}
+
+void Database::addTable(const string& dbName, shared_ptr<Table> table) {
+    attachLog(dbName, *table);
+    // The catalog may lag a table written just before a crash
+    auto wal = wals.find(dbName);
+    if (wal != wals.end()) {
+        wal->second->advanceLSN(table->getCreateLSN());
+    }
+    catalogs.at(dbName).update(*table);
+    openTables[dbName][table->getTableName()] = OpenTable{table, ++tableClock};
+}
+
+shared_ptr<Table> Database::findTable(const string& tableName) {
+    if (currentDatabase.empty()) {
+        return nullptr;
+    }
+    shared_ptr<Table> table = loadTable(currentDatabase, tableName);
+    if (table) {
+        table->recoverIndexes();
+        evictTables(tableCacheSize);
+    }
+    return table;
+}
+
+// Writes out and closes the least recently used tables no statement holds
+// until at most keep are open
+void Database::evictTables(size_t keep) {
+    size_t open = 0;
+    for (const auto& db : openTables) {
+        open += db.second.size();
+    }
+    if (open <= keep) {
+        return;
+    }
+
+    waitForCheckpoint();
+    while (open > keep) {
+        string victimDb;
+        string victim;
+        uint64_t oldest = UINT64_MAX;
+        for (const auto& db : openTables) {
+            for (const auto& entry : db.second) {
+                if (entry.second.table.use_count() == 1 && entry.second.lastUsed < oldest) {
+                    victimDb = db.first;
+                    victim = entry.first;
+                    oldest = entry.second.lastUsed;
+                }
             }
         }
+        if (victim.empty()) {
+            return;
+        }
+
+        shared_ptr<Table> table = openTables[victimDb][victim].table;
+        if (!table->saveToFile()) {
+            return;  // stays open until it can be written
+        }
+        Catalog& catalog = catalogs.at(victimDb);
+        if (catalog.update(*table)) {
+            catalog.save();
+        }
+        openTables[victimDb].erase(victim);
+        open--;
+    }
+}
+
+// Dirty pages of the table may only be written once the log covering them is durable
+void Database::attachLog(const string& dbName, Table& table) {
+    auto it = wals.find(dbName);
+    if (it != wals.end()) {
+        WriteAheadLog* wal = it->second.get();
+        table.setLogFlusher([wal](uint64_t lsn) { return wal->syncTo(lsn); });
+    }
+}
+
+void Database::applyLogEntry(const string& dbName, const WalEntry& entry) {
+    shared_ptr<Table> logged = loadTable(dbName, entry.tableName);
+    if (!logged || entry.lsn <= logged->getCreateLSN()) {
+        return;
+    }
+
+    // Each redo is skipped by the heap when the page LSN shows it already happened
+    Table& table = *logged;
+    Record record;
+    for (size_t i = 0; i < entry.recordIds.size(); ++i) {
+        switch (entry.type) {
+            case WalEntry::Type::INSERT:
+                if (table.makeRecord(entry.records[i], record)) {
+                    table.redoInsert(entry.recordIds[i], record, entry.lsn);
+                }
+                break;
+            case WalEntry::Type::UPDATE:
+                if (table.makeRecord(entry.records[i], record)) {
+                    table.redoUpdate(entry.recordIds[i], entry.movedTo[i], record, entry.lsn);
+                }
+                break;
+            case WalEntry::Type::DELETE:
+                table.redoDelete(entry.recordIds[i], entry.lsn);
+                break;
+        }
+    }
+}
+
+uint64_t Database::nextLSN() const {
+    auto it = wals.find(currentDatabase);
+    return it != wals.end() ? it->second->getNextLSN() : 0;
+}
+
+bool Database::logChange(WalEntry& entry) {
+    auto it = wals.find(currentDatabase);
+    if (it == wals.end() || !it->second->append(entry)) {
+        return false;
+    }
+    maybeCheckpoint();
+    return true;
+}
+
+// Writes a table synchronously (DDL); it then covers every LSN issued so far
+bool Database::persistTable(Table& table) {
+    waitForCheckpoint();
+    auto it = wals.find(currentDatabase);
+    table.setCreateLSN(it != wals.end() ? it->second->getLastLSN() : 0);
+    if (!table.saveToFile()) {
+        return false;
+    }
+    // After the table file, so the catalog never describes a table not yet written
+    Catalog& catalog = catalogs.at(currentDatabase);
+    catalog.update(table);
+    return catalog.save();
+}
+
+void Database::maybeCheckpoint() {
+    auto it = wals.find(currentDatabase);
+    if (it != wals.end() && it->second->getSegmentBytes() >= checkpointThreshold) {
+        checkpoint(currentDatabase, true);
+    }
+}
+
+// Rotates the log, copies the dirty pages of every table and writes them
+// out (in a background thread when requested). Closed log segments are
+// removed only after every page has reached disk.
+void Database::checkpoint(const string& dbName, bool background) {
+    waitForCheckpoint();
+
+    auto walIt = wals.find(dbName);
+    if (walIt == wals.end()) {
+        return;
+    }
+    WriteAheadLog* wal = walIt->second.get();
+    uint64_t closedSegment = wal->rotate();
+    if (closedSegment == 0) {
+        // The log could not be made durable, so no page may be written yet
+        return;
+    }
+    uint64_t checkpointLSN = wal->getLastLSN();
+
+    bool rewriteAll;
+    {
+        lock_guard<mutex> lock(checkpointMutex);
+        rewriteAll = failedCheckpoints.erase(dbName) > 0;
+    }
+
+    typedef vector<pair<shared_ptr<Table>, vector<pair<int, vector<char>>>>> PageSnapshots;
+    PageSnapshots snapshots;
+    for (auto& entry : openTables[dbName]) {
+        auto pages = entry.second.table->takeDirtyPages(rewriteAll);
+        if (!pages.empty()) {
+            snapshots.push_back({entry.second.table, move(pages)});
+        }
+    }
+
+    auto writeSnapshots = [this, dbName, wal, closedSegment, checkpointLSN](PageSnapshots tables) {
+        bool ok = true;
+        for (const auto& table : tables) {
+            ok = table.first->writeSnapshot(table.second) && ok;
+        }
+        if (ok) {
+            wal->finishCheckpoint(closedSegment, checkpointLSN);
+        } else {
+            lock_guard<mutex> lock(checkpointMutex);
+            failedCheckpoints.insert(dbName);
+        }
+    };
+
+    if (background) {
+        checkpointThread = thread(writeSnapshots, move(snapshots));
+    } else {
+        // Indexes are not logged; they are only written, and marked clean,
+        // when the whole table is (a crash rebuilds them from the heap)
+        writeSnapshots(move(snapshots));
+        Catalog& catalog = catalogs.at(dbName);
+        bool changed = false;
+        for (auto& entry : openTables[dbName]) {
+            entry.second.table->flushIndexes();
+            changed = catalog.update(*entry.second.table) || changed;
+        }
+        if (changed) {
+            catalog.save();
+        }
     }
 }
 
+void Database::waitForCheckpoint() {
+    if (checkpointThread.joinable()) {
+        checkpointThread.join();
+    }
+}
+
+bool Database::setOption(const string& name, const string& value) {
+    string option = Utils::toLower(name);
+    string setting = Utils::toLower(value);
+
+    if (option == "wal_sync") {
+        if (setting == "always") walSyncMode = WalSyncMode::ALWAYS;
+        else if (setting == "batch") walSyncMode = WalSyncMode::BATCH;
+        else if (setting == "off") walSyncMode = WalSyncMode::OFF;
+        else return false;
+
+        for (auto& wal : wals) {
+            wal.second->setSyncMode(walSyncMode);
+        }
+        return true;
+    }
+
+    if (option == "buffer_pool_mb") {
+        if (!Utils::isValidNumber(setting) || stoull(setting) == 0) return false;
+        bufferPool->setCapacityMB(stoull(setting));
+        return true;
+    }
+
+    if (option == "checkpoint_kb") {
+        if (!Utils::isValidNumber(setting) || stoull(setting) == 0) return false;
+        checkpointThreshold = stoull(setting) * 1024;
+        return true;
+    }
+
+    // Applies to indexes created from now on; 0 fills each page
+    if (option == "index_fanout") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 6) return false;
+        indexFanout = stoi(setting);
+        return true;
+    }
+
+    // How full index builds pack each node, in percent: less leaves room
+    // for inserts that would otherwise split the packed nodes
+    if (option == "index_fill_factor") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 3 || stoi(setting) < 10 || stoi(setting) > 100) {
+            return false;
+        }
+        indexFillFactor = stoi(setting);
+        return true;
+    }
+
+    if (option == "vectorized") {
+        if (setting == "on") vectorized = true;
+        else if (setting == "off") vectorized = false;
+        else return false;
+        return true;
+    }
+
+    // Memory each query's sorts, aggregates and joins may hold before
+    // they spill to temporary files
+    if (option == "query_memory_kb") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 12 || stoull(setting) == 0) return false;
+        queryMemory = stoull(setting) * 1024;
+        return true;
+    }
+
+    // Memory all queries together may hold; past it they spill as well
+    if (option == "memory_limit_mb") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 9 || stoull(setting) == 0) return false;
+        memoryBudget.setLimit(stoull(setting) * 1024 * 1024);
+        return true;
+    }
+
+    // Statement shapes whose parse is kept; 0 parses every statement
+    if (option == "statement_cache_size") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 6) return false;
+        statementCache.setCapacity(stoull(setting));
+        return true;
+    }
+
+    // Tables kept open at once; past it the least recently used are closed
+    if (option == "table_cache_size") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 6 || stoull(setting) == 0) return false;
+        tableCacheSize = stoull(setting);
+        evictTables(tableCacheSize);
+        return true;
+    }
+
+    // Threads a large scan is spread over; 1 keeps every query serial
+    if (option == "threads") {
+        if (!Utils::isValidNumber(setting) || setting.size() > 3 || stoi(setting) < 1 || stoi(setting) > 256) {
+            return false;
+        }
+        workers.reset(new ThreadPool(stoi(setting)));
+        return true;
+    }
+
+    return false;
+}
+
 string Database::getDatabaseDirectory(const string& dbName) const {
     return baseDirectory + "/" + dbName;
 }
@@ -41,17 +449,19 @@ string Database::getTableFilePath(const string& dbName, const string& tableName)
 }
 
 bool Database::createDatabase(const string& databaseName) {
-    if (databases.find(databaseName) != databases.end()) {
+    if (catalogs.find(databaseName) != catalogs.end()) {
         return false;
     }
     
-    databases[databaseName] = unordered_map<string, shared_ptr<Table>>();
-    FileManager::createDirectory(getDatabaseDirectory(databaseName));
+    string dbDir = getDatabaseDirectory(databaseName);
+    FileManager::createDirectory(dbDir);
+    catalogs.emplace(databaseName, Catalog(dbDir)).first->second.save();
+    wals[databaseName].reset(new WriteAheadLog(dbDir, walSyncMode));
     return true;
 }
 
 bool Database::useDatabase(const string& databaseName) {
-    if (databases.find(databaseName) == databases.end()) {
+    if (!openDatabase(databaseName)) {
         return false;
     }
     currentDatabase = databaseName;
@@ -62,115 +472,515 @@ string Database::getCurrentDatabase() const {
     return currentDatabase;
 }
 
-bool Database::createTable(const string& tableName, const vector<string>& columns) {
+bool Database::createTable(const string& tableName, const vector<string>& columns,
+                           const vector<ColumnType>& types, const string& primaryKey) {
     if (currentDatabase.empty()) {
         return false;
     }
     
-    auto& dbTables = databases[currentDatabase];
-    if (dbTables.find(tableName) != dbTables.end()) {
+    if (catalogs.at(currentDatabase).hasTable(tableName)) {
         return false;
     }
 
-    shared_ptr<Table> table(new Table(tableName, columns));
-    dbTables[tableName] = table;
-    return table->saveToFile(getTableFilePath(currentDatabase, tableName));
+    shared_ptr<Table> table(new Table(tableName, columns, types, getTableFilePath(currentDatabase, tableName),
+                                     bufferPool, primaryKey, indexFanout, indexFillFactor));
+    if (!table->headerFits()) {
+        // Too many or too long column names to keep in the table file
+        vector<string> files = table->getIndexFiles();
+        files.push_back(table->getFileName());
+        table.reset();
+        for (const auto& file : files) {
+            remove(file.c_str());
+        }
+        return false;
+    }
+    addTable(currentDatabase, table);
+    evictTables(tableCacheSize);
+    return persistTable(*table);
 }
 
 bool Database::dropTable(const string& tableName) {
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
+    if (currentDatabase.empty()) {
+        return false;
+    }
+    Catalog& catalog = catalogs.at(currentDatabase);
+    const TableInfo* info = catalog.find(tableName);
+    if (!info) {
         return false;
     }
 
-    databases[currentDatabase].erase(tableName);
+    // The files are named for the table, so it need not be loaded
+    waitForCheckpoint();
     string filePath = getTableFilePath(currentDatabase, tableName);
+    vector<string> indexFiles;
+    if (!info->primaryKey.empty()) {
+        indexFiles.push_back(Table::indexFileFor(filePath, "pk"));
+    }
+    for (const auto& index : info->indexes) {
+        indexFiles.push_back(Table::indexFileFor(filePath, index.first));
+    }
+    openTables[currentDatabase].erase(tableName);
+    catalog.remove(tableName);
+    catalog.save();
+    for (const auto& indexFile : indexFiles) {
+        remove(indexFile.c_str());
+    }
     return remove(filePath.c_str()) == 0;
 }
 
-bool Database::insert(const string& tableName, const vector<string>& values) {
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
+bool Database::createIndex(const string& indexName, const string& tableName, const string& columnName) {
+    shared_ptr<Table> table = findTable(tableName);
+    // Index names are unique within a database
+    if (!table || !catalogs.at(currentDatabase).findIndex(indexName).empty()) {
         return false;
     }
 
-    shared_ptr<Table> table = databases[currentDatabase][tableName];
-    if (values.size() != table->getColumns().size()) {
+    waitForCheckpoint();
+    return table->createIndex(indexName, columnName, indexFanout, indexFillFactor) && persistTable(*table);
+}
+
+bool Database::dropIndex(const string& indexName, const string& tableName) {
+    if (currentDatabase.empty()) {
+        return false;
+    }
+    string owner = catalogs.at(currentDatabase).findIndex(indexName);
+    if (owner.empty() || (!tableName.empty() && owner != tableName)) {
+        return false;
+    }
+    shared_ptr<Table> table = findTable(owner);
+    if (!table) {
         return false;
     }
 
-    Record record(values);
-    table->insertRow(record);
-    return table->saveToFile(getTableFilePath(currentDatabase, tableName));
+    waitForCheckpoint();
+    return table->dropIndex(indexName) && persistTable(*table);
+}
+
+bool Database::insert(const string& tableName, const vector<string>& values) {
+    return insertRows(tableName, vector<vector<string>>(1, values));
 }
 
-bool Database::updateRecords(const string& tableName, const vector<pair<string, string>>& updates, const Condition& condition) {
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
+bool Database::insertRows(const string& tableName, const vector<vector<string>>& rows) {
+    shared_ptr<Table> table = rows.empty() ? nullptr : findTable(tableName);
+    if (!table) {
         return false;
     }
 
-    shared_ptr<Table> table = databases[currentDatabase][tableName];
-    const auto& columns = table->getColumns();
-    auto& rows = const_cast<vector<Record>&>(table->getRows());
-
-    for (auto& record : rows) {
-        if (table->evaluateCondition(record, condition)) {
-            for (const auto& update : updates) {
-                int colIdx = -1;
-                for (size_t i = 0; i < columns.size(); ++i) {
-                    if (Utils::toLower(columns[i]) == Utils::toLower(update.first)) {
-                        colIdx = i;
-                        break;
-                    }
-                }
-                if (colIdx >= 0) {
-                    record.setValue(colIdx, update.second);
+    vector<Record> records(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!table->makeRecord(rows[i], records[i])) {
+            return false;
+        }
+    }
+
+    WalEntry entry;
+    entry.type = WalEntry::Type::INSERT;
+    entry.tableName = tableName;
+    uint64_t lsn = nextLSN();
+    if (!table->insertRows(records, lsn, entry.recordIds)) {
+        return false;
+    }
+    entry.records = rows;
+    if (logChange(entry)) {
+        return true;
+    }
+    // A change that is not in the log must not stay in the table
+    for (size_t i = entry.recordIds.size(); i-- > 0;) {
+        table->deleteRow(entry.recordIds[i], lsn);
+    }
+    return false;
+}
+
+// Blocks of the file are cut into chunks of rows, which the workers parse,
+// check and serialize; the heap then takes each block's rows on new pages
+// as one logged statement. Index keys are added once every row is in.
+bool Database::copyFrom(const string& tableName, const string& fileName, bool header, size_t& count) {
+    count = 0;
+    shared_ptr<Table> table = findTable(tableName);
+    if (!table) {
+        return false;
+    }
+    CsvReader reader(fileName);
+    if (!reader.isOpen()) {
+        return false;
+    }
+
+    size_t columnCount = table->getColumns().size();
+    struct Chunk {
+        vector<string> rows;             // serialized
+        vector<string> keys;             // index keys, row by row
+        vector<vector<string>> fields;   // as logged
+        size_t badLine;
+    };
+
+    vector<RecordID> loaded;
+    string block;
+    vector<CsvChunk> bounds;
+    bool skipHeader = header;
+    size_t badLine = 0;
+    bool ok = true;
+    while (ok && reader.readBlock(COPY_BLOCK_BYTES, workers->size() * 4, block, bounds)) {
+        vector<Chunk> chunks(bounds.size());
+        workers->run(bounds.size(), [&](size_t i, size_t) {
+            Chunk& chunk = chunks[i];
+            chunk.badLine = 0;
+            vector<string> fields;
+            vector<string> keys;
+            Record record;
+            string bytes;
+            size_t line = 0;
+            if (i == 0 && skipHeader) {
+                CsvReader::nextRow(block, bounds[i], fields, line);
+            }
+            while (CsvReader::nextRow(block, bounds[i], fields, line)) {
+                if (fields.size() != columnCount || !table->makeRecord(fields, record) ||
+                    !table->prepareRow(record, bytes, keys)) {
+                    chunk.badLine = line;
+                    return;
                 }
+                chunk.rows.push_back(move(bytes));
+                chunk.keys.insert(chunk.keys.end(), keys.begin(), keys.end());
+                chunk.fields.push_back(move(fields));
             }
+        });
+        skipHeader = false;
+
+        WalEntry entry;
+        entry.type = WalEntry::Type::INSERT;
+        entry.tableName = tableName;
+        uint64_t lsn = nextLSN();
+        for (auto& chunk : chunks) {
+            if (chunk.badLine) {
+                badLine = chunk.badLine;
+                ok = false;
+                break;
+            }
+            size_t first = entry.recordIds.size();
+            ok = table->appendRows(chunk.rows, chunk.keys, lsn, entry.recordIds);
+            for (size_t i = 0; first + i < entry.recordIds.size(); ++i) {
+                entry.records.push_back(move(chunk.fields[i]));
+            }
+            if (!ok) break;
         }
+        loaded.insert(loaded.end(), entry.recordIds.begin(), entry.recordIds.end());
+        if (!entry.recordIds.empty() && !logChange(entry)) {
+            ok = false;
+        }
+    }
+
+    if (ok && table->finishBulkLoad()) {
+        count = loaded.size();
+        return true;
     }
 
-    return table->saveToFile(getTableFilePath(currentDatabase, tableName));
+    // Take back what was loaded
+    WalEntry entry;
+    entry.type = WalEntry::Type::DELETE;
+    entry.tableName = tableName;
+    entry.recordIds = loaded;
+    table->abortBulkLoad(loaded, nextLSN());
+    if (!loaded.empty()) {
+        logChange(entry);
+    }
+    count = badLine;
+    return false;
+}
+
+bool Database::updateRecords(const string& tableName, const vector<pair<string, shared_ptr<Expression>>>& updates,
+                             const Condition& condition) {
+    shared_ptr<Table> table = findTable(tableName);
+    if (!table) {
+        return false;
+    }
+    const auto& columns = table->getColumns();
+    const auto& types = table->getColumnTypes();
+
+    unique_ptr<BoundExpression> predicate = table->bindCondition(condition);
+    if (!predicate) {
+        return false;
+    }
+
+    // SET expressions are bound once against the table's columns
+    vector<pair<int, unique_ptr<BoundExpression>>> assignments;
+    for (const auto& update : updates) {
+        int column = table->getColumnIndex(update.first);
+        if (column < 0 || !update.second) {
+            return false;
+        }
+        unique_ptr<BoundExpression> expression = BoundExpression::bind(*update.second, columns, types);
+        if (!expression) {
+            return false;
+        }
+        assignments.push_back({column, move(expression)});
+    }
+
+    // Every expression reads the row as it was before the statement; a
+    // result invalid for its column fails the statement before any write
+    vector<pair<RecordID, Record>> matches = table->findWhere(*predicate);
+    vector<Record> before;
+    before.reserve(matches.size());
+    vector<Value> results(assignments.size());
+    Value scratch;
+    for (auto& match : matches) {
+        before.push_back(match.second);
+        for (size_t i = 0; i < assignments.size(); ++i) {
+            const Value& result = assignments[i].second->evaluate(match.second, scratch);
+            ColumnType type = types[assignments[i].first];
+            if (result.getType() == type) {
+                results[i] = result;
+            } else if (!Value::parse(result.toString(), type, results[i])) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < assignments.size(); ++i) {
+            match.second.set(assignments[i].first, results[i]);
+        }
+    }
+
+    // Reject the whole statement rather than apply part of it
+    for (const auto& match : matches) {
+        if (!table->rowFits(match.second)) {
+            return false;
+        }
+    }
+    if (table->violatesPrimaryKey(matches)) {
+        return false;
+    }
+
+    WalEntry entry;
+    entry.type = WalEntry::Type::UPDATE;
+    entry.tableName = tableName;
+    uint64_t lsn = nextLSN();
+
+    for (auto& match : matches) {
+        Record& record = match.second;
+        RecordID newRid = table->updateRow(match.first, record, lsn);
+        if (newRid < 0) {
+            break;
+        }
+
+        vector<string> values;
+        for (size_t i = 0; i < record.getSize(); ++i) {
+            values.push_back(record.getValue(i));
+        }
+        entry.recordIds.push_back(match.first);
+        entry.movedTo.push_back(newRid);
+        entry.records.push_back(values);
+    }
+
+    if (entry.recordIds.size() == matches.size() && (entry.recordIds.empty() || logChange(entry))) {
+        return true;
+    }
+    // Put back the rows already written: the statement is applied whole
+    // and logged, or not at all
+    for (size_t i = entry.recordIds.size(); i-- > 0;) {
+        table->undoUpdate(entry.recordIds[i], entry.movedTo[i], before[i], lsn);
+    }
+    return false;
 }
 
 bool Database::alterTable(const string& tableName, const string& action, const string& columnName, const string& columnType) {
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
+    shared_ptr<Table> table = findTable(tableName);
+    if (!table) {
         return false;
     }
 
-    shared_ptr<Table> table = databases[currentDatabase][tableName];
+    waitForCheckpoint();
     auto columns = table->getColumns();
+    auto types = table->getColumnTypes();
+    int droppedIndex = -1;
+    int modifiedIndex = -1;
 
     if (action == "ADD") {
+        // Column names are matched case-insensitively
+        if (table->getColumnIndex(columnName) >= 0) {
+            return false;
+        }
         columns.push_back(columnName);
+        types.push_back(Value::parseType(columnType));
     } else if (action == "DROP") {
         auto it = find(columns.begin(), columns.end(), columnName);
         if (it != columns.end()) {
+            droppedIndex = static_cast<int>(it - columns.begin());
             columns.erase(it);
+            types.erase(types.begin() + droppedIndex);
+        }
+    } else if (action == "MODIFY") {
+        auto it = find(columns.begin(), columns.end(), columnName);
+        if (it == columns.end()) {
+            return false;
+        }
+        modifiedIndex = static_cast<int>(it - columns.begin());
+        types[modifiedIndex] = Value::parseType(columnType);
+    }
+
+    // Recreate table with new columns beside the old file, then swap it in
+    string filePath = getTableFilePath(currentDatabase, tableName);
+    shared_ptr<Table> newTable(new Table(tableName, columns, types, filePath + ".rebuild", bufferPool,
+                                        table->getPrimaryKeyColumn(), indexFanout, indexFillFactor));
+    attachLog(currentDatabase, *newTable);
+    // Rows go in through the bulk load path, so the primary index is built
+    // from sorted keys once they are all in
+    bool converted = true;
+    vector<string> rows;
+    vector<string> keys;
+    vector<string> rowKeys;
+    vector<RecordID> rids;
+    string bytes;
+    auto appendBatch = [&]() {
+        converted = newTable->appendRows(rows, keys, 0, rids) && converted;
+        rows.clear();
+        keys.clear();
+        rids.clear();
+    };
+    table->scan([&](RecordID, const Record& record) {
+        if (!converted) {
+            return;
+        }
+        Record row;
+        for (size_t i = 0; i < record.getSize(); ++i) {
+            if (static_cast<int>(i) == droppedIndex) {
+                continue;
+            }
+            if (row.getSize() == columns.size()) {
+                break;
+            }
+            Value value = record.get(i);
+            // A changed type converts through the value's text form
+            if (value.getType() != types[row.getSize()] &&
+                !Value::parse(value.toString(), types[row.getSize()], value)) {
+                converted = false;
+            }
+            row.addValue(value);
+        }
+        while (row.getSize() < columns.size()) {
+            row.addValue(Value::defaultFor(types[row.getSize()]));
+        }
+        if (!newTable->prepareRow(row, bytes, rowKeys)) {
+            converted = false;
+            return;
+        }
+        rows.push_back(move(bytes));
+        keys.insert(keys.end(), rowKeys.begin(), rowKeys.end());
+        if (rows.size() == ALTER_BATCH_ROWS) {
+            appendBatch();
+        }
+    });
+    appendBatch();
+
+    auto discard = [&newTable]() {
+        vector<string> files = newTable->getIndexFiles();
+        files.push_back(newTable->getFileName());
+        newTable.reset();
+        for (const auto& file : files) {
+            remove(file.c_str());
+        }
+    };
+    if (!converted || !newTable->finishBulkLoad()) {
+        // Some value does not fit the new type, or converted primary keys
+        // now repeat; keep the table as it was
+        discard();
+        return false;
+    }
+
+    // Indexes are rebuilt on the new table; those on a dropped column are not
+    for (const auto& index : table->getIndexes()) {
+        if (newTable->getColumnIndex(index.second) < 0) {
+            continue;
+        }
+        if (!newTable->createIndex(index.first, index.second, indexFanout, indexFillFactor)) {
+            discard();
+            return false;
         }
     }
 
-    // Recreate table with new columns
-    shared_ptr<Table> newTable(new Table(tableName, columns));
-    for (const auto& record : table->getRows()) {
-        newTable->insertRow(record);
+    // The new table is written whole, then renamed over the old one, table
+    // file first. The old indexes are marked modified beforehand, so one
+    // a crash leaves beside the new table file is rebuilt, not trusted.
+    auto wal = wals.find(currentDatabase);
+    newTable->setCreateLSN(wal != wals.end() ? wal->second->getLastLSN() : 0);
+    if (!newTable->saveToFile()) {
+        discard();
+        return false;
+    }
+    table->markIndexesModified();
+    bool moved = newTable->moveToFile(filePath);
+    if (newTable->getFileName() != filePath) {
+        discard();
+        return false;
     }
 
-    databases[currentDatabase][tableName] = newTable;
-    return newTable->saveToFile(getTableFilePath(currentDatabase, tableName));
+    openTables[currentDatabase][tableName] = OpenTable{newTable, ++tableClock};
+    Catalog& catalog = catalogs.at(currentDatabase);
+    catalog.update(*newTable);
+    bool saved = catalog.save();
+    vector<string> newIndexFiles = newTable->getIndexFiles();
+    for (const auto& indexFile : table->getIndexFiles()) {
+        if (find(newIndexFiles.begin(), newIndexFiles.end(), indexFile) == newIndexFiles.end()) {
+            remove(indexFile.c_str());
+        }
+    }
+    return moved && saved;
 }
 
 string Database::executeQuery(const string& query) {
+    stringstream result;
+    executeQuery(query, result);
+    return result.str();
+}
+
+// Writes the outcome to result as it goes, so a large SELECT is never held
+// in memory as a whole
+void Database::executeQuery(const string& query, ostream& result) {
     string trimmedQuery = Utils::trim(query);
     if (trimmedQuery.empty()) {
-        return Colors::error("Error: Empty query");
+        result << Colors::error("Error: Empty query");
+        return;
     }
 
-    Tokenizer tokenizer(trimmedQuery);
-    vector<Token> tokens = tokenizer.tokenize();
+    ParsedQuery parsedQuery;
+    statementCache.parse(trimmedQuery, parsedQuery);
+    runQuery(parsedQuery, result);
+}
 
-    Parser parser(tokens);
-    ParsedQuery parsedQuery = parser.parse();
+shared_ptr<PreparedStatement> Database::prepare(const string& sql) {
+    Parser parser(Tokenizer(Utils::trim(sql)).tokenize());
+    shared_ptr<ParsedQuery> parsed = make_shared<ParsedQuery>(parser.parse());
+    switch (parsed->type) {
+        case ParsedQuery::QueryType::PREPARE:
+        case ParsedQuery::QueryType::EXECUTE:
+        case ParsedQuery::QueryType::DEALLOCATE:
+        case ParsedQuery::QueryType::INVALID:
+            return nullptr;
+        default:
+            return make_shared<PreparedStatement>(parsed);
+    }
+}
 
-    stringstream result;
+void Database::execute(const PreparedStatement& statement, ostream& result) {
+    ParsedQuery parsedQuery;
+    if (!statement.instantiate(parsedQuery)) {
+        result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Statement has unbound parameters.";
+        return;
+    }
+    runQuery(parsedQuery, result);
+}
+
+vector<Record> Database::select(const PreparedStatement& statement) {
+    ParsedQuery query;
+    if (statement.getType() != ParsedQuery::QueryType::SELECT || !statement.instantiate(query)) {
+        return vector<Record>();
+    }
+    return runSelect(query);
+}
+
+void Database::runQuery(const ParsedQuery& parsedQuery, ostream& result) {
+    // ? placeholders only have values through EXECUTE
+    if (parsedQuery.parameterCount > 0) {
+        result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET
+               << " Error: Parameters (?) are only allowed in PREPARE.";
+        return;
+    }
 
     switch (parsedQuery.type) {
         case ParsedQuery::QueryType::CREATE_DATABASE: {
@@ -186,9 +996,19 @@ string Database::executeQuery(const string& query) {
         }
 
         case ParsedQuery::QueryType::USE_DATABASE: {
+            bool opening = wals.count(parsedQuery.databaseName) == 0;
             if (useDatabase(parsedQuery.databaseName)) {
                 result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Using database '"
                        << Colors::BRIGHT_YELLOW << parsedQuery.databaseName << Colors::RESET << "'.";
+                // Say what recovery had to do when this was the first use
+                const OpenReport& report = openReports[parsedQuery.databaseName];
+                if (opening && (report.tablesLoaded || report.logRecords || report.tablesRebuilt)) {
+                    stringstream note;
+                    note << "Opened in " << fixed << setprecision(2) << report.seconds << "s: "
+                         << report.tablesLoaded << " tables read, " << report.logRecords
+                         << " log records redone, " << report.tablesRebuilt << " tables reindexed";
+                    result << "\n" << Colors::dim(note.str());
+                }
             } else {
                 result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Database '"
                        << Colors::BRIGHT_RED << parsedQuery.databaseName << Colors::RESET << "' does not exist.";
@@ -197,7 +1017,11 @@ string Database::executeQuery(const string& query) {
         }
 
         case ParsedQuery::QueryType::CREATE_TABLE: {
-            if (createTable(parsedQuery.tableName, parsedQuery.columns)) {
+            vector<ColumnType> types;
+            for (const auto& typeName : parsedQuery.columnTypes) {
+                types.push_back(Value::parseType(typeName));
+            }
+            if (createTable(parsedQuery.tableName, parsedQuery.columns, types, parsedQuery.primaryKeyColumn)) {
                 result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Table '"
                        << Colors::BRIGHT_YELLOW << parsedQuery.tableName << Colors::RESET
                        << "' created successfully.";
@@ -220,12 +1044,56 @@ string Database::executeQuery(const string& query) {
             break;
         }
 
-        case ParsedQuery::QueryType::INSERT: {
-            if (insert(parsedQuery.tableName, parsedQuery.values)) {
-                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Record inserted successfully.";
+        case ParsedQuery::QueryType::CREATE_INDEX: {
+            if (createIndex(parsedQuery.indexName, parsedQuery.tableName, parsedQuery.columns[0])) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Index '"
+                       << Colors::BRIGHT_YELLOW << parsedQuery.indexName << Colors::RESET
+                       << "' created successfully.";
             } else {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Could not create index '"
+                       << Colors::BRIGHT_RED << parsedQuery.indexName << Colors::RESET << "'.";
+            }
+            break;
+        }
+
+        case ParsedQuery::QueryType::DROP_INDEX: {
+            if (dropIndex(parsedQuery.indexName, parsedQuery.tableName)) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Index '"
+                       << Colors::BRIGHT_YELLOW << parsedQuery.indexName << Colors::RESET
+                       << "' dropped successfully.";
+            } else {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Could not drop index '"
+                       << Colors::BRIGHT_RED << parsedQuery.indexName << Colors::RESET << "'.";
+            }
+            break;
+        }
+
+        case ParsedQuery::QueryType::INSERT: {
+            if (!insertRows(parsedQuery.tableName, parsedQuery.values)) {
                 result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Could not insert record into '"
                        << Colors::BRIGHT_RED << parsedQuery.tableName << Colors::RESET << "'.";
+            } else if (parsedQuery.values.size() == 1) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Record inserted successfully.";
+            } else {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " " << parsedQuery.values.size()
+                       << " records inserted successfully.";
+            }
+            break;
+        }
+
+        case ParsedQuery::QueryType::COPY: {
+            size_t count = 0;
+            if (copyFrom(parsedQuery.tableName, parsedQuery.fileName, parsedQuery.header, count)) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " " << count << " records copied into '"
+                       << Colors::BRIGHT_YELLOW << parsedQuery.tableName << Colors::RESET << "'.";
+            } else {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Could not copy '"
+                       << parsedQuery.fileName << "' into '" << Colors::BRIGHT_RED << parsedQuery.tableName
+                       << Colors::RESET << "'";
+                if (count > 0) {
+                    result << " (invalid row at line " << count << ")";
+                }
+                result << ".";
             }
             break;
         }
@@ -261,83 +1129,72 @@ string Database::executeQuery(const string& query) {
                 break;
             }
             
-            vector<Record> records;
-            if (parsedQuery.selectAll) {
-                parsedQuery.columns.push_back("*");
-            }
-
-            Condition* condition = parsedQuery.conditions.empty() ? nullptr : &parsedQuery.conditions[0];
-            records = select(parsedQuery.tableName, parsedQuery.columns, condition);
-
-            if (!parsedQuery.orderByColumn.empty()) {
-                if (databases[currentDatabase].find(parsedQuery.tableName) != databases[currentDatabase].end()) {
-                    records = databases[currentDatabase][parsedQuery.tableName]->selectOrderBy(parsedQuery.orderByColumn, parsedQuery.orderByDesc);
-                    
-                    if (condition) {
-                        vector<Record> filtered;
-                        for (const auto& rec : records) {
-                            if (databases[currentDatabase][parsedQuery.tableName]->evaluateCondition(rec, *condition)) {
-                                filtered.push_back(rec);
-                            }
-                        }
-                        records = filtered;
-                    }
+            string missing = tableExists(parsedQuery.tableName) ? "" : parsedQuery.tableName;
+            for (const auto& join : parsedQuery.joins) {
+                if (missing.empty() && !tableExists(join.tableName)) {
+                    missing = join.tableName;
                 }
             }
+            if (!missing.empty()) {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Table '"
+                       << Colors::BRIGHT_RED << missing << Colors::RESET << "' does not exist.";
+                break;
+            }
+
+            vector<string> columns;
+            unique_ptr<Operator> plan = planSelect(parsedQuery, columns);
+            if (!plan) {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET
+                       << " Error: Invalid column, GROUP BY, HAVING or aggregate.";
+                break;
+            }
 
-            if (!parsedQuery.groupByColumn.empty()) {
-                if (databases[currentDatabase].find(parsedQuery.tableName) != databases[currentDatabase].end()) {
-                    records = databases[currentDatabase][parsedQuery.tableName]->selectGroupBy(parsedQuery.groupByColumn);
+            int colWidth = 18;
+            int totalWidth = (colWidth * columns.size()) + (columns.size() - 1) + 4;
+
+            result << "\n" << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET << "\n";
+
+            result << Colors::BRIGHT_CYAN << "| " << Colors::RESET;
+            for (size_t i = 0; i < columns.size(); ++i) {
+                result << Colors::BRIGHT_YELLOW << left << setw(colWidth - 1) << columns[i] << Colors::RESET;
+                if (i < columns.size() - 1) {
+                    result << Colors::BRIGHT_CYAN << " | " << Colors::RESET;
                 }
             }
+            result << " " << Colors::BRIGHT_CYAN << "|" << Colors::RESET << "\n";
 
-            if (!tableExists(parsedQuery.tableName)) {
-                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Table '"
-                       << Colors::BRIGHT_RED << parsedQuery.tableName << Colors::RESET << "' does not exist.";
-            } else {
-                const auto& columns = parsedQuery.selectAll ? getTableColumns(parsedQuery.tableName) : parsedQuery.columns;
-                
-                int colWidth = 18;
-                int totalWidth = (colWidth * columns.size()) + (columns.size() - 1) + 4;
-                
-                result << "\n" << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET << "\n";
-                
+            result << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET << "\n";
+
+            // Rows are written as the plan produces them
+            size_t rowCount = 0;
+            Record record;
+            plan->open();
+            while (plan->next(record)) {
+                ++rowCount;
                 result << Colors::BRIGHT_CYAN << "| " << Colors::RESET;
-                for (size_t i = 0; i < columns.size(); ++i) {
-                    result << Colors::BRIGHT_YELLOW << left << setw(colWidth - 1) << columns[i] << Colors::RESET;
-                    if (i < columns.size() - 1) {
+                for (size_t i = 0; i < record.getSize(); ++i) {
+                    string value = record.getValue(i);
+                    if (value.length() > static_cast<size_t>(colWidth) - 1) {
+                        value = value.substr(0, colWidth - 4) + "...";
+                    }
+                    result << Colors::CYAN << left << setw(colWidth - 1) << value << Colors::RESET;
+                    if (i < record.getSize() - 1) {
                         result << Colors::BRIGHT_CYAN << " | " << Colors::RESET;
                     }
                 }
                 result << " " << Colors::BRIGHT_CYAN << "|" << Colors::RESET << "\n";
-                
-                result << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET << "\n";
-
-                if (records.empty()) {
-                    result << Colors::BRIGHT_CYAN << "| " << Colors::RESET
-                           << Colors::dim("(No records found)")
-                           << string(totalWidth - 20, ' ')
-                           << Colors::BRIGHT_CYAN << "|" << Colors::RESET << "\n";
-                } else {
-                    for (const auto& record : records) {
-                        result << Colors::BRIGHT_CYAN << "| " << Colors::RESET;
-                        for (size_t i = 0; i < record.getSize(); ++i) {
-                            string value = record.getValue(i);
-                            if (value.length() > colWidth - 1) {
-                                value = value.substr(0, colWidth - 4) + "...";
-                            }
-                            result << Colors::CYAN << left << setw(colWidth - 1) << value << Colors::RESET;
-                            if (i < record.getSize() - 1) {
-                                result << Colors::BRIGHT_CYAN << " | " << Colors::RESET;
-                            }
-                        }
-                        result << " " << Colors::BRIGHT_CYAN << "|" << Colors::RESET << "\n";
-                    }
-                }
-                
-                result << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET;
-                result << "\n" << Colors::dim("Total rows: " + to_string(records.size()));
             }
+            plan->close();
+
+            if (rowCount == 0) {
+                result << Colors::BRIGHT_CYAN << "| " << Colors::RESET
+                       << Colors::dim("(No records found)")
+                       << string(totalWidth - 20, ' ')
+                       << Colors::BRIGHT_CYAN << "|" << Colors::RESET << "\n";
+            }
+
+            result << Colors::BRIGHT_CYAN << "+" << string(totalWidth - 2, '-') << "+" << Colors::RESET;
+            result << "\n" << Colors::dim("Total rows: " + to_string(rowCount));
             break;
         }
 
@@ -354,86 +1211,602 @@ string Database::executeQuery(const string& query) {
             break;
         }
 
+        case ParsedQuery::QueryType::SHOW_STATS: {
+            result << getStats();
+            break;
+        }
+
+        case ParsedQuery::QueryType::SET_OPTION: {
+            if (setOption(parsedQuery.optionName, parsedQuery.optionValue)) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Option '"
+                       << Colors::BRIGHT_YELLOW << parsedQuery.optionName << Colors::RESET
+                       << "' set to '" << parsedQuery.optionValue << "'.";
+            } else {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Invalid value for option '"
+                       << Colors::BRIGHT_RED << parsedQuery.optionName << Colors::RESET << "'.";
+            }
+            break;
+        }
+
+        case ParsedQuery::QueryType::PREPARE: {
+            preparedStatements[parsedQuery.statementName] = make_shared<PreparedStatement>(parsedQuery.statement);
+            result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Statement '"
+                   << Colors::BRIGHT_YELLOW << parsedQuery.statementName << Colors::RESET << "' prepared with "
+                   << parsedQuery.statement->parameterCount << " parameter(s).";
+            break;
+        }
+
+        case ParsedQuery::QueryType::EXECUTE: {
+            auto it = preparedStatements.find(parsedQuery.statementName);
+            if (it == preparedStatements.end()) {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Statement '"
+                       << Colors::BRIGHT_RED << parsedQuery.statementName << Colors::RESET << "' is not prepared.";
+                break;
+            }
+            if (parsedQuery.arguments.size() != it->second->getParameterCount()) {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Statement '"
+                       << Colors::BRIGHT_RED << parsedQuery.statementName << Colors::RESET << "' takes "
+                       << it->second->getParameterCount() << " parameter(s).";
+                break;
+            }
+            PreparedStatement statement = *it->second;
+            for (size_t i = 0; i < parsedQuery.arguments.size(); ++i) {
+                statement.bind(i, parsedQuery.arguments[i]);
+            }
+            execute(statement, result);
+            break;
+        }
+
+        case ParsedQuery::QueryType::DEALLOCATE: {
+            if (preparedStatements.erase(parsedQuery.statementName)) {
+                result << Colors::BRIGHT_GREEN << "[✓]" << Colors::RESET << " Statement '"
+                       << Colors::BRIGHT_YELLOW << parsedQuery.statementName << Colors::RESET << "' deallocated.";
+            } else {
+                result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Statement '"
+                       << Colors::BRIGHT_RED << parsedQuery.statementName << Colors::RESET << "' is not prepared.";
+            }
+            break;
+        }
+
         default:
             result << Colors::BRIGHT_RED << "[✗]" << Colors::RESET << " Error: Invalid query.";
             break;
     }
+}
 
-    return result.str();
+string Database::getStats() const {
+    BufferPoolStats stats = bufferPool->getStats();
+    uint64_t lookups = stats.hits + stats.misses;
+    double hitRatio = lookups ? 100.0 * stats.hits / lookups : 0.0;
+
+    stringstream out;
+    out << Colors::BRIGHT_MAGENTA << "Buffer pool" << Colors::RESET << "\n"
+        << "  capacity:  " << stats.capacityPages << " pages ("
+        << stats.capacityPages * PAGE_SIZE / (1024 * 1024) << " MB)\n"
+        << "  resident:  " << stats.residentPages << " pages, "
+        << stats.pinnedPages << " pinned, " << stats.dirtyPages << " dirty\n"
+        << "  hits:      " << stats.hits << "\n"
+        << "  misses:    " << stats.misses << "\n"
+        << "  hit ratio: " << fixed << setprecision(1) << hitRatio << "%\n"
+        << "  evictions: " << stats.evictions << "\n"
+        << "  writes:    " << stats.pageWrites << "\n"
+        << Colors::BRIGHT_MAGENTA << "Query engine" << Colors::RESET << "\n"
+        << "  vectorized:  " << (vectorized ? "on" : "off") << "\n"
+        << "  kernels:     " << SimdKernels::instructionSet() << "\n"
+        << "  threads:     " << workers->size() << "\n"
+        << Colors::BRIGHT_MAGENTA << "Memory" << Colors::RESET << "\n"
+        << "  per query:  " << queryMemory / 1024 << " KB\n"
+        << "  limit:      " << memoryBudget.getLimit() / (1024 * 1024) << " MB, "
+        << memoryBudget.getUsed() / 1024 << " KB in use";
+    if (lastQueryMemory) {
+        out << "\n  last query: peak " << lastQueryMemory->getPeak() / 1024 << " KB, "
+            << lastQueryMemory->getSpillCount() << " spills";
+    }
+    size_t tables = 0;
+    size_t open = 0;
+    for (const auto& catalog : catalogs) {
+        tables += catalog.second.getTables().size();
+    }
+    for (const auto& db : openTables) {
+        open += db.second.size();
+    }
+    OpenReport opened = {0, 0, 0, 0};
+    for (const auto& report : openReports) {
+        opened.tablesLoaded += report.second.tablesLoaded;
+        opened.logRecords += report.second.logRecords;
+        opened.tablesRebuilt += report.second.tablesRebuilt;
+        opened.seconds += report.second.seconds;
+    }
+    out << "\n" << Colors::BRIGHT_MAGENTA << "Catalog" << Colors::RESET << "\n"
+        << "  databases: " << wals.size() << " of " << catalogs.size() << " open\n"
+        << "  tables:    " << open << " of " << tables << " open (cache " << tableCacheSize << ")\n"
+        << "  startup:   " << catalogs.size() << " catalogs read in " << setprecision(1)
+        << catalogSeconds * 1000 << " ms\n"
+        << "  opening:   " << opened.seconds * 1000 << " ms, " << opened.tablesLoaded << " tables read, "
+        << opened.logRecords << " log records redone, " << opened.tablesRebuilt << " tables reindexed";
+    out << "\n" << Colors::BRIGHT_MAGENTA << "Statement cache" << Colors::RESET << "\n"
+        << "  entries:  " << statementCache.size() << " of " << statementCache.getCapacity() << "\n"
+        << "  hits:     " << statementCache.getHits() << "\n"
+        << "  misses:   " << statementCache.getMisses() << "\n"
+        << "  prepared: " << preparedStatements.size();
+    return out.str();
 }
 
 bool Database::tableExists(const string& tableName) const {
     if (currentDatabase.empty()) return false;
-    auto it = databases.find(currentDatabase);
-    if (it == databases.end()) return false;
-    return it->second.find(tableName) != it->second.end();
+    auto it = catalogs.find(currentDatabase);
+    if (it == catalogs.end()) return false;
+    return it->second.hasTable(tableName);
 }
 
 const vector<string>& Database::getTableColumns(const string& tableName) const {
     static vector<string> empty;
     if (currentDatabase.empty()) return empty;
-    auto it = databases.find(currentDatabase);
-    if (it == databases.end()) return empty;
-    auto tableIt = it->second.find(tableName);
-    if (tableIt != it->second.end()) {
-        return tableIt->second->getColumns();
+    auto it = catalogs.find(currentDatabase);
+    if (it == catalogs.end()) return empty;
+    const TableInfo* info = it->second.find(tableName);
+    return info ? info->columns : empty;
+}
+
+// Rows of one table that satisfy the WHERE terms given, bound to names (the
+// table's columns, qualified in a join). With an orderColumn they arrive
+// in the order of its index. Null when a term cannot be bound.
+unique_ptr<Operator> Database::planScan(shared_ptr<const Table> table, const vector<string>& names,
+                                        const vector<shared_ptr<Expression>>& terms, int orderColumn) {
+    unique_ptr<BoundExpression> predicate;
+    shared_ptr<Expression> where = Expression::conjunction(terms);
+    if (where && !(predicate = BoundExpression::bind(*where, names, table->getColumnTypes()))) {
+        return nullptr;
+    }
+
+    unique_ptr<Operator> plan;
+    if (orderColumn >= 0) {
+        plan.reset(new IndexOrderScan(table, orderColumn));
+    } else if (predicate && table->canUseIndex(*predicate)) {
+        return unique_ptr<Operator>(new IndexScan(table, move(predicate)));
+    } else if (vectorized) {
+        vector<int> columns;
+        for (size_t i = 0; i < names.size(); ++i) {
+            columns.push_back(static_cast<int>(i));
+        }
+        unique_ptr<BatchOperator> batches(new BatchScan(table, columns));
+        if (predicate) {
+            batches.reset(new BatchFilter(move(batches), move(predicate)));
+        }
+        return unique_ptr<Operator>(new BatchToRows(move(batches), columns));
+    } else {
+        plan.reset(new TableScan(table));
     }
-    return empty;
+    if (predicate) {
+        plan.reset(new Filter(move(plan), move(predicate)));
+    }
+    return plan;
 }
 
-vector<Record> Database::select(const string& tableName, const vector<string>& columns,
-                                     const Condition* condition) {
-    vector<Record> result;
+// The rows of FROM and its joins, taken left to right, filtered by WHERE.
+// A WHERE term that reads one table is applied to that table's scan, unless
+// a LEFT JOIN pads its rows. Equalities in ON between a column on each side
+// are the join keys. Two tables joined on one key that both index are
+// merge joined in index order; anything else is hash joined.
+// available and types receive the "table.column" names and the types of
+// the joined rows.
+unique_ptr<Operator> Database::planJoin(const ParsedQuery& query, vector<string>& available,
+                                        vector<ColumnType>& types, shared_ptr<MemoryTracker> memory) {
+    struct Source {
+        shared_ptr<const Table> table;
+        vector<string> names;
+        bool padded;
+        vector<shared_ptr<Expression>> where;
+    };
+    vector<Source> sources;
+    vector<string> qualifiers;
+    auto addSource = [&](const string& tableName, const string& alias, bool padded) {
+        string qualifier = Utils::toLower(alias.empty() ? tableName : alias);
+        shared_ptr<Table> table = findTable(tableName);
+        if (!table || find(qualifiers.begin(), qualifiers.end(), qualifier) != qualifiers.end()) {
+            return false;
+        }
+        Source source;
+        source.table = table;
+        for (const auto& column : source.table->getColumns()) {
+            source.names.push_back(qualifier + "." + column);
+        }
+        source.padded = padded;
+        sources.push_back(source);
+        qualifiers.push_back(qualifier);
+        return true;
+    };
+    if (!addSource(query.tableName, query.tableAlias, false)) {
+        return nullptr;
+    }
+    for (const auto& join : query.joins) {
+        if (!addSource(join.tableName, join.alias, join.left)) {
+            return nullptr;
+        }
+    }
 
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
-        return result;
+    vector<string> all;
+    vector<size_t> sourceOf;  // column of all -> source
+    for (size_t i = 0; i < sources.size(); ++i) {
+        all.insert(all.end(), sources[i].names.begin(), sources[i].names.end());
+        sourceOf.resize(all.size(), i);
+    }
+
+    vector<shared_ptr<Expression>> terms, remaining;
+    if (!query.conditions.empty()) {
+        Expression::splitConjuncts(query.conditions[0].toExpression(), terms);
+    }
+    for (const auto& term : terms) {
+        vector<string> names;
+        term->collectColumns(names);
+        int owner = -1;
+        bool single = true;
+        for (const auto& name : names) {
+            int column = BoundExpression::findColumn(all, name);
+            if (column == -1) continue;  // an unquoted string
+            if (column < 0 || (owner >= 0 && owner != static_cast<int>(sourceOf[column]))) {
+                single = false;
+            } else {
+                owner = static_cast<int>(sourceOf[column]);
+            }
+        }
+        if (single && owner >= 0 && !sources[owner].padded) {
+            sources[owner].where.push_back(term);
+        } else {
+            remaining.push_back(term);
+        }
     }
 
-    shared_ptr<Table> table = databases[currentDatabase][tableName];
+    unique_ptr<Operator> plan;
+    available = sources[0].names;
+    types = sources[0].table->getColumnTypes();
+    vector<bool> padded(available.size(), false);
+    for (size_t i = 1; i < sources.size(); ++i) {
+        const Source& right = sources[i];
+        const JoinClause& join = query.joins[i - 1];
+        vector<string> joinedNames = available;
+        joinedNames.insert(joinedNames.end(), right.names.begin(), right.names.end());
+        vector<ColumnType> joinedTypes = types;
+        const auto& rightTypes = right.table->getColumnTypes();
+        joinedTypes.insert(joinedTypes.end(), rightTypes.begin(), rightTypes.end());
+        int leftWidth = static_cast<int>(available.size());
 
-    vector<Record> records;
-    if (condition) {
-        records = table->selectWhere(*condition);
-    } else {
-        records = table->selectAll();
-    }
-
-    if (!columns.empty() && columns[0] != "*") {
-        vector<int> columnIndices;
-        for (const auto& colName : columns) {
-            int idx = -1;
-            const auto& tableColumns = table->getColumns();
-            for (size_t i = 0; i < tableColumns.size(); ++i) {
-                if (Utils::toLower(tableColumns[i]) == Utils::toLower(colName)) {
-                    idx = i;
-                    break;
+        JoinSpec spec;
+        vector<shared_ptr<Expression>> on, rest;
+        Expression::splitConjuncts(join.on.toExpression(), on);
+        for (const auto& term : on) {
+            if (term->kind == Expression::Kind::COMPARE && (term->text == "=" || term->text == "==") &&
+                term->operands[0]->kind == Expression::Kind::COLUMN &&
+                term->operands[1]->kind == Expression::Kind::COLUMN) {
+                int a = BoundExpression::findColumn(joinedNames, term->operands[0]->text);
+                int b = BoundExpression::findColumn(joinedNames, term->operands[1]->text);
+                if (a >= 0 && b >= 0 && (a < leftWidth) != (b < leftWidth)) {
+                    spec.leftKeys.push_back(min(a, b));
+                    spec.rightKeys.push_back(max(a, b) - leftWidth);
+                    continue;
                 }
             }
-            if (idx >= 0) {
-                columnIndices.push_back(idx);
-            }
+            rest.push_back(term);
+        }
+        if (!rest.empty() &&
+            !(spec.residual =
+                  BoundExpression::bind(*Expression::conjunction(rest), joinedNames, joinedTypes, &padded))) {
+            return nullptr;
         }
+        spec.leftOuter = join.left;
+        spec.rightWidth = right.names.size();
 
-        for (const auto& record : records) {
-            Record filteredRecord;
-            for (int idx : columnIndices) {
-                filteredRecord.addValue(record.getValue(idx));
+        if (i == 1 && spec.leftKeys.size() == 1 && sources[0].table->hasIndexOn(spec.leftKeys[0]) &&
+            right.table->hasIndexOn(spec.rightKeys[0])) {
+            unique_ptr<Operator> leftScan = planScan(sources[0].table, sources[0].names, sources[0].where,
+                                                     spec.leftKeys[0]);
+            unique_ptr<Operator> rightScan = planScan(right.table, right.names, right.where, spec.rightKeys[0]);
+            if (!leftScan || !rightScan) {
+                return nullptr;
+            }
+            plan.reset(new MergeJoin(move(leftScan), move(rightScan), move(spec), memory));
+        } else {
+            if (!plan && !(plan = planScan(sources[0].table, sources[0].names, sources[0].where))) {
+                return nullptr;
             }
-            result.push_back(filteredRecord);
+            unique_ptr<Operator> rightScan = planScan(right.table, right.names, right.where);
+            if (!rightScan) {
+                return nullptr;
+            }
+            // An inner join of two tables builds its hash table on the smaller
+            bool buildLeft = i == 1 && !join.left &&
+                             sources[0].table->getPageCount() < right.table->getPageCount();
+            plan.reset(new HashJoin(move(plan), move(rightScan), move(spec), memory, buildLeft));
+        }
+        available = joinedNames;
+        types = joinedTypes;
+        padded.resize(available.size(), right.padded);
+    }
+
+    if (!remaining.empty()) {
+        unique_ptr<BoundExpression> predicate =
+            BoundExpression::bind(*Expression::conjunction(remaining), available, types, &padded);
+        if (!predicate) {
+            return nullptr;
+        }
+        plan.reset(new Filter(move(plan), move(predicate)));
+    }
+    return plan;
+}
+
+// Builds the operator tree for a SELECT: a scan (through the indexes when
+// they fit the WHERE clause, else over column batches), then grouping or
+// sorting, LIMIT and the select list. header receives the output column
+// names. Null when the query names something it cannot compute.
+unique_ptr<Operator> Database::planSelect(const ParsedQuery& query, vector<string>& header) {
+    shared_ptr<const Table> table = findTable(query.tableName);
+    if (!table) {
+        return nullptr;
+    }
+    bool grouped = !query.groupByColumn.empty() || !query.aggregates.empty();
+
+    // Every operator of the query reserves from one tracker, which the
+    // operators keep alive for as long as the plan runs
+    shared_ptr<MemoryTracker> memory =
+        make_shared<MemoryTracker>(queryMemory, &memoryBudget, getDatabaseDirectory(currentDatabase));
+    lastQueryMemory = memory;
+
+    // Names and types of the columns the rows carry at this point
+    vector<string> available;
+    vector<ColumnType> availableTypes;
+    auto position = [&available](const string& name) { return BoundExpression::findColumn(available, name); };
+
+    // The WHERE expression of a single table is bound once here; joins
+    // place its terms themselves
+    bool joined = !query.joins.empty();
+    bool hasWhere = !query.conditions.empty() && !joined;
+    shared_ptr<Expression> whereExpression;
+    unique_ptr<BoundExpression> predicate;
+    if (hasWhere) {
+        whereExpression = query.conditions[0].toExpression();
+        predicate = table->bindCondition(query.conditions[0]);
+        if (!predicate) {
+            return nullptr;
+        }
+    }
+    if (!joined) {
+        available = table->getColumns();
+        availableTypes = table->getColumnTypes();
+    }
+
+    // Without a usable index the scan and WHERE run on batches of just the
+    // columns the query names; rows are formed after them, or not at all
+    // when GroupBy consumes the batches. A table of several morsels is
+    // scanned, filtered and partially aggregated on the worker threads.
+    unique_ptr<Operator> plan;
+    unique_ptr<BatchOperator> batches;
+    unique_ptr<ParallelScan> parallelScan;
+    vector<int> batchColumn(available.size(), -1);  // table column -> batch column
+    if (joined) {
+        plan = planJoin(query, available, availableTypes, memory);
+        if (!plan) {
+            return nullptr;
+        }
+    } else if (hasWhere && table->canUseIndex(*predicate)) {
+        plan.reset(new IndexScan(table, move(predicate)));
+    } else if (!vectorized) {
+        plan.reset(new TableScan(table));
+        if (hasWhere) {
+            plan.reset(new Filter(move(plan), move(predicate)));
         }
     } else {
-        result = records;
+        vector<bool> used(available.size(), query.selectAll && !grouped);
+        auto use = [&](const string& name) {
+            int column = position(name);
+            if (column >= 0) used[column] = true;
+        };
+        vector<string> whereColumns;
+        if (hasWhere) whereExpression->collectColumns(whereColumns);
+        for (const auto& name : whereColumns) use(name);
+        use(query.groupByColumn);
+        for (const auto& aggregate : query.aggregates) use(aggregate.column);
+        for (const auto& name : query.columns) use(name);
+        for (const auto& key : query.orderBy) use(key.column);
+
+        vector<int> scanned;
+        vector<string> scannedNames;
+        vector<ColumnType> scannedTypes;
+        for (size_t i = 0; i < used.size(); ++i) {
+            if (used[i]) {
+                batchColumn[i] = static_cast<int>(scanned.size());
+                scanned.push_back(static_cast<int>(i));
+                scannedNames.push_back(available[i]);
+                scannedTypes.push_back(table->getColumnTypes()[i]);
+            }
+        }
+        // Bound again, to the batch's columns
+        unique_ptr<BoundExpression> batchPredicate;
+        if (hasWhere) {
+            batchPredicate = BoundExpression::bind(*whereExpression, scannedNames, scannedTypes);
+        }
+        if (workers->size() > 1 && table->getPageCount() > MORSEL_PAGES) {
+            parallelScan.reset(new ParallelScan(table, scanned, move(batchPredicate), *workers));
+        } else {
+            batches.reset(new BatchScan(table, scanned));
+            if (hasWhere) {
+                batches.reset(new BatchFilter(move(batches), move(batchPredicate)));
+            }
+        }
+        if (!grouped) {
+            vector<int> columns;
+            for (size_t i = 0; i < scanned.size(); ++i) {
+                columns.push_back(static_cast<int>(i));
+            }
+            if (parallelScan) {
+                batches = move(parallelScan);
+            }
+            plan.reset(new BatchToRows(move(batches), columns));
+            available = scannedNames;
+            availableTypes = scannedTypes;
+        }
+    }
+
+    if (grouped) {
+        // A bare GROUP BY counts the rows of each group
+        vector<Aggregate> aggregates = query.aggregates;
+        if (aggregates.empty()) {
+            Aggregate count;
+            count.func = Aggregate::Func::COUNT;
+            count.name = "count(*)";
+            aggregates.push_back(count);
+        }
+
+        int groupColumn = -1;
+        if (!query.groupByColumn.empty() && (groupColumn = position(query.groupByColumn)) < 0) {
+            return nullptr;
+        }
+        // Output rows: the group column, then each aggregate
+        vector<string> output;
+        vector<ColumnType> outputTypes;
+        if (groupColumn >= 0) {
+            output.push_back(available[groupColumn]);
+            outputTypes.push_back(availableTypes[groupColumn]);
+        }
+        vector<Aggregate::Func> funcs;
+        vector<int> inputs;
+        for (const auto& aggregate : aggregates) {
+            int input = aggregate.column.empty() ? -1 : position(aggregate.column);
+            bool numeric = aggregate.func == Aggregate::Func::SUM || aggregate.func == Aggregate::Func::AVG;
+            if ((input < 0 && !(aggregate.func == Aggregate::Func::COUNT && aggregate.column.empty())) ||
+                (numeric && availableTypes[input] == ColumnType::TEXT)) {
+                return nullptr;
+            }
+            funcs.push_back(aggregate.func);
+            inputs.push_back(input);
+            output.push_back(aggregate.name);
+            if (aggregate.func == Aggregate::Func::COUNT) outputTypes.push_back(ColumnType::INT);
+            else if (aggregate.func == Aggregate::Func::AVG) outputTypes.push_back(ColumnType::DOUBLE);
+            else outputTypes.push_back(availableTypes[input]);
+        }
+        GroupBy* groupBy;
+        if (batches || parallelScan) {
+            for (int& input : inputs) {
+                input = input < 0 ? -1 : batchColumn[input];
+            }
+            int batchGroup = groupColumn < 0 ? -1 : batchColumn[groupColumn];
+            if (parallelScan) {
+                groupBy = new GroupBy(move(parallelScan), batchGroup, funcs, inputs, memory);
+            } else {
+                groupBy = new GroupBy(move(batches), batchGroup, funcs, inputs, memory);
+            }
+        } else {
+            groupBy = new GroupBy(move(plan), groupColumn, funcs, inputs, memory);
+        }
+        plan.reset(groupBy);
+        available = output;
+
+        // HAVING is bound to the output rows
+        if (!query.havingConditions.empty()) {
+            unique_ptr<BoundExpression> having =
+                BoundExpression::bind(*query.havingConditions[0].toExpression(), available, outputTypes);
+            if (!having) {
+                return nullptr;
+            }
+            groupBy->setHaving(move(having));
+        }
     }
 
+    size_t end = query.limit > NO_LIMIT - query.offset ? NO_LIMIT : query.offset + query.limit;
+    if (!query.orderBy.empty()) {
+        vector<SortKey> keys;
+        for (const auto& key : query.orderBy) {
+            int column = position(key.column);
+            if (column < 0) {
+                return nullptr;
+            }
+            keys.push_back({column, key.descending});
+        }
+        plan.reset(new Sort(move(plan), keys, end, memory));
+    }
+    if (query.limit != NO_LIMIT || query.offset > 0) {
+        plan.reset(new Limit(move(plan), query.limit, query.offset));
+    }
+
+    // A grouped query can select only grouped columns and aggregates; other
+    // unknown names are left out, as before
+    vector<int> columns;
+    header.clear();
+    if (query.selectAll) {
+        header = available;
+        return plan;
+    }
+    for (const auto& name : query.columns) {
+        int column = position(name);
+        if (column < 0 && grouped) {
+            return nullptr;
+        }
+        if (column >= 0) {
+            columns.push_back(column);
+            header.push_back(name);
+        }
+    }
+    plan.reset(new Project(move(plan), columns));
+    return plan;
+}
+
+vector<Record> Database::select(const string& tableName, const vector<string>& columns,
+                                     const Condition* condition, const vector<OrderKey>& orderBy,
+                                     size_t limit, size_t offset) {
+    ParsedQuery query;
+    query.tableName = tableName;
+    query.columns = columns;
+    query.selectAll = columns.empty() || columns[0] == "*";
+    if (condition) {
+        query.conditions.push_back(*condition);
+    }
+    query.orderBy = orderBy;
+    query.limit = limit;
+    query.offset = offset;
+
+    return runSelect(query);
+}
+
+// The rows of a SELECT; empty when it cannot be planned
+vector<Record> Database::runSelect(const ParsedQuery& query) {
+    vector<Record> result;
+    vector<string> header;
+    unique_ptr<Operator> plan = planSelect(query, header);
+    if (!plan) {
+        return result;
+    }
+    plan->open();
+    Record row;
+    while (plan->next(row)) {
+        result.push_back(move(row));
+    }
+    plan->close();
     return result;
 }
 
 bool Database::deleteRecords(const string& tableName, const Condition& condition) {
-    if (currentDatabase.empty() || databases[currentDatabase].find(tableName) == databases[currentDatabase].end()) {
+    shared_ptr<Table> table = findTable(tableName);
+    if (!table) {
+        return false;
+    }
+    unique_ptr<BoundExpression> predicate = table->bindCondition(condition);
+    if (!predicate) {
         return false;
     }
 
-    shared_ptr<Table> table = databases[currentDatabase][tableName];
-    table->deleteWhere(condition);
-    return table->saveToFile(getTableFilePath(currentDatabase, tableName));
+    WalEntry entry;
+    entry.type = WalEntry::Type::DELETE;
+    entry.tableName = tableName;
+    uint64_t lsn = nextLSN();
+    vector<pair<RecordID, Record>> deleted = table->deleteWhere(*predicate, lsn);
+    for (const auto& row : deleted) {
+        entry.recordIds.push_back(row.first);
+    }
+    if (entry.recordIds.empty() || logChange(entry)) {
+        return true;
+    }
+    // A change that is not in the log must not stay in the table
+    for (size_t i = deleted.size(); i-- > 0;) {
+        table->undoDelete(deleted[i].first, deleted[i].second, lsn);
+    }
+    return false;
 }
@@ -0,0 +1,793 @@
+#include "Expression.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+typedef BoundCondition::Op Op;
+
+shared_ptr<Expression> Expression::comparison(const string& column, const string& op, const string& value) {
+    auto expression = make_shared<Expression>(Kind::COMPARE, op);
+    expression->operands.push_back(make_shared<Expression>(Kind::COLUMN, column));
+    expression->operands.push_back(make_shared<Expression>(Kind::STRING, value));
+    return expression;
+}
+
+void Expression::collectColumns(vector<string>& names) const {
+    if (kind == Kind::COLUMN) {
+        names.push_back(text);
+    }
+    for (const auto& operand : operands) {
+        operand->collectColumns(names);
+    }
+}
+
+void Expression::splitConjuncts(const shared_ptr<Expression>& expression, vector<shared_ptr<Expression>>& terms) {
+    if (expression->kind != Kind::AND) {
+        terms.push_back(expression);
+        return;
+    }
+    for (const auto& operand : expression->operands) {
+        splitConjuncts(operand, terms);
+    }
+}
+
+shared_ptr<Expression> Expression::conjunction(const vector<shared_ptr<Expression>>& terms) {
+    if (terms.size() <= 1) {
+        return terms.empty() ? nullptr : terms[0];
+    }
+    auto expression = make_shared<Expression>(Kind::AND);
+    expression->operands = terms;
+    return expression;
+}
+
+shared_ptr<Expression> Expression::substitute(const shared_ptr<Expression>& expression,
+                                              const vector<shared_ptr<Expression>>& arguments) {
+    if (!expression) {
+        return expression;
+    }
+    if (expression->kind == Kind::PARAMETER) {
+        return arguments[stoul(expression->text)];
+    }
+    shared_ptr<Expression> copy;
+    for (size_t i = 0; i < expression->operands.size(); ++i) {
+        shared_ptr<Expression> operand = substitute(expression->operands[i], arguments);
+        if (operand != expression->operands[i]) {
+            if (!copy) copy = make_shared<Expression>(*expression);
+            copy->operands[i] = operand;
+        }
+    }
+    return copy ? copy : expression;
+}
+
+shared_ptr<Expression> Condition::toExpression() const {
+    return expression ? expression : Expression::comparison(columnName, op, value);
+}
+
+BoundCondition::Op BoundCondition::parseOp(const string& op) {
+    if (op == "=" || op == "==") return Op::EQ;
+    if (op == "!=") return Op::NE;
+    if (op == "<") return Op::LT;
+    if (op == "<=") return Op::LE;
+    if (op == ">") return Op::GT;
+    if (op == ">=") return Op::GE;
+    return Op::INVALID;
+}
+
+bool BoundExpression::test(const Record& row) const {
+    Value scratch;
+    const Value& value = evaluate(row, scratch);
+    return value.isNumeric() && value.asDouble() != 0;
+}
+
+namespace {
+
+bool isNull(const Value& value) {
+    return !value.isNumeric() && value.asText().empty();
+}
+
+class ConstantNode : public BoundExpression {
+private:
+    Value value;
+
+public:
+    explicit ConstantNode(const Value& constant) : value(constant) {}
+    const Value& evaluate(const Record&, Value&) const override { return value; }
+    ColumnType type() const override { return value.getType(); }
+    bool isConstant() const override { return true; }
+    void collectColumns(vector<int>&) const override {}
+    double selectivity() const override { return value.isNumeric() && value.asDouble() != 0 ? 1 : 0; }
+    double cost() const override { return 0; }
+    const Value& get() const { return value; }
+};
+
+class ColumnNode : public BoundExpression {
+private:
+    int column;
+    ColumnType columnType;
+
+public:
+    ColumnNode(int position, ColumnType declared) : column(position), columnType(declared) {}
+    const Value& evaluate(const Record& row, Value&) const override { return row.get(column); }
+    ColumnType type() const override { return columnType; }
+    void collectColumns(vector<int>& columns) const override { columns.push_back(column); }
+    double cost() const override { return 0.5; }
+    int getColumn() const { return column; }
+};
+
+// Predicates produce 1 or 0 when used as values
+class PredicateNode : public BoundExpression {
+public:
+    const Value& evaluate(const Record& row, Value& scratch) const override {
+        scratch = Value::fromInt(test(row) ? 1 : 0);
+        return scratch;
+    }
+    ColumnType type() const override { return ColumnType::INT; }
+};
+
+// Comparison operators, as a test of Value::compare's result and directly
+// on values of one C++ type. Without statistics an equality is taken to
+// keep a tenth of the rows and a range a third.
+struct Eq {
+    static double selectivity() { return 0.1; }
+    static bool holds(int order) { return order == 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a == b; }
+};
+struct Ne {
+    static double selectivity() { return 0.9; }
+    static bool holds(int order) { return order != 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a != b; }
+};
+struct Lt {
+    static double selectivity() { return 1.0 / 3; }
+    static bool holds(int order) { return order < 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a < b; }
+};
+struct Le {
+    static double selectivity() { return 1.0 / 3; }
+    static bool holds(int order) { return order <= 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a <= b; }
+};
+struct Gt {
+    static double selectivity() { return 1.0 / 3; }
+    static bool holds(int order) { return order > 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a > b; }
+};
+struct Ge {
+    static double selectivity() { return 1.0 / 3; }
+    static bool holds(int order) { return order >= 0; }
+    template <typename T> static bool test(const T& a, const T& b) { return a >= b; }
+};
+
+template <typename Cmp>
+class CompareNode : public PredicateNode {
+private:
+    unique_ptr<BoundExpression> left;
+    unique_ptr<BoundExpression> right;
+
+public:
+    CompareNode(unique_ptr<BoundExpression> l, unique_ptr<BoundExpression> r) : left(move(l)), right(move(r)) {}
+    bool test(const Record& row) const override {
+        Value a, b;
+        return Cmp::holds(left->evaluate(row, a).compare(right->evaluate(row, b)));
+    }
+    void collectColumns(vector<int>& columns) const override {
+        left->collectColumns(columns);
+        right->collectColumns(columns);
+    }
+    double selectivity() const override { return Cmp::selectivity(); }
+    double cost() const override { return left->cost() + right->cost() + 1; }
+};
+
+template <typename Cmp>
+class ColumnCompareNode : public PredicateNode {
+protected:
+    BoundCondition condition;
+
+public:
+    explicit ColumnCompareNode(const BoundCondition& bound) : condition(bound) {}
+    bool test(const Record& row) const override {
+        return Cmp::holds(row.get(condition.column).compare(condition.constant));
+    }
+    bool asCondition(BoundCondition& bound) const override {
+        bound = condition;
+        return true;
+    }
+    void collectColumns(vector<int>& columns) const override { columns.push_back(condition.column); }
+    double selectivity() const override { return Cmp::selectivity(); }
+    double cost() const override { return condition.constant.isNumeric() ? 1 : 2; }
+};
+
+template <ColumnType Type> struct Typed;
+template <> struct Typed<ColumnType::INT> {
+    static int64_t get(const Value& value) { return value.asInt(); }
+};
+template <> struct Typed<ColumnType::DOUBLE> {
+    static double get(const Value& value) { return value.asDouble(); }
+};
+template <> struct Typed<ColumnType::TEXT> {
+    static const string& get(const Value& value) { return value.asText(); }
+};
+
+// Column and constant of the same type compare without Value::compare
+template <typename Cmp, ColumnType Type>
+class TypedColumnCompareNode : public ColumnCompareNode<Cmp> {
+public:
+    explicit TypedColumnCompareNode(const BoundCondition& bound) : ColumnCompareNode<Cmp>(bound) {}
+    bool test(const Record& row) const override {
+        const Value& value = row.get(this->condition.column);
+        if (value.getType() != Type) {
+            return Cmp::holds(value.compare(this->condition.constant));
+        }
+        return Cmp::test(Typed<Type>::get(value), Typed<Type>::get(this->condition.constant));
+    }
+};
+
+template <typename Cmp>
+unique_ptr<BoundExpression> makeCompare(unique_ptr<BoundExpression> left, unique_ptr<BoundExpression> right, Op op) {
+    const ColumnNode* column = dynamic_cast<const ColumnNode*>(left.get());
+    const ConstantNode* constant = dynamic_cast<const ConstantNode*>(right.get());
+    if (!column || !constant) {
+        return unique_ptr<BoundExpression>(new CompareNode<Cmp>(move(left), move(right)));
+    }
+
+    BoundCondition bound;
+    bound.column = column->getColumn();
+    bound.op = op;
+    bound.constant = constant->get();
+    if (bound.constant.getType() != column->type()) {
+        return unique_ptr<BoundExpression>(new ColumnCompareNode<Cmp>(bound));
+    }
+    switch (column->type()) {
+        case ColumnType::INT:
+            return unique_ptr<BoundExpression>(new TypedColumnCompareNode<Cmp, ColumnType::INT>(bound));
+        case ColumnType::DOUBLE:
+            return unique_ptr<BoundExpression>(new TypedColumnCompareNode<Cmp, ColumnType::DOUBLE>(bound));
+        default:
+            return unique_ptr<BoundExpression>(new TypedColumnCompareNode<Cmp, ColumnType::TEXT>(bound));
+    }
+}
+
+unique_ptr<BoundExpression> makeCompare(Op op, unique_ptr<BoundExpression> left, unique_ptr<BoundExpression> right) {
+    // A constant on the left is moved to the right
+    if (left->isConstant() && !right->isConstant()) {
+        swap(left, right);
+        switch (op) {
+            case Op::LT: op = Op::GT; break;
+            case Op::LE: op = Op::GE; break;
+            case Op::GT: op = Op::LT; break;
+            case Op::GE: op = Op::LE; break;
+            default: break;
+        }
+    }
+    switch (op) {
+        case Op::EQ: return makeCompare<Eq>(move(left), move(right), op);
+        case Op::NE: return makeCompare<Ne>(move(left), move(right), op);
+        case Op::LT: return makeCompare<Lt>(move(left), move(right), op);
+        case Op::LE: return makeCompare<Le>(move(left), move(right), op);
+        case Op::GT: return makeCompare<Gt>(move(left), move(right), op);
+        case Op::GE: return makeCompare<Ge>(move(left), move(right), op);
+        default: return nullptr;
+    }
+}
+
+// Arithmetic operators: ints() is false when the INT result would overflow,
+// which makes the result a DOUBLE instead
+struct Add {
+    static const bool divides = false;
+    static bool ints(int64_t a, int64_t b, int64_t& result) { return !__builtin_add_overflow(a, b, &result); }
+    static double doubles(double a, double b) { return a + b; }
+};
+struct Subtract {
+    static const bool divides = false;
+    static bool ints(int64_t a, int64_t b, int64_t& result) { return !__builtin_sub_overflow(a, b, &result); }
+    static double doubles(double a, double b) { return a - b; }
+};
+struct Multiply {
+    static const bool divides = false;
+    static bool ints(int64_t a, int64_t b, int64_t& result) { return !__builtin_mul_overflow(a, b, &result); }
+    static double doubles(double a, double b) { return a * b; }
+};
+// INT division truncates, as in SQL
+struct Divide {
+    static const bool divides = true;
+    static bool ints(int64_t a, int64_t b, int64_t& result) {
+        if (b == -1 && a == INT64_MIN) return false;
+        result = a / b;
+        return true;
+    }
+    static double doubles(double a, double b) { return a / b; }
+};
+struct Modulo {
+    static const bool divides = true;
+    static bool ints(int64_t a, int64_t b, int64_t& result) {
+        result = b == -1 ? 0 : a % b;
+        return true;
+    }
+    static double doubles(double a, double b) { return fmod(a, b); }
+};
+
+template <typename Arith>
+class ArithmeticNode : public BoundExpression {
+private:
+    unique_ptr<BoundExpression> left;
+    unique_ptr<BoundExpression> right;
+
+public:
+    ArithmeticNode(unique_ptr<BoundExpression> l, unique_ptr<BoundExpression> r) : left(move(l)), right(move(r)) {}
+
+    const Value& evaluate(const Record& row, Value& scratch) const override {
+        Value a, b;
+        const Value& x = left->evaluate(row, a);
+        const Value& y = right->evaluate(row, b);
+        int64_t result;
+        if (!x.isNumeric() || !y.isNumeric() || (Arith::divides && y.asDouble() == 0)) {
+            scratch = Value();
+        } else if (x.getType() == ColumnType::INT && y.getType() == ColumnType::INT &&
+                   Arith::ints(x.asInt(), y.asInt(), result)) {
+            scratch = Value::fromInt(result);
+        } else {
+            scratch = Value::fromDouble(Arith::doubles(x.asDouble(), y.asDouble()));
+        }
+        return scratch;
+    }
+    ColumnType type() const override {
+        return left->type() == ColumnType::INT && right->type() == ColumnType::INT ? ColumnType::INT
+                                                                                   : ColumnType::DOUBLE;
+    }
+    void collectColumns(vector<int>& columns) const override {
+        left->collectColumns(columns);
+        right->collectColumns(columns);
+    }
+    double cost() const override { return left->cost() + right->cost() + (Arith::divides ? 2 : 1); }
+};
+
+class BetweenNode : public PredicateNode {
+private:
+    unique_ptr<BoundExpression> value;
+    unique_ptr<BoundExpression> low;
+    unique_ptr<BoundExpression> high;
+    bool negated;
+
+public:
+    BetweenNode(unique_ptr<BoundExpression> v, unique_ptr<BoundExpression> l, unique_ptr<BoundExpression> h, bool n)
+        : value(move(v)), low(move(l)), high(move(h)), negated(n) {}
+    bool test(const Record& row) const override {
+        Value a, b, c;
+        const Value& x = value->evaluate(row, a);
+        bool inside = x.compare(low->evaluate(row, b)) >= 0 && x.compare(high->evaluate(row, c)) <= 0;
+        return inside != negated;
+    }
+    void collectColumns(vector<int>& columns) const override {
+        value->collectColumns(columns);
+        low->collectColumns(columns);
+        high->collectColumns(columns);
+    }
+    double selectivity() const override { return negated ? 0.75 : 0.25; }
+    double cost() const override { return value->cost() + low->cost() + high->cost() + 2; }
+};
+
+// A list of constants is kept sorted and binary searched
+class InNode : public PredicateNode {
+private:
+    unique_ptr<BoundExpression> value;
+    vector<unique_ptr<BoundExpression>> items;
+    vector<Value> constants;
+    bool negated;
+
+public:
+    InNode(unique_ptr<BoundExpression> v, vector<unique_ptr<BoundExpression>> list, bool n)
+        : value(move(v)), items(move(list)), negated(n) {
+        bool allConstant = true;
+        for (const auto& item : items) {
+            allConstant = allConstant && item->isConstant();
+        }
+        if (allConstant) {
+            Record none;
+            Value scratch;
+            for (const auto& item : items) {
+                constants.push_back(item->evaluate(none, scratch));
+            }
+            sort(constants.begin(), constants.end());
+            items.clear();
+        }
+    }
+    bool test(const Record& row) const override {
+        Value a, b;
+        const Value& x = value->evaluate(row, a);
+        bool found = binary_search(constants.begin(), constants.end(), x);
+        for (size_t i = 0; i < items.size() && !found; ++i) {
+            found = x == items[i]->evaluate(row, b);
+        }
+        return found != negated;
+    }
+    void collectColumns(vector<int>& columns) const override {
+        value->collectColumns(columns);
+        for (const auto& item : items) {
+            item->collectColumns(columns);
+        }
+    }
+    double selectivity() const override {
+        double found = min(0.5, 0.1 * (constants.size() + items.size()));
+        return negated ? 1 - found : found;
+    }
+    double cost() const override {
+        double total = value->cost() + 1 + log2(1.0 + constants.size());
+        for (const auto& item : items) {
+            total += item->cost() + 1;
+        }
+        return total;
+    }
+};
+
+class IsNullNode : public PredicateNode {
+private:
+    unique_ptr<BoundExpression> value;
+    bool negated;
+
+public:
+    IsNullNode(unique_ptr<BoundExpression> v, bool n) : value(move(v)), negated(n) {}
+    bool test(const Record& row) const override {
+        Value scratch;
+        return isNull(value->evaluate(row, scratch)) != negated;
+    }
+    void collectColumns(vector<int>& columns) const override { value->collectColumns(columns); }
+    double selectivity() const override { return negated ? 0.9 : 0.1; }
+    double cost() const override { return value->cost() + 0.5; }
+};
+
+// NOT of what could not be pushed into a comparison
+class NotNode : public PredicateNode {
+private:
+    unique_ptr<BoundExpression> term;
+
+public:
+    explicit NotNode(unique_ptr<BoundExpression> t) : term(move(t)) {}
+    bool test(const Record& row) const override { return !term->test(row); }
+    void collectColumns(vector<int>& columns) const override { term->collectColumns(columns); }
+    double selectivity() const override { return 1 - term->selectivity(); }
+    double cost() const override { return term->cost() + 0.1; }
+};
+
+// AND or OR. Evaluation stops at the first term that decides the result,
+// so the terms are sorted by their cost per row decided: cost / (1 - s)
+// for AND, where a term decides when it fails, and cost / s for OR.
+template <bool Conjunction>
+class JunctionNode : public PredicateNode {
+private:
+    vector<unique_ptr<BoundExpression>> terms;
+
+    static double decides(const BoundExpression& term) {
+        double s = Conjunction ? 1 - term.selectivity() : term.selectivity();
+        return s > 0 ? term.cost() / s : HUGE_VAL;
+    }
+
+public:
+    explicit JunctionNode(vector<unique_ptr<BoundExpression>> list) : terms(move(list)) {
+        stable_sort(terms.begin(), terms.end(),
+                    [](const unique_ptr<BoundExpression>& a, const unique_ptr<BoundExpression>& b) {
+                        return decides(*a) < decides(*b);
+                    });
+    }
+    bool test(const Record& row) const override {
+        for (const auto& term : terms) {
+            if (term->test(row) != Conjunction) return !Conjunction;
+        }
+        return Conjunction;
+    }
+    bool asJunction(bool& conjunction, vector<const BoundExpression*>& list) const override {
+        conjunction = Conjunction;
+        list.clear();
+        for (const auto& term : terms) {
+            list.push_back(term.get());
+        }
+        return true;
+    }
+    void collectColumns(vector<int>& columns) const override {
+        for (const auto& term : terms) {
+            term->collectColumns(columns);
+        }
+    }
+    double selectivity() const override {
+        double none = 1;  // AND: all hold; OR: none does
+        for (const auto& term : terms) {
+            none *= Conjunction ? term->selectivity() : 1 - term->selectivity();
+        }
+        return Conjunction ? none : 1 - none;
+    }
+    double cost() const override {
+        // Later terms only run on the rows the earlier ones left undecided
+        double total = 0, reached = 1;
+        for (const auto& term : terms) {
+            total += reached * term->cost();
+            reached *= Conjunction ? term->selectivity() : 1 - term->selectivity();
+        }
+        return total;
+    }
+};
+
+class Binder {
+private:
+    const vector<string>& columns;
+    const vector<ColumnType>& types;
+    const vector<bool>* padded;
+
+    bool isPadded(int column) const { return padded && column < static_cast<int>(padded->size()) && (*padded)[column]; }
+
+    // A comparison reading padded columns also requires them to be present
+    unique_ptr<BoundExpression> guard(unique_ptr<BoundExpression> node) const {
+        if (!padded || !node || node->isConstant()) return node;
+        vector<int> read;
+        node->collectColumns(read);
+        sort(read.begin(), read.end());
+        read.erase(unique(read.begin(), read.end()), read.end());
+        vector<unique_ptr<BoundExpression>> terms;
+        for (int column : read) {
+            if (isPadded(column)) {
+                unique_ptr<BoundExpression> value(new ColumnNode(column, types[column]));
+                terms.push_back(unique_ptr<BoundExpression>(new IsNullNode(move(value), true)));
+            }
+        }
+        if (terms.empty()) return node;
+        terms.push_back(move(node));
+        return unique_ptr<BoundExpression>(new JunctionNode<true>(move(terms)));
+    }
+
+    int find(const string& name) const { return BoundExpression::findColumn(columns, name); }
+
+    bool isLiteral(const Expression& expression) const {
+        return expression.kind == Expression::Kind::NUMBER || expression.kind == Expression::Kind::STRING ||
+               (expression.kind == Expression::Kind::COLUMN && find(expression.text) == -1);
+    }
+
+    // Binds the operands compared with each other. Literals take the type
+    // of the first operand that is not one; an unknown name among them is
+    // an unquoted string, as "WHERE name = alice" has always been read.
+    bool bindCompared(const vector<shared_ptr<Expression>>& operands, vector<unique_ptr<BoundExpression>>& bound) const {
+        const BoundExpression* typed = nullptr;
+        bound.resize(operands.size());
+        for (size_t i = 0; i < operands.size(); ++i) {
+            if (!isLiteral(*operands[i])) {
+                if (!(bound[i] = bind(*operands[i]))) return false;
+                if (!typed) typed = bound[i].get();
+            }
+        }
+        ColumnType hint = typed ? typed->type() : ColumnType::TEXT;
+        for (size_t i = 0; i < operands.size(); ++i) {
+            if (bound[i]) continue;
+            if (!typed && operands[i]->kind == Expression::Kind::COLUMN) return false;
+            bound[i] = literal(*operands[i], typed ? &hint : nullptr);
+        }
+        return true;
+    }
+
+    static unique_ptr<BoundExpression> literal(const Expression& expression, const ColumnType* hint) {
+        Value value;
+        if (!hint || !Value::parse(expression.text, *hint, value)) {
+            value = expression.kind == Expression::Kind::STRING && !hint ? Value::fromText(expression.text)
+                                                                        : Value::fromLiteral(expression.text);
+        }
+        return unique_ptr<BoundExpression>(new ConstantNode(value));
+    }
+
+    // Subtrees without columns are evaluated now
+    static unique_ptr<BoundExpression> fold(unique_ptr<BoundExpression> node, bool constant) {
+        if (!node || !constant) {
+            return node;
+        }
+        Record none;
+        Value scratch;
+        Value value = node->evaluate(none, scratch);
+        return unique_ptr<BoundExpression>(new ConstantNode(value));
+    }
+
+    static bool allConstant(const vector<unique_ptr<BoundExpression>>& nodes) {
+        for (const auto& node : nodes) {
+            if (!node->isConstant()) return false;
+        }
+        return true;
+    }
+
+    // The operands of nested ANDs (or ORs) as one list
+    static void collectTerms(const Expression& expression, vector<const Expression*>& terms) {
+        for (const auto& operand : expression.operands) {
+            if (operand->kind == expression.kind) {
+                collectTerms(*operand, terms);
+            } else {
+                terms.push_back(operand.get());
+            }
+        }
+    }
+
+    // The predicate NOT expression stands for, without the NOT, so that
+    // indexes and batch kernels still see plain comparisons; null when
+    // there is none
+    static shared_ptr<Expression> pushNot(const Expression& expression) {
+        typedef Expression::Kind Kind;
+        static const vector<pair<string, string>> inverses = {
+            {"=", "!="}, {"==", "!="}, {"!=", "="}, {"<", ">="}, {"<=", ">"}, {">", "<="}, {">=", "<"}};
+
+        auto negation = make_shared<Expression>(expression);
+        switch (expression.kind) {
+            case Kind::COMPARE:
+                for (const auto& inverse : inverses) {
+                    if (inverse.first == expression.text) {
+                        negation->text = inverse.second;
+                        return negation;
+                    }
+                }
+                return nullptr;
+            case Kind::BETWEEN:
+            case Kind::IN:
+            case Kind::IS_NULL:
+                negation->negated = !expression.negated;
+                return negation;
+            case Kind::AND:
+            case Kind::OR:
+                negation->kind = expression.kind == Kind::AND ? Kind::OR : Kind::AND;
+                for (auto& operand : negation->operands) {
+                    auto term = make_shared<Expression>(Kind::NOT);
+                    term->operands.push_back(operand);
+                    operand = term;
+                }
+                return negation;
+            case Kind::NOT:
+                return expression.operands.size() == 1 ? expression.operands[0] : nullptr;
+            default:
+                return nullptr;
+        }
+    }
+
+    template <typename Arith>
+    static unique_ptr<BoundExpression> arithmetic(vector<unique_ptr<BoundExpression>>& operands) {
+        return unique_ptr<BoundExpression>(new ArithmeticNode<Arith>(move(operands[0]), move(operands[1])));
+    }
+
+public:
+    Binder(const vector<string>& names, const vector<ColumnType>& columnTypes, const vector<bool>* paddedColumns)
+        : columns(names), types(columnTypes), padded(paddedColumns) {}
+
+    unique_ptr<BoundExpression> bind(const Expression& expression) const {
+        typedef Expression::Kind Kind;
+        vector<unique_ptr<BoundExpression>> operands;
+
+        switch (expression.kind) {
+            case Kind::COLUMN: {
+                int column = find(expression.text);
+                if (column < 0) return nullptr;
+                return unique_ptr<BoundExpression>(new ColumnNode(column, types[column]));
+            }
+
+            case Kind::NUMBER:
+            case Kind::STRING:
+                return literal(expression, nullptr);
+
+            case Kind::PARAMETER:  // only bound once it has a value
+                return nullptr;
+
+            case Kind::ARITHMETIC: {
+                if (expression.operands.size() != 2) return nullptr;
+                for (const auto& operand : expression.operands) {
+                    unique_ptr<BoundExpression> node = bind(*operand);
+                    if (!node || node->type() == ColumnType::TEXT) return nullptr;
+                    operands.push_back(move(node));
+                }
+                bool constant = allConstant(operands);
+                unique_ptr<BoundExpression> node;
+                switch (expression.text.empty() ? ' ' : expression.text[0]) {
+                    case '+': node = arithmetic<Add>(operands); break;
+                    case '-': node = arithmetic<Subtract>(operands); break;
+                    case '*': node = arithmetic<Multiply>(operands); break;
+                    case '/': node = arithmetic<Divide>(operands); break;
+                    case '%': node = arithmetic<Modulo>(operands); break;
+                    default: return nullptr;
+                }
+                return fold(move(node), constant);
+            }
+
+            case Kind::COMPARE: {
+                if (expression.operands.size() != 2 || !bindCompared(expression.operands, operands)) return nullptr;
+                bool constant = allConstant(operands);
+                return guard(fold(
+                    makeCompare(BoundCondition::parseOp(expression.text), move(operands[0]), move(operands[1])),
+                    constant));
+            }
+
+            case Kind::BETWEEN: {
+                if (expression.operands.size() != 3 || !bindCompared(expression.operands, operands)) return nullptr;
+                bool constant = allConstant(operands);
+                return guard(fold(unique_ptr<BoundExpression>(new BetweenNode(move(operands[0]), move(operands[1]),
+                                                                              move(operands[2]), expression.negated)),
+                                  constant));
+            }
+
+            case Kind::IN: {
+                if (expression.operands.size() < 2 || !bindCompared(expression.operands, operands)) return nullptr;
+                bool constant = allConstant(operands);
+                unique_ptr<BoundExpression> value = move(operands[0]);
+                operands.erase(operands.begin());
+                return guard(fold(
+                    unique_ptr<BoundExpression>(new InNode(move(value), move(operands), expression.negated)), constant));
+            }
+
+            case Kind::IS_NULL: {
+                if (expression.operands.size() != 1) return nullptr;
+                unique_ptr<BoundExpression> value = bind(*expression.operands[0]);
+                if (!value) return nullptr;
+                // A number column never holds an empty value unless padded
+                const ColumnNode* column = dynamic_cast<const ColumnNode*>(value.get());
+                if (column && value->type() != ColumnType::TEXT && !isPadded(column->getColumn())) {
+                    return unique_ptr<BoundExpression>(new ConstantNode(Value::fromInt(expression.negated ? 1 : 0)));
+                }
+                bool constant = value->isConstant();
+                return fold(unique_ptr<BoundExpression>(new IsNullNode(move(value), expression.negated)), constant);
+            }
+
+            case Kind::NOT: {
+                if (expression.operands.size() != 1) return nullptr;
+                shared_ptr<Expression> pushed = pushNot(*expression.operands[0]);
+                if (pushed) return bind(*pushed);
+                unique_ptr<BoundExpression> term = bind(*expression.operands[0]);
+                if (!term) return nullptr;
+                bool constant = term->isConstant();
+                return fold(unique_ptr<BoundExpression>(new NotNode(move(term))), constant);
+            }
+
+            case Kind::AND:
+            case Kind::OR: {
+                // Constant terms either decide the result or drop out
+                bool conjunction = expression.kind == Kind::AND;
+                vector<const Expression*> terms;
+                collectTerms(expression, terms);
+                Record none;
+                bool decided = false;
+                for (const Expression* term : terms) {
+                    unique_ptr<BoundExpression> node = bind(*term);
+                    if (!node) return nullptr;
+                    if (!node->isConstant()) {
+                        operands.push_back(move(node));
+                    } else if (node->test(none) != conjunction) {
+                        decided = true;
+                    }
+                }
+                if (decided || operands.empty()) {
+                    return unique_ptr<BoundExpression>(new ConstantNode(Value::fromInt(decided != conjunction ? 1 : 0)));
+                }
+                if (operands.size() == 1) {
+                    return move(operands[0]);
+                }
+                if (conjunction) {
+                    return unique_ptr<BoundExpression>(new JunctionNode<true>(move(operands)));
+                }
+                return unique_ptr<BoundExpression>(new JunctionNode<false>(move(operands)));
+            }
+        }
+        return nullptr;
+    }
+};
+
+}  // namespace
+
+int BoundExpression::findColumn(const vector<string>& columns, const string& name) {
+    string lower = Utils::toLower(name);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (Utils::toLower(columns[i]) == lower) return static_cast<int>(i);
+    }
+    if (lower.find('.') != string::npos) {
+        return -1;
+    }
+    int found = -1;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        size_t dot = columns[i].find('.');
+        if (dot != string::npos && Utils::toLower(columns[i].substr(dot + 1)) == lower) {
+            if (found >= 0) return -2;
+            found = static_cast<int>(i);
+        }
+    }
+    return found;
+}
+
+unique_ptr<BoundExpression> BoundExpression::bind(const Expression& expression, const vector<string>& columns,
+                                                  const vector<ColumnType>& types, const vector<bool>* padded) {
+    return Binder(columns, types, padded).bind(expression);
+}
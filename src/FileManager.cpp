@@ -3,6 +3,9 @@
 #include <sstream>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
 #include <iostream>
 using namespace std;
 
@@ -27,7 +30,7 @@ vector<string> FileManager::listFilesInDirectory(const string& dirname) {
     struct dirent* entry;
     while ((entry = readdir(dir)) != nullptr) {
         string filename = entry->d_name;
-        if (filename.find(".tbl") != string::npos) {
+        if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".tbl") == 0) {
             files.push_back(dirname + "/" + filename);
         }
     }
@@ -35,6 +38,26 @@ vector<string> FileManager::listFilesInDirectory(const string& dirname) {
     return files;
 }
 
+vector<string> FileManager::listDirectories(const string& dirname) {
+    vector<string> dirs;
+    DIR* dir = opendir(dirname.c_str());
+    if (!dir) return dirs;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        string path = dirname + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            dirs.push_back(path);
+        }
+    }
+    closedir(dir);
+    return dirs;
+}
+
 string FileManager::readFile(const string& filename) {
     ifstream file(filename);
     if (!file.is_open()) return "";
@@ -73,3 +96,25 @@ bool FileManager::writeLines(const string& filename, const vector<string>& lines
     }
     return file.good();
 }
+
+bool FileManager::writeFileAtomic(const string& filename, const string& content) {
+    string tempName = filename + ".tmp";
+    if (!writeFile(tempName, content)) {
+        return false;
+    }
+
+    int fd = open(tempName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return rename(tempName.c_str(), filename.c_str()) == 0;
+}
+
+bool FileManager::writeLinesAtomic(const string& filename, const vector<string>& lines) {
+    string content;
+    for (const auto& line : lines) {
+        content += line + "\n";
+    }
+    return writeFileAtomic(filename, content);
+}
@@ -0,0 +1,384 @@
+#include "HashAggregate.h"
+#include "Batch.h"
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <queue>
+using namespace std;
+
+bool Aggregate::parseFunc(const string& name, Func& func) {
+    if (name == "count") func = Func::COUNT;
+    else if (name == "sum") func = Func::SUM;
+    else if (name == "avg") func = Func::AVG;
+    else if (name == "min") func = Func::MIN;
+    else if (name == "max") func = Func::MAX;
+    else return false;
+    return true;
+}
+
+HashAggregate::HashAggregate(int group, const vector<Aggregate::Func>& aggregateFuncs,
+                             const vector<int>& aggregateInputs)
+    : groupColumn(group), funcs(aggregateFuncs), inputs(aggregateInputs), slots(16, -1), groupBytes(0) {
+    // Without GROUP BY there is exactly one group, even over no rows
+    if (groupColumn < 0) {
+        findGroup(Value());
+    }
+}
+
+// Equal values hash alike: an integral DOUBLE hashes as the INT it equals
+uint64_t HashAggregate::hashValue(const Value& value) {
+    uint64_t h;
+    if (value.getType() == ColumnType::TEXT) {
+        h = hash<string>()(value.asText());
+    } else if (value.getType() == ColumnType::INT) {
+        h = static_cast<uint64_t>(value.asInt());
+    } else {
+        double number = value.asDouble();
+        if (number == floor(number) && fabs(number) < 9.2e18) {
+            h = static_cast<uint64_t>(static_cast<int64_t>(number));
+        } else {
+            h = hash<double>()(number);
+        }
+    }
+    // splitmix64 finalizer spreads sequential keys over the table
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+size_t HashAggregate::findGroup(const Value& key) {
+    return findGroup(key, hashValue(key));
+}
+
+size_t HashAggregate::findGroup(const Value& key, uint64_t h) {
+    size_t mask = slots.size() - 1;
+    for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+        int32_t index = slots[slot];
+        if (index < 0) {
+            slots[slot] = static_cast<int32_t>(groups.size());
+            groups.push_back({key, h, vector<Accumulator>(funcs.size())});
+            groupBytes += sizeof(Group) + funcs.size() * sizeof(Accumulator) + key.asText().size();
+            // Kept at most half full so probe sequences stay short
+            if (groups.size() * 2 > slots.size()) {
+                grow();
+            }
+            return groups.size() - 1;
+        }
+        const Group& group = groups[index];
+        if (group.hash == h && group.key == key) {
+            return index;
+        }
+    }
+}
+
+void HashAggregate::grow() {
+    slots.assign(slots.size() * 2, -1);
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        size_t slot = groups[i].hash & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = static_cast<int32_t>(i);
+    }
+}
+
+// An empty value, such as a column LEFT JOIN padded, is skipped the way
+// SQL skips NULL
+static bool isEmpty(const Value& value) {
+    return value.getType() == ColumnType::TEXT && value.asText().empty();
+}
+
+void HashAggregate::add(const Record& record) {
+    Group& group = groups[groupColumn < 0 ? 0 : findGroup(record.get(groupColumn))];
+    for (size_t i = 0; i < funcs.size(); ++i) {
+        Accumulator& acc = group.accumulators[i];
+        if (inputs[i] < 0) {
+            acc.count++;
+            continue;
+        }
+
+        const Value& value = record.get(inputs[i]);
+        if (isEmpty(value)) {
+            continue;
+        }
+        acc.count++;
+        switch (funcs[i]) {
+            case Aggregate::Func::SUM:
+            case Aggregate::Func::AVG:
+                if (value.getType() != ColumnType::INT) {
+                    acc.exact = false;
+                } else if (acc.exact && __builtin_add_overflow(acc.intSum, value.asInt(), &acc.intSum)) {
+                    acc.exact = false;
+                }
+                acc.doubleSum += value.asDouble();
+                break;
+            case Aggregate::Func::MIN:
+                if (acc.count == 1 || value < acc.extreme) acc.extreme = value;
+                break;
+            case Aggregate::Func::MAX:
+                if (acc.count == 1 || acc.extreme < value) acc.extreme = value;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void HashAggregate::addBatch(const Batch& batch) {
+    const uint32_t* rows = batch.selection.data();
+    size_t n = batch.selection.size();
+
+    // Group lookups first, so each aggregate below is one pass over a column
+    groupOf.assign(n, 0);
+    if (groupColumn >= 0) {
+        const ColumnVector& keys = batch.columns[groupColumn];
+        for (size_t i = 0; i < n; ++i) {
+            groupOf[i] = static_cast<uint32_t>(findGroup(keys.get(rows[i])));
+        }
+    }
+
+    for (size_t a = 0; a < funcs.size(); ++a) {
+        auto accumulator = [this, a](size_t i) -> Accumulator& {
+            return groups[groupOf[i]].accumulators[a];
+        };
+        const ColumnVector* input = inputs[a] < 0 ? nullptr : &batch.columns[inputs[a]];
+        if (!input || funcs[a] == Aggregate::Func::COUNT) {
+            bool skipEmpty = input && !input->isNumeric();
+            for (size_t i = 0; i < n; ++i) {
+                if (!skipEmpty || !input->texts[rows[i]].empty()) {
+                    accumulator(i).count++;
+                }
+            }
+            continue;
+        }
+
+        const ColumnVector& column = *input;
+        bool sum = funcs[a] == Aggregate::Func::SUM || funcs[a] == Aggregate::Func::AVG;
+        bool min = funcs[a] == Aggregate::Func::MIN;
+        if (sum && column.type == ColumnType::INT) {
+            const int64_t* values = column.ints.data();
+            for (size_t i = 0; i < n; ++i) {
+                Accumulator& acc = accumulator(i);
+                int64_t value = values[rows[i]];
+                acc.count++;
+                if (acc.exact && __builtin_add_overflow(acc.intSum, value, &acc.intSum)) {
+                    acc.exact = false;
+                }
+                acc.doubleSum += static_cast<double>(value);
+            }
+        } else if (sum && column.type == ColumnType::DOUBLE) {
+            const double* values = column.doubles.data();
+            for (size_t i = 0; i < n; ++i) {
+                Accumulator& acc = accumulator(i);
+                acc.count++;
+                acc.exact = false;
+                acc.doubleSum += values[rows[i]];
+            }
+        } else if (!sum && column.type == ColumnType::INT) {
+            const int64_t* values = column.ints.data();
+            for (size_t i = 0; i < n; ++i) {
+                Accumulator& acc = accumulator(i);
+                int64_t value = values[rows[i]];
+                if (acc.count++ == 0 || (min ? value < acc.extreme.asInt() : value > acc.extreme.asInt())) {
+                    acc.extreme = Value::fromInt(value);
+                }
+            }
+        } else if (!sum && column.type == ColumnType::DOUBLE) {
+            const double* values = column.doubles.data();
+            for (size_t i = 0; i < n; ++i) {
+                Accumulator& acc = accumulator(i);
+                double value = values[rows[i]];
+                if (acc.count++ == 0 || (min ? value < acc.extreme.asDouble() : value > acc.extreme.asDouble())) {
+                    acc.extreme = Value::fromDouble(value);
+                }
+            }
+        } else if (!sum) {
+            const string* values = column.texts.data();
+            for (size_t i = 0; i < n; ++i) {
+                Accumulator& acc = accumulator(i);
+                const string& value = values[rows[i]];
+                if (value.empty()) continue;
+                if (acc.count++ == 0 || (min ? value < acc.extreme.asText() : value > acc.extreme.asText())) {
+                    acc.extreme = Value::fromText(value);
+                }
+            }
+        } else {
+            // SUM / AVG of text; the planner does not allow it
+            for (size_t i = 0; i < n; ++i) {
+                accumulator(i).count++;
+                accumulator(i).exact = false;
+            }
+        }
+    }
+}
+
+void HashAggregate::mergeGroup(const Group& source) {
+    Group& group = groups[groupColumn < 0 ? 0 : findGroup(source.key, source.hash)];
+    for (size_t i = 0; i < funcs.size(); ++i) {
+        Accumulator& acc = group.accumulators[i];
+        const Accumulator& part = source.accumulators[i];
+        if (part.count == 0) {
+            continue;
+        }
+        bool first = acc.count == 0;
+        acc.count += part.count;
+        if (!part.exact || (acc.exact && __builtin_add_overflow(acc.intSum, part.intSum, &acc.intSum))) {
+            acc.exact = false;
+        }
+        acc.doubleSum += part.doubleSum;
+        if (funcs[i] == Aggregate::Func::MIN && (first || part.extreme < acc.extreme)) {
+            acc.extreme = part.extreme;
+        } else if (funcs[i] == Aggregate::Func::MAX && (first || acc.extreme < part.extreme)) {
+            acc.extreme = part.extreme;
+        }
+    }
+}
+
+void HashAggregate::merge(const HashAggregate& other) {
+    for (const Group& source : other.groups) {
+        mergeGroup(source);
+    }
+}
+
+vector<Record> HashAggregate::finishWith(const vector<unique_ptr<HashAggregate>>& parts, ThreadPool& pool) {
+    vector<const HashAggregate*> filled(1, this);
+    size_t groupCount = groups.size();
+    for (const auto& part : parts) {
+        if (part) {
+            filled.push_back(part.get());
+            groupCount += part->groups.size();
+        }
+    }
+    if (groupColumn < 0 || filled.size() <= 2) {
+        for (size_t i = 1; i < filled.size(); ++i) {
+            merge(*filled[i]);
+        }
+        return finish();
+    }
+
+    // Several partitions per thread, so that a partition holding more
+    // groups than the others is balanced out by stealing the rest. Each
+    // table first lists its groups by partition.
+    size_t partitions = min<size_t>(256, max<size_t>(1, min(pool.size() * 8, groupCount / 1024 + 1)));
+    vector<vector<vector<uint32_t>>> members(filled.size(), vector<vector<uint32_t>>(partitions));
+    pool.run(filled.size(), [&](size_t part, size_t) {
+        const vector<Group>& source = filled[part]->groups;
+        for (size_t i = 0; i < source.size(); ++i) {
+            members[part][partitionOf(source[i].hash, partitions)].push_back(static_cast<uint32_t>(i));
+        }
+    });
+
+    vector<vector<Record>> results(partitions);
+    pool.run(partitions, [&](size_t partition, size_t) {
+        HashAggregate merged(groupColumn, funcs, inputs);
+        for (size_t part = 0; part < filled.size(); ++part) {
+            for (uint32_t index : members[part][partition]) {
+                merged.mergeGroup(filled[part]->groups[index]);
+            }
+        }
+        results[partition] = merged.finish();
+    });
+
+    // Each partition comes out in group order; a heap of their heads
+    // merges them
+    typedef pair<size_t, size_t> Cursor;  // (partition, row)
+    auto after = [&results](const Cursor& a, const Cursor& b) {
+        return results[b.first][b.second].get(0) < results[a.first][a.second].get(0);
+    };
+    priority_queue<Cursor, vector<Cursor>, decltype(after)> heads(after);
+    size_t total = 0;
+    for (size_t partition = 0; partition < partitions; ++partition) {
+        if (!results[partition].empty()) {
+            heads.push(Cursor(partition, 0));
+            total += results[partition].size();
+        }
+    }
+    vector<Record> rows;
+    rows.reserve(total);
+    while (!heads.empty()) {
+        Cursor head = heads.top();
+        heads.pop();
+        rows.push_back(move(results[head.first][head.second]));
+        if (++head.second < results[head.first].size()) {
+            heads.push(head);
+        }
+    }
+    return rows;
+}
+
+// A state is the group value, then per aggregate its count, integer sum,
+// whether that sum is exact, the floating point sum and the extreme value
+void HashAggregate::spill(vector<unique_ptr<SpillFile>>& partitions) {
+    for (const Group& group : groups) {
+        Record state;
+        state.addValue(group.key);
+        for (const Accumulator& acc : group.accumulators) {
+            state.addValue(Value::fromInt(acc.count));
+            state.addValue(Value::fromInt(acc.intSum));
+            state.addValue(Value::fromInt(acc.exact ? 1 : 0));
+            state.addValue(Value::fromDouble(acc.doubleSum));
+            state.addValue(acc.extreme);
+        }
+        partitions[partitionOf(group.hash, partitions.size())]->write(state);
+    }
+    groups.clear();
+    slots.assign(16, -1);
+    groupBytes = 0;
+}
+
+void HashAggregate::mergeState(const Record& state) {
+    Group source{state.get(0), hashValue(state.get(0)), vector<Accumulator>(funcs.size())};
+    for (size_t i = 0; i < funcs.size(); ++i) {
+        Accumulator& acc = source.accumulators[i];
+        size_t field = 1 + i * 5;
+        acc.count = state.get(field).asInt();
+        acc.intSum = state.get(field + 1).asInt();
+        acc.exact = state.get(field + 2).asInt() != 0;
+        acc.doubleSum = state.get(field + 3).asDouble();
+        acc.extreme = state.get(field + 4);
+    }
+    mergeGroup(source);
+}
+
+// Aggregates over no rows come back empty, as SQL's NULL would
+Value HashAggregate::finalValue(size_t aggregate, const Accumulator& acc) const {
+    switch (funcs[aggregate]) {
+        case Aggregate::Func::COUNT:
+            return Value::fromInt(acc.count);
+        case Aggregate::Func::SUM:
+            if (acc.count == 0) return Value();
+            return acc.exact ? Value::fromInt(acc.intSum) : Value::fromDouble(acc.doubleSum);
+        case Aggregate::Func::AVG:
+            if (acc.count == 0) return Value();
+            return Value::fromDouble((acc.exact ? static_cast<double>(acc.intSum) : acc.doubleSum) / acc.count);
+        default:
+            return acc.extreme;
+    }
+}
+
+vector<Record> HashAggregate::finish() const {
+    vector<const Group*> order;
+    for (const auto& group : groups) {
+        order.push_back(&group);
+    }
+    sort(order.begin(), order.end(), [](const Group* a, const Group* b) {
+        return a->key < b->key;
+    });
+
+    vector<Record> result;
+    result.reserve(order.size());
+    for (const Group* group : order) {
+        Record row;
+        if (groupColumn >= 0) {
+            row.addValue(group->key);
+        }
+        for (size_t i = 0; i < funcs.size(); ++i) {
+            row.addValue(finalValue(i, group->accumulators[i]));
+        }
+        result.push_back(move(row));
+    }
+    return result;
+}
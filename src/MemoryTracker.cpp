@@ -0,0 +1,73 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+using namespace std;
+
+// Reservations of less than this take the full amount, so the shared
+// counters are not touched for every row
+static const size_t RESERVE_CHUNK = 64 * 1024;
+
+MemoryBudget::MemoryBudget(size_t limitBytes) : limit(limitBytes), used(0) {}
+
+bool MemoryBudget::reserve(size_t bytes) {
+    if (used.fetch_add(bytes) + bytes > limit) {
+        used -= bytes;
+        return false;
+    }
+    return true;
+}
+
+void MemoryBudget::release(size_t bytes) {
+    used -= bytes;
+}
+
+MemoryTracker::MemoryTracker(size_t limitBytes, MemoryBudget* shared, const string& directory)
+    : limit(limitBytes), budget(shared), spillDirectory(directory), used(0), peak(0), spills(0) {}
+
+MemoryTracker::~MemoryTracker() {
+    if (budget) {
+        budget->release(used);
+    }
+}
+
+bool MemoryTracker::reserve(size_t bytes) {
+    size_t now = used.fetch_add(bytes) + bytes;
+    if (now > limit || (budget && !budget->reserve(bytes))) {
+        used -= bytes;
+        return false;
+    }
+    size_t high = peak;
+    while (now > high && !peak.compare_exchange_weak(high, now)) {
+    }
+    return true;
+}
+
+void MemoryTracker::release(size_t bytes) {
+    used -= bytes;
+    if (budget) {
+        budget->release(bytes);
+    }
+}
+
+bool MemoryReservation::resize(size_t bytes) {
+    if (bytes <= held || !tracker) {
+        held = max(held, bytes);
+        return true;
+    }
+    size_t more = bytes - held;
+    if (more < RESERVE_CHUNK && tracker->reserve(RESERVE_CHUNK)) {
+        held += RESERVE_CHUNK;
+        return true;
+    }
+    if (!tracker->reserve(more)) {
+        return false;
+    }
+    held += more;
+    return true;
+}
+
+void MemoryReservation::release() {
+    if (tracker && held > 0) {
+        tracker->release(held);
+    }
+    held = 0;
+}
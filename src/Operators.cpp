@@ -0,0 +1,840 @@
+#include "Operators.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+TableScan::TableScan(shared_ptr<const Table> source)
+    : table(source), pageID(0), position(0) {}
+
+void TableScan::open() {
+    pageID = 0;
+    page.clear();
+    position = 0;
+}
+
+bool TableScan::next(Record& row) {
+    while (position == page.size()) {
+        if (++pageID >= table->getPageCount()) {
+            return false;
+        }
+        page.clear();
+        position = 0;
+        table->scanPage(pageID, [this](RecordID, const Record& record) {
+            page.push_back(record);
+        });
+    }
+    row = move(page[position++]);
+    return true;
+}
+
+void TableScan::close() {
+    page.clear();
+}
+
+BatchToRows::BatchToRows(unique_ptr<BatchOperator> child, const vector<int>& outputColumns)
+    : input(move(child)), columns(outputColumns), position(0) {}
+
+void BatchToRows::open() {
+    input->open();
+    batch.selection.clear();
+    position = 0;
+}
+
+bool BatchToRows::next(Record& row) {
+    while (position >= batch.selection.size()) {
+        position = 0;
+        if (!input->next(batch)) {
+            // Stays at the end when asked again, as Limit does
+            batch.selection.clear();
+            return false;
+        }
+    }
+    uint32_t source = batch.selection[position++];
+    row = Record();
+    for (int column : columns) {
+        row.addValue(batch.columns[column].get(source));
+    }
+    return true;
+}
+
+void BatchToRows::close() {
+    input->close();
+}
+
+IndexScan::IndexScan(shared_ptr<const Table> source, unique_ptr<BoundExpression> condition)
+    : table(source), predicate(move(condition)), position(0) {}
+
+void IndexScan::open() {
+    rids.clear();
+    position = 0;
+    table->indexLookup(*predicate, rids);
+}
+
+bool IndexScan::next(Record& row) {
+    while (position < rids.size()) {
+        if (table->readRow(rids[position++], row) && predicate->test(row)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IndexScan::close() {
+    rids.clear();
+}
+
+IndexOrderScan::IndexOrderScan(shared_ptr<const Table> source, int indexedColumn)
+    : table(source), column(indexedColumn), position(0) {}
+
+void IndexOrderScan::open() {
+    rids.clear();
+    position = 0;
+    table->indexOrder(column, rids);
+}
+
+bool IndexOrderScan::next(Record& row) {
+    while (position < rids.size()) {
+        if (table->readRow(rids[position++], row)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IndexOrderScan::close() {
+    rids.clear();
+}
+
+Filter::Filter(unique_ptr<Operator> child, unique_ptr<BoundExpression> condition)
+    : input(move(child)), predicate(move(condition)) {}
+
+void Filter::open() {
+    input->open();
+}
+
+bool Filter::next(Record& row) {
+    while (input->next(row)) {
+        if (predicate->test(row)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Filter::close() {
+    input->close();
+}
+
+Project::Project(unique_ptr<Operator> child, const vector<int>& outputColumns)
+    : input(move(child)), columns(outputColumns) {}
+
+void Project::open() {
+    input->open();
+}
+
+bool Project::next(Record& row) {
+    if (!input->next(source)) {
+        return false;
+    }
+    row = Record();
+    for (int column : columns) {
+        row.addValue(source.get(column));
+    }
+    return true;
+}
+
+void Project::close() {
+    input->close();
+}
+
+// Memory a row holds, roughly
+static size_t rowBytes(const Record& row) {
+    size_t bytes = sizeof(Record);
+    for (size_t i = 0; i < row.getSize(); ++i) {
+        bytes += sizeof(Value) + row.get(i).asText().size();
+    }
+    return bytes;
+}
+
+Sort::Sort(unique_ptr<Operator> child, const vector<SortKey>& sortKeys, size_t maxRows,
+           shared_ptr<MemoryTracker> tracker)
+    : input(move(child)), keys(sortKeys), limit(maxRows), memory(move(tracker)), position(0) {}
+
+void Sort::open() {
+    input->open();
+    rows.clear();
+    runs.clear();
+    merger.reset();
+    memory.release();
+    position = 0;
+    Record row;
+    if (limit != NO_LIMIT) {
+        TopN top(keys, limit);
+        while (input->next(row)) {
+            top.add(row);
+        }
+        rows = top.finish();
+    } else {
+        bool spilling = true;
+        size_t bytes = 0;
+        while (input->next(row)) {
+            bytes += rowBytes(row);
+            rows.push_back(move(row));
+            if (spilling && !memory.resize(bytes)) {
+                // Without a usable spill file everything stays in memory
+                spilling = spillRun();
+                if (spilling) {
+                    memory.release();
+                    bytes = 0;
+                }
+            }
+        }
+        RowSort::sort(rows, keys);
+        if (!runs.empty()) {
+            startMerge();
+        }
+    }
+    input->close();
+}
+
+static const size_t MAX_SORT_RUNS = 256;
+
+// Each run file reads and writes through a buffer of this size, so the
+// number merged at once is what the query's memory limit can buffer
+size_t Sort::runBufferBytes() const {
+    return max<size_t>(64 * 1024, min<size_t>(1024 * 1024, memory.getLimit() / 8));
+}
+
+size_t Sort::mergeFanIn() const {
+    return max<size_t>(2, min<size_t>(MAX_SORT_RUNS, memory.getLimit() / runBufferBytes()));
+}
+
+bool Sort::spillRun() {
+    RowSort::sort(rows, keys);
+    unique_ptr<SpillFile> run(new SpillFile(memory.getSpillDirectory(), runBufferBytes()));
+    for (const auto& row : rows) {
+        if (!run->write(row)) {
+            return false;
+        }
+    }
+    runs.push_back(move(run));
+    rows.clear();
+    memory.noteSpill();
+    // Each run holds a file open; a small memory limit must not run out of them
+    if (runs.size() >= MAX_SORT_RUNS) {
+        reduceRuns(MAX_SORT_RUNS / 2);
+    }
+    return true;
+}
+
+// Merges runs[first .. last) into one run; null when it cannot be written
+unique_ptr<SpillFile> Sort::mergeRuns(size_t first, size_t last) {
+    unique_ptr<SpillFile> merged(new SpillFile(memory.getSpillDirectory(), runBufferBytes()));
+    LoserTree tree(keys, last - first);
+    for (size_t i = first; i < last; ++i) {
+        runs[i]->rewind();
+        if (!runs[i]->read(tree.head(i - first))) {
+            tree.setExhausted(i - first);
+        }
+    }
+    tree.build();
+    while (!tree.empty()) {
+        size_t run = tree.winner();
+        if (!merged->write(tree.head(run))) {
+            return nullptr;
+        }
+        if (!runs[first + run]->read(tree.head(run))) {
+            tree.setExhausted(run);
+        }
+        tree.replay();
+    }
+    return merged;
+}
+
+// Merges neighbouring runs into longer ones, as many at a time as there
+// are buffers, until at most target are left (or a merge cannot be
+// written). Merging neighbours keeps rows that sort equal in input order.
+void Sort::reduceRuns(size_t target) {
+    size_t fanIn = mergeFanIn();
+    bool failed = false;
+    while (!failed && runs.size() > target) {
+        vector<unique_ptr<SpillFile>> merged;
+        for (size_t first = 0; first < runs.size(); first += fanIn) {
+            size_t last = min(runs.size(), first + fanIn);
+            unique_ptr<SpillFile> run;
+            if (!failed && last - first > 1) {
+                run = mergeRuns(first, last);
+                failed = !run;
+            }
+            if (run) {
+                merged.push_back(move(run));
+            } else {
+                for (size_t i = first; i < last; ++i) {
+                    merged.push_back(move(runs[i]));
+                }
+            }
+        }
+        runs.swap(merged);
+    }
+}
+
+void Sort::startMerge() {
+    // One buffer is left for the rows still in memory
+    reduceRuns(mergeFanIn() - 1);
+
+    // The rows still in memory are the newest run, so they come last
+    merger.reset(new LoserTree(keys, runs.size() + 1));
+    for (size_t run = 0; run <= runs.size(); ++run) {
+        if (run < runs.size()) {
+            runs[run]->rewind();
+        }
+        advanceRun(run);
+    }
+    merger->build();
+}
+
+void Sort::advanceRun(size_t run) {
+    bool more;
+    if (run < runs.size()) {
+        more = runs[run]->read(merger->head(run));
+    } else {
+        more = position < rows.size();
+        if (more) {
+            merger->head(run) = move(rows[position++]);
+        }
+    }
+    if (!more) {
+        merger->setExhausted(run);
+    }
+}
+
+bool Sort::next(Record& row) {
+    if (merger) {
+        if (merger->empty()) {
+            return false;
+        }
+        size_t run = merger->winner();
+        row = move(merger->head(run));
+        advanceRun(run);
+        merger->replay();
+        return true;
+    }
+    if (position == rows.size()) {
+        return false;
+    }
+    row = move(rows[position++]);
+    return true;
+}
+
+void Sort::close() {
+    rows.clear();
+    runs.clear();
+    merger.reset();
+    memory.release();
+}
+
+GroupBy::GroupBy(unique_ptr<Operator> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+                 const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory)
+    : input(move(child)), groupColumn(group), funcs(aggregateFuncs), inputs(aggregateInputs),
+      tracker(move(memory)), position(0), canSpill(true) {}
+
+GroupBy::GroupBy(unique_ptr<BatchOperator> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+                 const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory)
+    : batchInput(move(child)), groupColumn(group), funcs(aggregateFuncs), inputs(aggregateInputs),
+      tracker(move(memory)), position(0), canSpill(true) {}
+
+GroupBy::GroupBy(unique_ptr<ParallelScan> child, int group, const vector<Aggregate::Func>& aggregateFuncs,
+                 const vector<int>& aggregateInputs, shared_ptr<MemoryTracker> memory)
+    : parallelInput(move(child)), groupColumn(group), funcs(aggregateFuncs), inputs(aggregateInputs),
+      tracker(move(memory)), position(0), canSpill(true) {}
+
+void GroupBy::setHaving(unique_ptr<BoundExpression> predicate) {
+    having = move(predicate);
+}
+
+// Enough partitions for one to fit in memory while the whole table is
+// many times the limit
+static const size_t GROUP_SPILL_PARTITIONS = 64;
+
+// Moves the groups of aggregate to the partition files, which the first
+// spill creates; false when they cannot be created
+bool GroupBy::spill(HashAggregate& aggregate) {
+    lock_guard<mutex> lock(spillLock);
+    if (!canSpill || groupColumn < 0) {
+        return false;
+    }
+    if (partitions.empty()) {
+        for (size_t i = 0; i < GROUP_SPILL_PARTITIONS; ++i) {
+            partitions.emplace_back(new SpillFile(tracker ? tracker->getSpillDirectory() : ""));
+            if (!partitions.back()->isOpen()) {
+                partitions.clear();
+                canSpill = false;
+                return false;
+            }
+        }
+    }
+    aggregate.spill(partitions);
+    if (tracker) {
+        tracker->noteSpill();
+    }
+    return true;
+}
+
+// Aggregates the states of each partition on its own and writes its groups
+// back in order, for next() to merge
+void GroupBy::mergePartitions() {
+    MemoryReservation memory(tracker);
+    for (auto& partition : partitions) {
+        HashAggregate aggregate(groupColumn, funcs, inputs);
+        Record state;
+        partition->rewind();
+        while (partition->read(state)) {
+            aggregate.mergeState(state);
+        }
+        memory.resize(aggregate.getMemoryBytes());
+        partition.reset(new SpillFile(tracker ? tracker->getSpillDirectory() : ""));
+        for (const Record& group : aggregate.finish()) {
+            partition->write(group);
+        }
+        memory.release();
+    }
+
+    merger.reset(new LoserTree({SortKey{0, false}}, partitions.size()));
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        partitions[i]->rewind();
+        if (!partitions[i]->read(merger->head(i))) {
+            merger->setExhausted(i);
+        }
+    }
+    merger->build();
+}
+
+void GroupBy::open() {
+    HashAggregate aggregate(groupColumn, funcs, inputs);
+    groups.clear();
+    partitions.clear();
+    merger.reset();
+    canSpill = true;
+    if (parallelInput) {
+        // Every thread aggregates the morsels it reads into a table of its
+        // own. Which morsels those are varies, so a sum of DOUBLE values
+        // can differ in its last bits from run to run.
+        size_t threads = parallelInput->getPool().size();
+        vector<unique_ptr<HashAggregate>> locals(threads);
+        vector<MemoryReservation> memory;
+        for (size_t i = 0; i < threads; ++i) {
+            memory.emplace_back(tracker);
+        }
+        auto visit = [&](size_t, size_t thread, Batch& batch) {
+            if (!locals[thread]) {
+                locals[thread].reset(new HashAggregate(groupColumn, funcs, inputs));
+            }
+            locals[thread]->addBatch(batch);
+            if (!memory[thread].resize(locals[thread]->getMemoryBytes()) && spill(*locals[thread])) {
+                memory[thread].release();
+            }
+        };
+        size_t morsels;
+        parallelInput->open();
+        while (parallelInput->nextWave(visit, morsels)) {
+        }
+        parallelInput->close();
+        if (partitions.empty()) {
+            groups = aggregate.finishWith(locals, parallelInput->getPool());
+        } else {
+            for (auto& local : locals) {
+                if (local) {
+                    spill(*local);
+                }
+            }
+        }
+    } else {
+        MemoryReservation memory(tracker);
+        if (batchInput) {
+            Batch batch;
+            batchInput->open();
+            while (batchInput->next(batch)) {
+                aggregate.addBatch(batch);
+                if (!memory.resize(aggregate.getMemoryBytes()) && spill(aggregate)) {
+                    memory.release();
+                }
+            }
+            batchInput->close();
+        } else {
+            Record row;
+            input->open();
+            while (input->next(row)) {
+                aggregate.add(row);
+                if (!memory.resize(aggregate.getMemoryBytes()) && spill(aggregate)) {
+                    memory.release();
+                }
+            }
+            input->close();
+        }
+        if (partitions.empty()) {
+            groups = aggregate.finish();
+        } else {
+            spill(aggregate);
+        }
+    }
+    if (!partitions.empty()) {
+        mergePartitions();
+    }
+    position = 0;
+}
+
+bool GroupBy::next(Record& row) {
+    if (merger) {
+        while (!merger->empty()) {
+            size_t partition = merger->winner();
+            row = move(merger->head(partition));
+            if (!partitions[partition]->read(merger->head(partition))) {
+                merger->setExhausted(partition);
+            }
+            merger->replay();
+            if (!having || having->test(row)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    while (position < groups.size()) {
+        Record& group = groups[position++];
+        if (!having || having->test(group)) {
+            row = move(group);
+            return true;
+        }
+    }
+    return false;
+}
+
+void GroupBy::close() {
+    groups.clear();
+    partitions.clear();
+    merger.reset();
+}
+
+// Keys are equal exactly when Value::compare finds them equal: numbers by
+// value whatever their type, text by its bytes
+static void joinKey(const Record& row, const vector<int>& columns, string& key) {
+    key.clear();
+    for (int column : columns) {
+        const Value& value = row.get(column);
+        if (value.isNumeric()) {
+            double number = value.asDouble();
+            int64_t integer = value.getType() == ColumnType::INT ? value.asInt() : static_cast<int64_t>(number);
+            if (value.getType() == ColumnType::INT || (number == floor(number) && fabs(number) < 9.2e18)) {
+                key += 'i';
+                key.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+            } else {
+                key += 'd';
+                key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+            }
+        } else {
+            uint32_t length = static_cast<uint32_t>(value.asText().size());
+            key += 't';
+            key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            key += value.asText();
+        }
+    }
+}
+
+static void joinRows(const Record& left, const Record& right, Record& row) {
+    row = left;
+    for (size_t i = 0; i < right.getSize(); ++i) {
+        row.addValue(right.get(i));
+    }
+}
+
+static void padRow(const Record& left, size_t width, Record& row) {
+    row = left;
+    for (size_t i = 0; i < width; ++i) {
+        row.addValue(Value());
+    }
+}
+
+static const size_t MAX_JOIN_PARTITIONS = 256;
+
+HashJoin::HashJoin(unique_ptr<Operator> leftInput, unique_ptr<Operator> rightInput, JoinSpec join,
+                   shared_ptr<MemoryTracker> tracker, bool buildOnLeft)
+    : left(move(leftInput)), right(move(rightInput)), spec(move(join)), memory(move(tracker)),
+      buildLeft(buildOnLeft && !spec.leftOuter), partition(0), probeOpen(false), matches(nullptr),
+      matchPosition(0), pending(false), matched(false) {}
+
+void HashJoin::indexBuildRows() {
+    buckets.clear();
+    for (size_t i = 0; i < buildRows.size(); ++i) {
+        joinKey(buildRows[i], buildKeys(), key);
+        buckets[key].push_back(static_cast<uint32_t>(i));
+    }
+}
+
+// Every build row and then every probe row goes to the partition of its
+// key's hash, with enough partitions for each to fit in memory when keys
+// are spread evenly
+void HashJoin::partitionInputs(unique_ptr<SpillFile> overflow, size_t bytes) {
+    size_t total = bytes + overflow->getByteCount();
+    size_t count = min(MAX_JOIN_PARTITIONS, max<size_t>(2, 2 * total / max<size_t>(memory.getLimit(), 1) + 1));
+    for (size_t i = 0; i < count; ++i) {
+        buildParts.emplace_back(new SpillFile(memory.getSpillDirectory()));
+        probeParts.emplace_back(new SpillFile(memory.getSpillDirectory()));
+    }
+    hash<string> hasher;
+    auto partitionOf = [&](const Record& row, const vector<int>& keys) {
+        joinKey(row, keys, key);
+        return (hasher(key) >> 8) % count;
+    };
+
+    for (const Record& row : buildRows) {
+        buildParts[partitionOf(row, buildKeys())]->write(row);
+    }
+    buildRows.clear();
+    memory.release();
+    Record row;
+    overflow->rewind();
+    while (overflow->read(row)) {
+        buildParts[partitionOf(row, buildKeys())]->write(row);
+    }
+
+    Operator& probe = buildLeft ? *right : *left;
+    while (probe.next(row)) {
+        probeParts[partitionOf(row, probeKeys())]->write(row);
+    }
+    probe.close();
+    probeOpen = false;
+}
+
+// A partition is loaded whether or not its memory can be reserved; keys
+// spread too unevenly for it to fit are not split further
+void HashJoin::loadPartition() {
+    buildRows.clear();
+    memory.release();
+    memory.resize(buildParts[partition]->getByteCount());
+    Record row;
+    buildParts[partition]->rewind();
+    while (buildParts[partition]->read(row)) {
+        buildRows.push_back(move(row));
+    }
+    buildParts[partition].reset();
+    indexBuildRows();
+    probeParts[partition]->rewind();
+}
+
+void HashJoin::open() {
+    buildRows.clear();
+    buckets.clear();
+    buildParts.clear();
+    probeParts.clear();
+    partition = 0;
+    matches = nullptr;
+    pending = false;
+    memory.release();
+
+    // Build rows stay in memory while it can be reserved; the rest wait in
+    // a spill file
+    Operator& build = buildLeft ? *left : *right;
+    Operator& probe = buildLeft ? *right : *left;
+    unique_ptr<SpillFile> overflow;
+    size_t bytes = 0;
+    Record row;
+    build.open();
+    while (build.next(row)) {
+        size_t size = rowBytes(row);
+        if (!overflow && !memory.resize(bytes + size)) {
+            overflow.reset(new SpillFile(memory.getSpillDirectory()));
+            memory.noteSpill();
+        }
+        if (overflow) {
+            overflow->write(row);
+        } else {
+            bytes += size;
+            buildRows.push_back(move(row));
+        }
+    }
+    build.close();
+
+    probe.open();
+    probeOpen = true;
+    if (overflow) {
+        partitionInputs(move(overflow), bytes);
+        loadPartition();
+    } else {
+        indexBuildRows();
+    }
+}
+
+bool HashJoin::nextProbe(Record& row) {
+    if (probeParts.empty()) {
+        return (buildLeft ? right : left)->next(row);
+    }
+    while (partition < probeParts.size()) {
+        if (probeParts[partition]->read(row)) {
+            return true;
+        }
+        probeParts[partition].reset();
+        if (++partition < probeParts.size()) {
+            loadPartition();
+        }
+    }
+    return false;
+}
+
+bool HashJoin::next(Record& row) {
+    while (true) {
+        while (matches && matchPosition < matches->size()) {
+            const Record& other = buildRows[(*matches)[matchPosition++]];
+            if (buildLeft) {
+                joinRows(other, probeRow, row);
+            } else {
+                joinRows(probeRow, other, row);
+            }
+            if (!spec.residual || spec.residual->test(row)) {
+                matched = true;
+                return true;
+            }
+        }
+        if (pending && spec.leftOuter && !matched) {
+            pending = false;
+            padRow(probeRow, spec.rightWidth, row);
+            return true;
+        }
+
+        if (!nextProbe(probeRow)) {
+            return false;
+        }
+        joinKey(probeRow, probeKeys(), key);
+        auto it = buckets.find(key);
+        matches = it == buckets.end() ? nullptr : &it->second;
+        matchPosition = 0;
+        pending = true;
+        matched = false;
+    }
+}
+
+void HashJoin::close() {
+    if (probeOpen) {
+        (buildLeft ? right : left)->close();
+        probeOpen = false;
+    }
+    buildRows.clear();
+    buckets.clear();
+    buildParts.clear();
+    probeParts.clear();
+    matches = nullptr;
+    memory.release();
+}
+
+MergeJoin::MergeJoin(unique_ptr<Operator> leftInput, unique_ptr<Operator> rightInput, JoinSpec join,
+                     shared_ptr<MemoryTracker> tracker)
+    : left(move(leftInput)), right(move(rightInput)), spec(move(join)), memory(move(tracker)),
+      haveRight(false), haveGroup(false), groupPosition(0), pending(false), matched(false) {}
+
+void MergeJoin::open() {
+    left->open();
+    right->open();
+    haveRight = right->next(rightRow);
+    group.clear();
+    groupOverflow.reset();
+    haveGroup = false;
+    groupPosition = 0;
+    pending = false;
+}
+
+// Skips the right rows below key and collects those equal to it
+void MergeJoin::fillGroup(const Value& key) {
+    int column = spec.rightKeys[0];
+    while (haveRight && rightRow.get(column).compare(key) < 0) {
+        haveRight = right->next(rightRow);
+    }
+
+    group.clear();
+    groupOverflow.reset();
+    memory.release();
+    groupKey = key;
+    haveGroup = true;
+    size_t bytes = 0;
+    while (haveRight && rightRow.get(column).compare(key) == 0) {
+        bytes += rowBytes(rightRow);
+        if (!groupOverflow && !memory.resize(bytes)) {
+            groupOverflow.reset(new SpillFile(memory.getSpillDirectory()));
+            memory.noteSpill();
+        }
+        if (groupOverflow) {
+            groupOverflow->write(rightRow);
+        } else {
+            group.push_back(rightRow);
+        }
+        haveRight = right->next(rightRow);
+    }
+}
+
+const Record* MergeJoin::nextInGroup() {
+    if (groupPosition < group.size()) {
+        return &group[groupPosition++];
+    }
+    return groupOverflow && groupOverflow->read(spilled) ? &spilled : nullptr;
+}
+
+bool MergeJoin::next(Record& row) {
+    while (true) {
+        if (pending) {
+            while (const Record* other = nextInGroup()) {
+                joinRows(leftRow, *other, row);
+                if (!spec.residual || spec.residual->test(row)) {
+                    matched = true;
+                    return true;
+                }
+            }
+            pending = false;
+            if (spec.leftOuter && !matched) {
+                padRow(leftRow, spec.rightWidth, row);
+                return true;
+            }
+        }
+
+        if (!left->next(leftRow)) {
+            return false;
+        }
+        // Equal left keys in a row share the group
+        const Value& key = leftRow.get(spec.leftKeys[0]);
+        if (!haveGroup || key.compare(groupKey) != 0) {
+            fillGroup(key);
+        }
+        groupPosition = 0;
+        if (groupOverflow) {
+            groupOverflow->rewind();
+        }
+        pending = true;
+        matched = false;
+    }
+}
+
+void MergeJoin::close() {
+    left->close();
+    right->close();
+    group.clear();
+    groupOverflow.reset();
+    memory.release();
+}
+
+Limit::Limit(unique_ptr<Operator> child, size_t maxRows, size_t skip)
+    : input(move(child)), limit(maxRows), offset(skip), produced(0) {}
+
+void Limit::open() {
+    input->open();
+    produced = 0;
+    Record skipped;
+    for (size_t i = 0; i < offset && input->next(skipped); ++i) {}
+}
+
+bool Limit::next(Record& row) {
+    if (produced >= limit || !input->next(row)) {
+        return false;
+    }
+    ++produced;
+    return true;
+}
+
+void Limit::close() {
+    input->close();
+}
@@ -1,48 +1,482 @@
 #include "PageManager.h"
-#include <fstream>
+#include "BufferPool.h"
+#include <cstring>
+#include <cstdio>
 using namespace std;
 
-PageManager::PageManager(const string& filename) : tableFile(filename) {
-    loadPages();
+namespace {
+
+// Header page layout: lsn, magic, metadata length, metadata
+const char HEAP_MAGIC[8] = {'M', 'S', 'Q', 'L', 'H', 'E', 'A', 'P'};
+const int HEADER_MAGIC_POS = 8;
+const int HEADER_LENGTH_POS = 16;
+const int HEADER_DATA_POS = 20;
+
+} // namespace
+
+const int PageManager::MAX_HEADER_SIZE = PAGE_SIZE - HEADER_DATA_POS;
+
+Page::Page(int id) : pageID(id), data(PAGE_SIZE, 0), dirty(false) {
+    setU16(10, PAGE_SIZE);  // free end: records are placed below it
+}
+
+void Page::reset(int id) {
+    pageID = id;
+    fill(data.begin(), data.end(), 0);
+    setU16(10, PAGE_SIZE);
+    dirty = false;
+}
+
+uint64_t Page::readLSN(const char* pageData) {
+    uint64_t lsn;
+    memcpy(&lsn, pageData, sizeof(lsn));
+    return lsn;
+}
+
+uint16_t Page::getU16(int pos) const {
+    uint16_t value;
+    memcpy(&value, data.data() + pos, sizeof(value));
+    return value;
+}
+
+void Page::setU16(int pos, uint16_t value) {
+    memcpy(data.data() + pos, &value, sizeof(value));
+}
+
+uint64_t Page::getLSN() const {
+    return readLSN(data.data());
+}
+
+void Page::setLSN(uint64_t lsn) {
+    memcpy(data.data(), &lsn, sizeof(lsn));
+}
+
+int Page::getSlotCount() const {
+    return getU16(8);
+}
+
+int Page::getFreeEnd() const {
+    return getU16(10);
+}
+
+int Page::getContiguousFree() const {
+    return getFreeEnd() - (HEADER_SIZE + SLOT_SIZE * getSlotCount());
+}
+
+int Page::getFreeSpace() const {
+    int slots = getSlotCount();
+    int liveBytes = 0;
+    bool reusableSlot = false;
+    for (int i = 0; i < slots; ++i) {
+        if (isLive(i)) {
+            liveBytes += getU16(HEADER_SIZE + SLOT_SIZE * i + 2);
+        } else {
+            reusableSlot = true;
+        }
+    }
+    int free = PAGE_SIZE - HEADER_SIZE - SLOT_SIZE * slots - liveBytes;
+    if (!reusableSlot) free -= SLOT_SIZE;
+    return free > 0 ? free : 0;
+}
+
+bool Page::isLive(int slot) const {
+    return slot >= 0 && slot < getSlotCount() && getU16(HEADER_SIZE + SLOT_SIZE * slot) != 0;
+}
+
+const char* Page::recordData(int slot, int& length) const {
+    if (!isLive(slot)) return nullptr;
+    int pos = HEADER_SIZE + SLOT_SIZE * slot;
+    length = getU16(pos + 2);
+    return data.data() + getU16(pos);
+}
+
+bool Page::readRecord(int slot, string& out) const {
+    int length;
+    const char* bytes = recordData(slot, length);
+    if (!bytes) return false;
+    out.assign(bytes, length);
+    return true;
+}
+
+int Page::insertRecord(const string& bytes) {
+    int slots = getSlotCount();
+    int slot = 0;
+    while (slot < slots && isLive(slot)) slot++;
+    return insertRecordAt(slot, bytes) ? slot : -1;
+}
+
+bool Page::insertRecordAt(int slot, const string& bytes) {
+    int slots = getSlotCount();
+    if (slot < 0 || isLive(slot)) return false;
+
+    int newSlots = slot >= slots ? slot + 1 - slots : 0;
+    int length = static_cast<int>(bytes.size());
+    int needed = length + SLOT_SIZE * newSlots;
+    if (getContiguousFree() < needed) {
+        compact();
+        if (getContiguousFree() < needed) return false;
+    }
+
+    for (int i = slots; i < slots + newSlots; ++i) {
+        setU16(HEADER_SIZE + SLOT_SIZE * i, 0);
+        setU16(HEADER_SIZE + SLOT_SIZE * i + 2, 0);
+    }
+    setU16(8, static_cast<uint16_t>(slots + newSlots));
+
+    int offset = getFreeEnd() - length;
+    memcpy(data.data() + offset, bytes.data(), length);
+    setU16(10, static_cast<uint16_t>(offset));
+    setU16(HEADER_SIZE + SLOT_SIZE * slot, static_cast<uint16_t>(offset));
+    setU16(HEADER_SIZE + SLOT_SIZE * slot + 2, static_cast<uint16_t>(length));
+    dirty = true;
+    return true;
+}
+
+bool Page::updateRecord(int slot, const string& bytes) {
+    if (!isLive(slot)) return false;
+
+    int pos = HEADER_SIZE + SLOT_SIZE * slot;
+    int length = static_cast<int>(bytes.size());
+    if (length <= getU16(pos + 2)) {
+        memcpy(data.data() + getU16(pos), bytes.data(), length);
+        setU16(pos + 2, static_cast<uint16_t>(length));
+        dirty = true;
+        return true;
+    }
+
+    // Grow: release the old bytes and re-place the record in the same slot
+    string old;
+    readRecord(slot, old);
+    setU16(pos, 0);
+    setU16(pos + 2, 0);
+    if (insertRecordAt(slot, bytes)) return true;
+    insertRecordAt(slot, old);
+    return false;
+}
+
+bool Page::deleteRecord(int slot) {
+    if (!isLive(slot)) return false;
+    setU16(HEADER_SIZE + SLOT_SIZE * slot, 0);
+    setU16(HEADER_SIZE + SLOT_SIZE * slot + 2, 0);
+    dirty = true;
+    return true;
+}
+
+// Slides live records to the end of the page, reclaiming holes left by
+// deletes and shrinking updates. Slot numbers are unchanged.
+void Page::compact() {
+    int slots = getSlotCount();
+    vector<char> compacted(data.begin(), data.begin() + HEADER_SIZE + SLOT_SIZE * slots);
+    compacted.resize(PAGE_SIZE, 0);
+
+    int end = PAGE_SIZE;
+    for (int i = 0; i < slots; ++i) {
+        int length;
+        const char* bytes = recordData(i, length);
+        if (!bytes) continue;
+        end -= length;
+        memcpy(compacted.data() + end, bytes, length);
+        uint16_t offset = static_cast<uint16_t>(end);
+        memcpy(compacted.data() + HEADER_SIZE + SLOT_SIZE * i, &offset, sizeof(offset));
+    }
+    data.swap(compacted);
+    setU16(10, static_cast<uint16_t>(end));
+    dirty = true;
+}
+
+PageManager::PageManager(const string& filename, shared_ptr<BufferPool> bufferPool)
+    : pool(bufferPool), fileId(-1), pageCount(0), tableFile(filename) {}
+
+PageManager::~PageManager() {
+    if (fileId >= 0) {
+        pool->closeFile(fileId);
+    }
+}
+
+bool PageManager::create() {
+    fileId = pool->openFile(tableFile, true);
+    pageCount = 1;
+    freeSpace.assign(1, 0);
+    setHeader(header);
+    return fileId >= 0;
+}
+
+bool PageManager::loadPages() {
+    fileId = pool->openFile(tableFile, false);
+    if (fileId < 0) return false;
+
+    pageCount = static_cast<int>(pool->getFilePageCount(fileId));
+    PinnedPage page = pageCount > 0 ? pool->fetchPage(fileId, 0) : PinnedPage();
+    if (!page || memcmp(page->data.data() + HEADER_MAGIC_POS, HEAP_MAGIC, sizeof(HEAP_MAGIC)) != 0) {
+        return false;
+    }
+
+    uint32_t length;
+    memcpy(&length, page->data.data() + HEADER_LENGTH_POS, sizeof(length));
+    if (length > PAGE_SIZE - HEADER_DATA_POS) return false;
+    header.assign(page->data.data() + HEADER_DATA_POS, length);
+
+    // Only the last page's free space is known up front; the rest is
+    // learned as pages are read
+    freeSpace.assign(pageCount, 0);
+    if (pageCount > 1) {
+        PinnedPage last = pool->fetchPage(fileId, pageCount - 1);
+        if (last) freeSpace[pageCount - 1] = static_cast<uint16_t>(last->getFreeSpace());
+    }
+    return true;
+}
+
+const string& PageManager::getFileName() const {
+    return tableFile;
 }
 
-int PageManager::appendRecord(const vector<string>& record) {
-    string recordData;
-    for (const auto& field : record) {
-        recordData += to_string(field.length()) + "|" + field + "|";
+bool PageManager::moveToFile(const string& filename) {
+    if (rename(tableFile.c_str(), filename.c_str()) != 0) {
+        return false;
     }
-    
-    if (pages.empty() || !pages.back()->hasSpace(recordData.length())) {
-        pages.push_back(make_shared<Page>(pages.size()));
+    tableFile = filename;
+    pool->renameFile(fileId, filename);
+    return true;
+}
+
+void PageManager::setLogFlusher(function<bool(uint64_t)> flushLog) {
+    pool->setLogFlusher(fileId, flushLog);
+}
+
+const string& PageManager::getHeader() const {
+    return header;
+}
+
+bool PageManager::setHeader(const string& data) {
+    if (data.size() > static_cast<size_t>(MAX_HEADER_SIZE)) {
+        return false;
     }
-    
-    auto& page = pages.back();
-    int offset = page->bytesUsed;
-    page->bytesUsed += recordData.length();
-    
-    for (size_t i = 0; i < recordData.length(); i++) {
-        page->data[offset + i] = recordData[i];
+    header = data;
+
+    PinnedPage page = pool->fetchPage(fileId, 0);
+    if (!page) return false;
+    fill(page->data.begin(), page->data.end(), 0);
+    memcpy(page->data.data() + HEADER_MAGIC_POS, HEAP_MAGIC, sizeof(HEAP_MAGIC));
+    uint32_t length = static_cast<uint32_t>(data.size());
+    memcpy(page->data.data() + HEADER_LENGTH_POS, &length, sizeof(length));
+    memcpy(page->data.data() + HEADER_DATA_POS, data.data(), length);
+    page->dirty = true;
+    return true;
+}
+
+void PageManager::extendTo(int pageID) {
+    while (pageCount <= pageID) {
+        freeSpace.push_back(static_cast<uint16_t>(Page::MAX_RECORD_SIZE));
+        pageCount++;
+    }
+}
+
+int PageManager::findPageWithSpace(int recordSize) const {
+    int last = pageCount - 1;
+    if (last >= 1 && freeSpace[last] >= recordSize) {
+        return last;
     }
-    
-    return (page->pageID << 16) | offset;
+    for (int i = 1; i < last; ++i) {
+        if (freeSpace[i] >= recordSize) return i;
+    }
+    return -1;
 }
 
-void PageManager::savePages() {
-    ofstream file(tableFile, ios::binary);
-    for (const auto& page : pages) {
-        file.write(page->data.data(), PAGE_SIZE);
+void PageManager::touch(Page& page, uint64_t lsn) {
+    page.dirty = true;
+    if (lsn > page.getLSN()) {
+        page.setLSN(lsn);
     }
+    freeSpace[page.pageID] = static_cast<uint16_t>(page.getFreeSpace());
 }
 
-void PageManager::loadPages() {
-    ifstream file(tableFile, ios::binary);
-    if (!file) return;
-    
-    vector<char> buffer(PAGE_SIZE);
-    int pageID = 0;
-    while (file.read(buffer.data(), PAGE_SIZE)) {
-        auto page = make_shared<Page>(pageID++);
-        page->data = buffer;
-        pages.push_back(page);
+RecordID PageManager::insertRecord(const string& bytes, uint64_t lsn) {
+    int size = static_cast<int>(bytes.size());
+    if (size > Page::MAX_RECORD_SIZE) {
+        return -1;
+    }
+
+    int pageID = findPageWithSpace(size);
+    if (pageID < 0) {
+        pageID = pageCount;
+        extendTo(pageID);
     }
+
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    if (!page) return -1;
+    int slot = page->insertRecord(bytes);
+    if (slot < 0) {
+        // The free-space map was optimistic; fix it and use a fresh page
+        freeSpace[pageID] = static_cast<uint16_t>(page->getFreeSpace());
+        extendTo(pageCount);
+        page = pool->fetchPage(fileId, pageCount - 1);
+        if (!page) return -1;
+        slot = page->insertRecord(bytes);
+    }
+    touch(*page, lsn);
+    return makeRecordID(page->pageID, slot);
+}
+
+bool PageManager::appendRecords(const vector<string>& records, uint64_t lsn, vector<RecordID>& rids) {
+    int pageID = pageCount - 1;
+    size_t next = 0;
+    while (next < records.size()) {
+        int size = static_cast<int>(records[next].size());
+        if (size > Page::MAX_RECORD_SIZE) {
+            return false;
+        }
+        if (pageID < 1 || freeSpace[pageID] < size) {
+            pageID = pageCount;
+            extendTo(pageID);
+        }
+
+        PinnedPage page = pool->fetchPage(fileId, pageID);
+        if (!page) return false;
+        size_t first = next;
+        int slot;
+        while (next < records.size() && records[next].size() <= static_cast<size_t>(Page::MAX_RECORD_SIZE) &&
+               (slot = page->insertRecord(records[next])) >= 0) {
+            rids.push_back(makeRecordID(pageID, slot));
+            next++;
+        }
+        if (next > first) {
+            touch(*page, lsn);
+        } else {
+            // The free-space map was optimistic; the next record starts a page
+            freeSpace[pageID] = static_cast<uint16_t>(page->getFreeSpace());
+            pageID = -1;
+        }
+    }
+    return true;
+}
+
+bool PageManager::readRecord(RecordID rid, string& out) const {
+    int pageID = recordPage(rid);
+    if (pageID < 1 || pageID >= pageCount) {
+        return false;
+    }
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    return page && page->readRecord(recordSlot(rid), out);
+}
+
+RecordID PageManager::updateRecord(RecordID rid, const string& bytes, uint64_t lsn) {
+    int pageID = recordPage(rid);
+    if (pageID < 1 || pageID >= pageCount ||
+        static_cast<int>(bytes.size()) > Page::MAX_RECORD_SIZE) {
+        return -1;
+    }
+
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    if (!page || !page->isLive(recordSlot(rid))) {
+        return -1;
+    }
+    if (page->updateRecord(recordSlot(rid), bytes)) {
+        touch(*page, lsn);
+        return rid;
+    }
+
+    // No room left on this page: move the record
+    page->deleteRecord(recordSlot(rid));
+    touch(*page, lsn);
+    return insertRecord(bytes, lsn);
+}
+
+bool PageManager::deleteRecord(RecordID rid, uint64_t lsn) {
+    int pageID = recordPage(rid);
+    if (pageID < 1 || pageID >= pageCount) {
+        return false;
+    }
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    if (!page || !page->deleteRecord(recordSlot(rid))) {
+        return false;
+    }
+    touch(*page, lsn);
+    return true;
+}
+
+void PageManager::redoInsert(RecordID rid, const string& bytes, uint64_t lsn) {
+    if (recordPage(rid) < 1) return;
+    extendTo(recordPage(rid));
+    PinnedPage page = pool->fetchPage(fileId, recordPage(rid));
+    if (!page || page->getLSN() > lsn) return;
+
+    if (!page->insertRecordAt(recordSlot(rid), bytes)) {
+        page->updateRecord(recordSlot(rid), bytes);
+    }
+    touch(*page, lsn);
+}
+
+void PageManager::redoUpdate(RecordID rid, const string& bytes, uint64_t lsn) {
+    if (recordPage(rid) < 1) return;
+    extendTo(recordPage(rid));
+    PinnedPage page = pool->fetchPage(fileId, recordPage(rid));
+    if (!page || page->getLSN() > lsn) return;
+
+    if (!page->updateRecord(recordSlot(rid), bytes)) {
+        page->insertRecordAt(recordSlot(rid), bytes);
+    }
+    touch(*page, lsn);
+}
+
+void PageManager::redoDelete(RecordID rid, uint64_t lsn) {
+    if (recordPage(rid) < 1) return;
+    extendTo(recordPage(rid));
+    PinnedPage page = pool->fetchPage(fileId, recordPage(rid));
+    if (!page || page->getLSN() > lsn) return;
+
+    page->deleteRecord(recordSlot(rid));
+    touch(*page, lsn);
+}
+
+int PageManager::getPageCount() const {
+    return pageCount;
+}
+
+void PageManager::scan(const function<bool(RecordID, const char*, int)>& visit) const {
+    for (int p = 1; p < pageCount; ++p) {
+        PinnedPage page = pool->fetchPage(fileId, p);
+        if (!page) continue;
+
+        freeSpace[p] = static_cast<uint16_t>(page->getFreeSpace());
+        int slots = page->getSlotCount();
+        for (int slot = 0; slot < slots; ++slot) {
+            int length;
+            const char* bytes = page->recordData(slot, length);
+            if (bytes && !visit(makeRecordID(p, slot), bytes, length)) {
+                return;
+            }
+        }
+    }
+}
+
+void PageManager::scanPage(int pageID, const function<void(RecordID, const char*, int)>& visit) const {
+    if (pageID < 1 || pageID >= pageCount) {
+        return;
+    }
+    PinnedPage page = pool->fetchPage(fileId, pageID);
+    if (!page) {
+        return;
+    }
+
+    freeSpace[pageID] = static_cast<uint16_t>(page->getFreeSpace());
+    int slots = page->getSlotCount();
+    for (int slot = 0; slot < slots; ++slot) {
+        int length;
+        const char* bytes = page->recordData(slot, length);
+        if (bytes) {
+            visit(makeRecordID(pageID, slot), bytes, length);
+        }
+    }
+}
+
+vector<pair<int, vector<char>>> PageManager::takeDirtyPages(bool all) {
+    return pool->takeDirtyPages(fileId, all);
+}
+
+bool PageManager::writeSnapshot(const vector<pair<int, vector<char>>>& snapshot) {
+    return pool->writeSnapshot(fileId, snapshot);
+}
+
+bool PageManager::savePages() {
+    return pool->flushFile(fileId);
 }
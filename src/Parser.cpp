@@ -63,12 +63,42 @@ ParsedQuery Parser::parseCreateTable() {
     }
 
     while (!check(TokenType::PUNCTUATION) || peek().value != ")") {
-        if (check(TokenType::IDENTIFIER)) {
+        if (check(TokenType::END_OF_INPUT)) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
+        if (match("primary")) {
+            // Table constraint: PRIMARY KEY (col)
+            if (!match("key") || !match("(") || !check(TokenType::IDENTIFIER)) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+            query.primaryKeyColumn = consume().value;
+            match(")");
+        } else if (check(TokenType::IDENTIFIER)) {
             string colName = consume().value;
-            if (check(TokenType::IDENTIFIER)) {
-                consume();
+            string typeName;
+            if (check(TokenType::IDENTIFIER) && peek().value != "primary") {
+                typeName = consume().value;
+                // Type arguments such as VARCHAR(255) are accepted and ignored
+                if (match("(")) {
+                    while (!check(TokenType::END_OF_INPUT) && !match(")")) {
+                        consume();
+                    }
+                }
+            }
+            // Column constraint: col TYPE PRIMARY KEY
+            if (match("primary")) {
+                if (!match("key")) {
+                    query.type = ParsedQuery::QueryType::INVALID;
+                    return query;
+                }
+                query.primaryKeyColumn = colName;
             }
             query.columns.push_back(colName);
+            query.columnTypes.push_back(typeName);
+        } else {
+            consume();
         }
         if (peek().value == ",") {
             consume();
@@ -90,49 +120,313 @@ ParsedQuery Parser::parseInsert() {
         query.tableName = consume().value;
     }
 
+    // VALUES (...) [, (...) ...]
     if (match("values")) {
-        if (match(TokenType::PUNCTUATION) && tokens[current - 1].value == "(") {
+        size_t count = 0;  // values in all rows so far
+        bool more = match(TokenType::PUNCTUATION) && tokens[current - 1].value == "(";
+        while (more) {
+            query.values.emplace_back();
+            vector<string>& row = query.values.back();
             while (!check(TokenType::PUNCTUATION) || peek().value != ")") {
                 if (check(TokenType::NUMBER)) {
-                    query.values.push_back(consume().value);
+                    row.push_back(consume().value);
                 } else if (check(TokenType::STRING)) {
-                    query.values.push_back(consume().value);
-                } else if (check(TokenType::IDENTIFIER)) {
-                    query.values.push_back(consume().value);
+                    row.push_back(consume().value);
+                } else if (check(TokenType::IDENTIFIER) || check("null")) {
+                    row.push_back(consume().value);
+                } else if (check(TokenType::PARAMETER)) {
+                    query.valueParameters.resize(count, -1);
+                    query.valueParameters.push_back(stoi(consume().value));
+                    row.push_back("");
+                } else {
+                    query.type = ParsedQuery::QueryType::INVALID;
+                    return query;
                 }
+                count++;
                 if (peek().value == ",") {
                     consume();
                 }
             }
             match(TokenType::PUNCTUATION);
+            more = match(",");
+            if (more && !match("(")) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+        }
+        if (!query.valueParameters.empty()) {
+            query.valueParameters.resize(count, -1);
         }
     }
 
     return query;
 }
 
-Condition Parser::parseCondition() {
-    Condition condition;
+// COPY table FROM 'file' [[WITH] HEADER]
+ParsedQuery Parser::parseCopy() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::COPY;
+
+    consume(); // COPY
 
     if (check(TokenType::IDENTIFIER)) {
-        condition.columnName = consume().value;
+        query.tableName = consume().value;
     }
+    if (query.tableName.empty() || !match("from") || !check(TokenType::STRING)) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+    query.fileName = consume().value;
+    match("with");
+    query.header = match("header");
+    return query;
+}
 
-    if (check(TokenType::OPERATOR)) {
-        condition.op = consume().value;
+// A non-negative whole number of rows
+static bool parseCount(const string& text, size_t& count) {
+    if (text.empty() || text.find_first_not_of("0123456789") != string::npos || text.size() > 18) {
+        return false;
     }
+    count = static_cast<size_t>(stoull(text));
+    return true;
+}
 
-    if (check(TokenType::NUMBER)) {
-        condition.value = consume().value;
-    } else if (check(TokenType::STRING)) {
-        condition.value = consume().value;
+// Reads "func(column)" or "count(*)" after its function name
+bool Parser::parseAggregate(const string& func, Aggregate& aggregate) {
+    if (!Aggregate::parseFunc(func, aggregate.func) || !match("(")) {
+        return false;
+    }
+    if (match("*")) {
+        if (aggregate.func != Aggregate::Func::COUNT) {
+            return false;
+        }
+        aggregate.column.clear();
     } else if (check(TokenType::IDENTIFIER)) {
-        condition.value = consume().value;
+        aggregate.column = consume().value;
+    } else {
+        return false;
     }
+    aggregate.name = func + "(" + (aggregate.column.empty() ? "*" : aggregate.column) + ")";
+    return match(")");
+}
+
+// [AS] alias after a table name; "" when there is none
+string Parser::parseAlias() {
+    match("as");
+    return check(TokenType::IDENTIFIER) ? consume().value : "";
+}
 
+static void addAggregate(vector<Aggregate>& aggregates, const Aggregate& aggregate) {
+    for (const auto& existing : aggregates) {
+        if (existing.name == aggregate.name) return;
+    }
+    aggregates.push_back(aggregate);
+}
+
+Condition Parser::parseCondition(vector<Aggregate>* aggregates) {
+    Condition condition;
+    condition.expression = parseDisjunction(aggregates);
     return condition;
 }
 
+// conjunction { OR conjunction }
+shared_ptr<Expression> Parser::parseDisjunction(vector<Aggregate>* aggregates) {
+    shared_ptr<Expression> left = parseConjunction(aggregates);
+    if (!left || !check("or")) {
+        return left;
+    }
+    auto disjunction = make_shared<Expression>(Expression::Kind::OR);
+    disjunction->operands.push_back(left);
+    while (match("or")) {
+        shared_ptr<Expression> term = parseConjunction(aggregates);
+        if (!term) return nullptr;
+        disjunction->operands.push_back(term);
+    }
+    return disjunction;
+}
+
+// negation { AND negation }
+shared_ptr<Expression> Parser::parseConjunction(vector<Aggregate>* aggregates) {
+    shared_ptr<Expression> left = parseNegation(aggregates);
+    if (!left || !check("and")) {
+        return left;
+    }
+    auto conjunction = make_shared<Expression>(Expression::Kind::AND);
+    conjunction->operands.push_back(left);
+    while (match("and")) {
+        shared_ptr<Expression> term = parseNegation(aggregates);
+        if (!term) return nullptr;
+        conjunction->operands.push_back(term);
+    }
+    return conjunction;
+}
+
+// NOT negation | predicate | ( disjunction ). A parenthesis may also open
+// an arithmetic operand, as in "(a + 1) > b", which is tried first.
+shared_ptr<Expression> Parser::parseNegation(vector<Aggregate>* aggregates) {
+    if (match("not")) {
+        shared_ptr<Expression> term = parseNegation(aggregates);
+        if (!term) return nullptr;
+        auto negation = make_shared<Expression>(Expression::Kind::NOT);
+        negation->operands.push_back(term);
+        return negation;
+    }
+
+    size_t start = current;
+    shared_ptr<Expression> predicate = parsePredicate(aggregates);
+    if (predicate || tokens[start].type != TokenType::PUNCTUATION || tokens[start].value != "(") {
+        return predicate;
+    }
+    current = start + 1;
+    shared_ptr<Expression> group = parseDisjunction(aggregates);
+    return group && match(")") ? group : nullptr;
+}
+
+// sum [NOT] BETWEEN sum AND sum | sum [NOT] IN (sum, ...) |
+// sum IS [NOT] NULL | sum op sum. Null on a syntax error.
+shared_ptr<Expression> Parser::parsePredicate(vector<Aggregate>* aggregates) {
+    shared_ptr<Expression> value = parseSum(aggregates);
+    if (!value) {
+        return nullptr;
+    }
+
+    shared_ptr<Expression> predicate;
+    if (match("is")) {
+        predicate = make_shared<Expression>(Expression::Kind::IS_NULL);
+        predicate->negated = match("not");
+        if (!match("null")) {
+            return nullptr;
+        }
+        predicate->operands.push_back(value);
+        return predicate;
+    }
+
+    bool negated = match("not");
+    if (match("between")) {
+        predicate = make_shared<Expression>(Expression::Kind::BETWEEN);
+        predicate->operands.push_back(value);
+        predicate->operands.push_back(parseSum(aggregates));
+        if (!match("and")) {
+            return nullptr;
+        }
+        predicate->operands.push_back(parseSum(aggregates));
+    } else if (match("in")) {
+        predicate = make_shared<Expression>(Expression::Kind::IN);
+        predicate->operands.push_back(value);
+        if (!match("(")) {
+            return nullptr;
+        }
+        do {
+            predicate->operands.push_back(parseSum(aggregates));
+        } while (match(","));
+        if (!match(")")) {
+            return nullptr;
+        }
+    } else if (!negated && check(TokenType::OPERATOR) && BoundCondition::parseOp(peek().value) != BoundCondition::Op::INVALID) {
+        predicate = make_shared<Expression>(Expression::Kind::COMPARE, consume().value);
+        predicate->operands.push_back(value);
+        predicate->operands.push_back(parseSum(aggregates));
+    } else {
+        return nullptr;
+    }
+    predicate->negated = negated;
+
+    for (const auto& operand : predicate->operands) {
+        if (!operand) return nullptr;
+    }
+    return predicate;
+}
+
+// product { (+ | -) product }
+shared_ptr<Expression> Parser::parseSum(vector<Aggregate>* aggregates) {
+    shared_ptr<Expression> left = parseProduct(aggregates);
+    while (left && (check("+") || check("-"))) {
+        auto sum = make_shared<Expression>(Expression::Kind::ARITHMETIC, consume().value);
+        sum->operands.push_back(left);
+        sum->operands.push_back(parseProduct(aggregates));
+        left = sum->operands.back() ? sum : nullptr;
+    }
+    return left;
+}
+
+// operand { (* | / | %) operand }
+shared_ptr<Expression> Parser::parseProduct(vector<Aggregate>* aggregates) {
+    shared_ptr<Expression> left = parseOperand(aggregates);
+    while (left && (check("*") || check("/") || check("%"))) {
+        auto product = make_shared<Expression>(Expression::Kind::ARITHMETIC, consume().value);
+        product->operands.push_back(left);
+        product->operands.push_back(parseOperand(aggregates));
+        left = product->operands.back() ? product : nullptr;
+    }
+    return left;
+}
+
+// A number, string, ?, column, aggregate call, -operand or (sum)
+shared_ptr<Expression> Parser::parseOperand(vector<Aggregate>* aggregates) {
+    if (check(TokenType::NUMBER)) {
+        return make_shared<Expression>(Expression::Kind::NUMBER, consume().value);
+    }
+    if (check(TokenType::STRING)) {
+        return make_shared<Expression>(Expression::Kind::STRING, consume().value);
+    }
+    if (check(TokenType::PARAMETER)) {
+        return make_shared<Expression>(Expression::Kind::PARAMETER, consume().value);
+    }
+    if (match("-")) {
+        shared_ptr<Expression> operand = parseOperand(aggregates);
+        if (!operand) {
+            return nullptr;
+        }
+        auto negation = make_shared<Expression>(Expression::Kind::ARITHMETIC, "-");
+        negation->operands.push_back(make_shared<Expression>(Expression::Kind::NUMBER, "0"));
+        negation->operands.push_back(operand);
+        return negation;
+    }
+    if (match("(")) {
+        shared_ptr<Expression> inner = parseSum(aggregates);
+        return inner && match(")") ? inner : nullptr;
+    }
+    if (check(TokenType::IDENTIFIER)) {
+        string name = consume().value;
+        if (aggregates && check("(")) {
+            Aggregate aggregate;
+            if (!parseAggregate(name, aggregate)) {
+                return nullptr;
+            }
+            addAggregate(*aggregates, aggregate);
+            name = aggregate.name;
+        }
+        return make_shared<Expression>(Expression::Kind::COLUMN, name);
+    }
+    return nullptr;
+}
+
+// Without joins, "table.column" names a column of the one table
+static void unqualify(string& name, const string& qualifier) {
+    if (name.size() > qualifier.size() && name[qualifier.size()] == '.' &&
+        Utils::toLower(name.substr(0, qualifier.size())) == Utils::toLower(qualifier)) {
+        name.erase(0, qualifier.size() + 1);
+    }
+}
+
+static void unqualify(Expression& expression, const string& qualifier) {
+    if (expression.kind == Expression::Kind::COLUMN) {
+        unqualify(expression.text, qualifier);
+    }
+    for (const auto& operand : expression.operands) {
+        unqualify(*operand, qualifier);
+    }
+}
+
+static void unqualify(ParsedQuery& query, const string& qualifier) {
+    for (auto& name : query.columns) unqualify(name, qualifier);
+    for (auto& aggregate : query.aggregates) unqualify(aggregate.column, qualifier);
+    unqualify(query.groupByColumn, qualifier);
+    for (auto& key : query.orderBy) unqualify(key.column, qualifier);
+    for (auto& condition : query.conditions) unqualify(*condition.expression, qualifier);
+    for (auto& condition : query.havingConditions) unqualify(*condition.expression, qualifier);
+}
+
 ParsedQuery Parser::parseSelect() {
     ParsedQuery query;
     query.type = ParsedQuery::QueryType::SELECT;
@@ -144,7 +438,17 @@ ParsedQuery Parser::parseSelect() {
     } else {
         while (check(TokenType::IDENTIFIER) || check(TokenType::PUNCTUATION)) {
             if (check(TokenType::IDENTIFIER)) {
-                query.columns.push_back(consume().value);
+                string name = consume().value;
+                if (check("(")) {
+                    Aggregate aggregate;
+                    if (!parseAggregate(name, aggregate)) {
+                        query.type = ParsedQuery::QueryType::INVALID;
+                        return query;
+                    }
+                    addAggregate(query.aggregates, aggregate);
+                    name = aggregate.name;
+                }
+                query.columns.push_back(name);
             }
             if (peek().value == ",") {
                 consume();
@@ -157,32 +461,98 @@ ParsedQuery Parser::parseSelect() {
     if (match("from")) {
         if (check(TokenType::IDENTIFIER)) {
             query.tableName = consume().value;
+            query.tableAlias = parseAlias();
+        }
+
+        while (check("join") || check("inner") || check("left")) {
+            JoinClause join;
+            join.left = match("left");
+            if (join.left) {
+                match("outer");
+            } else {
+                match("inner");
+            }
+            if (!match("join") || !check(TokenType::IDENTIFIER)) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+            join.tableName = consume().value;
+            join.alias = parseAlias();
+            if (!match("on")) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+            join.on = parseCondition();
+            if (!join.on.expression) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+            query.joins.push_back(join);
         }
     }
 
     if (match("where")) {
         query.conditions.push_back(parseCondition());
+        if (!query.conditions.back().expression) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
     }
 
-    if (match("order")) {
+    if (match("group")) {
         if (match("by")) {
             if (check(TokenType::IDENTIFIER)) {
-                query.orderByColumn = consume().value;
-            }
-            if (match("desc")) {
-                query.orderByDesc = true;
+                query.groupByColumn = consume().value;
             }
         }
     }
 
-    if (match("group")) {
-        if (match("by")) {
-            if (check(TokenType::IDENTIFIER)) {
-                query.groupByColumn = consume().value;
+    if (match("having")) {
+        query.havingConditions.push_back(parseCondition(&query.aggregates));
+        if (!query.havingConditions.back().expression) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
+    }
+
+    // ORDER BY a, b DESC, ...
+    if (match("order") && match("by")) {
+        do {
+            if (!check(TokenType::IDENTIFIER)) {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+            OrderKey key;
+            key.column = consume().value;
+            Aggregate aggregate;
+            if (check("(") && parseAggregate(key.column, aggregate)) {
+                addAggregate(query.aggregates, aggregate);
+                key.column = aggregate.name;
+            }
+            key.descending = match("desc");
+            if (!key.descending) {
+                match("asc");
             }
+            query.orderBy.push_back(key);
+        } while (match(","));
+    }
+
+    // LIMIT n [OFFSET m]
+    if (match("limit")) {
+        if (!check(TokenType::NUMBER) || !parseCount(consume().value, query.limit)) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
+        if (match("offset") && (!check(TokenType::NUMBER) || !parseCount(consume().value, query.offset))) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
         }
     }
 
+    if (query.joins.empty()) {
+        string qualifier = query.tableAlias.empty() ? query.tableName : query.tableAlias;
+        unqualify(query, qualifier);
+    }
     return query;
 }
 
@@ -199,6 +569,10 @@ ParsedQuery Parser::parseDelete() {
 
     if (match("where")) {
         query.conditions.push_back(parseCondition());
+        if (!query.conditions.back().expression) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
     }
 
     return query;
@@ -245,6 +619,53 @@ ParsedQuery Parser::parseDropTable() {
     return query;
 }
 
+// CREATE INDEX name ON table (column)
+ParsedQuery Parser::parseCreateIndex() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::CREATE_INDEX;
+
+    consume(); // CREATE
+    consume(); // INDEX
+
+    if (check(TokenType::IDENTIFIER)) {
+        query.indexName = consume().value;
+    }
+    if (!match("on") || !check(TokenType::IDENTIFIER)) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+    query.tableName = consume().value;
+
+    if (!match("(") || !check(TokenType::IDENTIFIER)) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+    query.columns.push_back(consume().value);
+    if (!match(")") || query.indexName.empty()) {
+        query.type = ParsedQuery::QueryType::INVALID;
+    }
+    return query;
+}
+
+// DROP INDEX name [ON table]
+ParsedQuery Parser::parseDropIndex() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::DROP_INDEX;
+
+    consume(); // DROP
+    consume(); // INDEX
+
+    if (check(TokenType::IDENTIFIER)) {
+        query.indexName = consume().value;
+    } else {
+        query.type = ParsedQuery::QueryType::INVALID;
+    }
+    if (match("on") && check(TokenType::IDENTIFIER)) {
+        query.tableName = consume().value;
+    }
+    return query;
+}
+
 ParsedQuery Parser::parseUpdate() {
     ParsedQuery query;
     query.type = ParsedQuery::QueryType::UPDATE;
@@ -260,13 +681,10 @@ ParsedQuery Parser::parseUpdate() {
             if (check(TokenType::IDENTIFIER)) {
                 string colName = consume().value;
                 if (match("=")) {
-                    string value;
-                    if (check(TokenType::NUMBER)) {
-                        value = consume().value;
-                    } else if (check(TokenType::STRING)) {
-                        value = consume().value;
-                    } else if (check(TokenType::IDENTIFIER)) {
-                        value = consume().value;
+                    shared_ptr<Expression> value = parseSum(nullptr);
+                    if (!value) {
+                        query.type = ParsedQuery::QueryType::INVALID;
+                        return query;
                     }
                     query.updateValues.push_back({colName, value});
                 }
@@ -281,6 +699,10 @@ ParsedQuery Parser::parseUpdate() {
 
     if (match("where")) {
         query.conditions.push_back(parseCondition());
+        if (!query.conditions.back().expression) {
+            query.type = ParsedQuery::QueryType::INVALID;
+            return query;
+        }
     }
 
     return query;
@@ -323,6 +745,120 @@ ParsedQuery Parser::parseAlterTable() {
     return query;
 }
 
+ParsedQuery Parser::parseSetOption() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::SET_OPTION;
+
+    consume(); // SET
+
+    if (check(TokenType::IDENTIFIER)) {
+        query.optionName = consume().value;
+    }
+
+    if (!match("=")) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+
+    if (check(TokenType::NUMBER) || check(TokenType::STRING) ||
+        check(TokenType::IDENTIFIER) || check(TokenType::KEYWORD)) {
+        query.optionValue = consume().value;
+    }
+
+    return query;
+}
+
+ParsedQuery Parser::parseShow() {
+    ParsedQuery query;
+
+    consume(); // SHOW
+
+    if (match("stats")) {
+        query.type = ParsedQuery::QueryType::SHOW_STATS;
+    }
+
+    return query;
+}
+
+// PREPARE name AS statement
+ParsedQuery Parser::parsePrepare() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::PREPARE;
+
+    consume(); // PREPARE
+
+    if (!check(TokenType::IDENTIFIER)) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+    query.statementName = consume().value;
+    if (!match("as")) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+
+    Parser inner(vector<Token>(tokens.begin() + current, tokens.end()));
+    query.statement = make_shared<ParsedQuery>(inner.parse());
+    switch (query.statement->type) {
+        case ParsedQuery::QueryType::PREPARE:
+        case ParsedQuery::QueryType::EXECUTE:
+        case ParsedQuery::QueryType::DEALLOCATE:
+        case ParsedQuery::QueryType::INVALID:
+            query.type = ParsedQuery::QueryType::INVALID;
+            break;
+        default:
+            break;
+    }
+    return query;
+}
+
+// EXECUTE name [(literal, ...)]
+ParsedQuery Parser::parseExecute() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::EXECUTE;
+
+    consume(); // EXECUTE
+
+    if (!check(TokenType::IDENTIFIER)) {
+        query.type = ParsedQuery::QueryType::INVALID;
+        return query;
+    }
+    query.statementName = consume().value;
+
+    if (match("(") && !match(")")) {
+        do {
+            if (check(TokenType::NUMBER)) {
+                query.arguments.push_back(make_shared<Expression>(Expression::Kind::NUMBER, consume().value));
+            } else if (check(TokenType::STRING)) {
+                query.arguments.push_back(make_shared<Expression>(Expression::Kind::STRING, consume().value));
+            } else {
+                query.type = ParsedQuery::QueryType::INVALID;
+                return query;
+            }
+        } while (match(","));
+        if (!match(")")) {
+            query.type = ParsedQuery::QueryType::INVALID;
+        }
+    }
+    return query;
+}
+
+// DEALLOCATE [PREPARE] name
+ParsedQuery Parser::parseDeallocate() {
+    ParsedQuery query;
+    query.type = ParsedQuery::QueryType::DEALLOCATE;
+
+    consume(); // DEALLOCATE
+    match("prepare");
+
+    if (check(TokenType::IDENTIFIER)) {
+        query.statementName = consume().value;
+    } else {
+        query.type = ParsedQuery::QueryType::INVALID;
+    }
+    return query;
+}
+
 ParsedQuery Parser::parse() {
     ParsedQuery query;
 
@@ -337,15 +873,24 @@ ParsedQuery Parser::parse() {
         Token second = tokens.size() > 1 ? tokens[1] : Token(TokenType::END_OF_INPUT, "");
         if (second.value == "database") {
             query = parseCreateDatabase();
+        } else if (second.value == "index") {
+            query = parseCreateIndex();
         } else {
             query = parseCreateTable();
         }
     } else if (keyword == "use") {
         query = parseUseDatabase();
     } else if (keyword == "drop") {
-        query = parseDropTable();
+        Token second = tokens.size() > 1 ? tokens[1] : Token(TokenType::END_OF_INPUT, "");
+        if (second.value == "index") {
+            query = parseDropIndex();
+        } else {
+            query = parseDropTable();
+        }
     } else if (keyword == "insert") {
         query = parseInsert();
+    } else if (keyword == "copy") {
+        query = parseCopy();
     } else if (keyword == "select") {
         query = parseSelect();
     } else if (keyword == "delete") {
@@ -354,7 +899,23 @@ ParsedQuery Parser::parse() {
         query = parseUpdate();
     } else if (keyword == "alter") {
         query = parseAlterTable();
+    } else if (keyword == "set") {
+        query = parseSetOption();
+    } else if (keyword == "show") {
+        query = parseShow();
+    } else if (keyword == "prepare") {
+        query = parsePrepare();
+    } else if (keyword == "execute") {
+        query = parseExecute();
+    } else if (keyword == "deallocate") {
+        query = parseDeallocate();
     }
 
+    // Those of a prepared statement belong to it
+    if (query.type != ParsedQuery::QueryType::PREPARE) {
+        for (const auto& token : tokens) {
+            if (token.type == TokenType::PARAMETER) query.parameterCount++;
+        }
+    }
     return query;
 }
@@ -0,0 +1,135 @@
+#include "PreparedStatement.h"
+#include "Tokenizer.h"
+using namespace std;
+
+PreparedStatement::PreparedStatement(shared_ptr<const ParsedQuery> parsed)
+    : statement(parsed), arguments(parsed->parameterCount) {}
+
+bool PreparedStatement::bind(size_t index, const Value& value) {
+    if (value.isNumeric()) {
+        return bind(index, make_shared<Expression>(Expression::Kind::NUMBER, value.toString()));
+    }
+    return bind(index, make_shared<Expression>(Expression::Kind::STRING, value.asText()));
+}
+
+bool PreparedStatement::bind(size_t index, const shared_ptr<Expression>& literal) {
+    if (index >= arguments.size() || !literal ||
+        (literal->kind != Expression::Kind::NUMBER && literal->kind != Expression::Kind::STRING)) {
+        return false;
+    }
+    arguments[index] = literal;
+    return true;
+}
+
+void PreparedStatement::clearBindings() {
+    for (auto& argument : arguments) {
+        argument.reset();
+    }
+}
+
+bool PreparedStatement::instantiate(ParsedQuery& query) const {
+    for (const auto& argument : arguments) {
+        if (!argument) return false;
+    }
+    query = *statement;
+    if (arguments.empty()) {
+        return true;
+    }
+
+    for (auto& join : query.joins) {
+        join.on.expression = Expression::substitute(join.on.expression, arguments);
+    }
+    for (auto& condition : query.conditions) {
+        condition.expression = Expression::substitute(condition.expression, arguments);
+    }
+    for (auto& condition : query.havingConditions) {
+        condition.expression = Expression::substitute(condition.expression, arguments);
+    }
+    for (auto& update : query.updateValues) {
+        update.second = Expression::substitute(update.second, arguments);
+    }
+    size_t next = 0;
+    for (auto& row : query.values) {
+        for (size_t i = 0; i < row.size() && next < query.valueParameters.size(); ++i, ++next) {
+            if (query.valueParameters[next] >= 0) {
+                row[i] = arguments[query.valueParameters[next]]->text;
+            }
+        }
+    }
+    query.valueParameters.clear();
+    query.parameterCount = 0;
+    return true;
+}
+
+// A statement with more literals, such as a long multi-row INSERT, rarely
+// comes again in the same shape and is parsed directly
+static const size_t MAX_CACHED_LITERALS = 64;
+
+StatementCache::StatementCache(size_t maxEntries) : capacity(maxEntries), hits(0), misses(0) {}
+
+// Statements whose parse is worth keeping, by the first word of their key
+static bool isCacheable(const string& key) {
+    return key.compare(0, 7, "select ") == 0 || key.compare(0, 7, "insert ") == 0 ||
+           key.compare(0, 7, "update ") == 0 || key.compare(0, 7, "delete ") == 0;
+}
+
+static shared_ptr<Expression> literalOf(const Token& token) {
+    return make_shared<Expression>(
+        token.type == TokenType::NUMBER ? Expression::Kind::NUMBER : Expression::Kind::STRING, token.value);
+}
+
+void StatementCache::parse(const string& sql, ParsedQuery& query) {
+    string key;
+    vector<Token> literals;
+    if (capacity == 0 || !Tokenizer(sql).normalize(key, literals) || !isCacheable(key) ||
+        literals.size() > MAX_CACHED_LITERALS) {
+        query = Parser(Tokenizer(sql).tokenize()).parse();
+        return;
+    }
+
+    auto found = index.find(key);
+    if (found == index.end()) {
+        misses++;
+        // The literals become ?s numbered as normalize() found them
+        vector<Token> tokens = Tokenizer(sql).tokenize();
+        size_t parameters = 0;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            bool count = i > 0 && tokens[i - 1].type == TokenType::KEYWORD &&
+                         (tokens[i - 1].value == "limit" || tokens[i - 1].value == "offset");
+            if ((tokens[i].type == TokenType::NUMBER || tokens[i].type == TokenType::STRING) && !count) {
+                tokens[i] = Token(TokenType::PARAMETER, to_string(parameters++));
+            }
+        }
+        shared_ptr<ParsedQuery> parsed = make_shared<ParsedQuery>(Parser(tokens).parse());
+        if (parameters != literals.size() || parsed->type == ParsedQuery::QueryType::INVALID ||
+            parsed->parameterCount != parameters) {
+            query = Parser(Tokenizer(sql).tokenize()).parse();
+            return;
+        }
+
+        entries.emplace_front(key, PreparedStatement(parsed));
+        index[key] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        found = index.find(key);
+    } else {
+        hits++;
+        entries.splice(entries.begin(), entries, found->second);
+    }
+
+    PreparedStatement statement = found->second->second;
+    for (size_t i = 0; i < literals.size(); ++i) {
+        statement.bind(i, literalOf(literals[i]));
+    }
+    statement.instantiate(query);
+}
+
+void StatementCache::setCapacity(size_t maxEntries) {
+    capacity = maxEntries;
+    while (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
@@ -1,30 +1,37 @@
 #include "Record.h"
 #include "Utils.h"
+#include "ByteBuffer.h"
 using namespace std;
 
+// High bit of the value count marks the typed format; without it every
+// value is a u16 length and text, as written before columns had types
+static const uint16_t TYPED_FORMAT = 0x8000;
+
 Record::Record() {}
 
-Record::Record(const vector<string>& vals)
+Record::Record(const vector<Value>& vals)
     : values(vals) {}
 
-void Record::addValue(const string& value) {
+void Record::addValue(const Value& value) {
     values.push_back(value);
 }
-void Record::setValue(int index, const string& newValue) {
-    if (index >= 0 && index < values.size()) {
-        values[index] = newValue;
-    }
-}
-const string& Record::getValue(size_t index) const {
+
+const Value& Record::get(size_t index) const {
     if (index >= values.size()) {
-        static string empty = "";
+        static Value empty;
         return empty;
     }
     return values[index];
 }
 
-string& Record::getValue(size_t index) {
-    return values[index];
+void Record::set(size_t index, const Value& value) {
+    if (index < values.size()) {
+        values[index] = value;
+    }
+}
+
+string Record::getValue(size_t index) const {
+    return get(index).toString();
 }
 
 size_t Record::getSize() const {
@@ -32,10 +39,73 @@ size_t Record::getSize() const {
 }
 
 string Record::toCSV() const {
-    return Utils::join(values, ",");
+    vector<string> fields;
+    for (const auto& value : values) {
+        fields.push_back(value.toString());
+    }
+    return Utils::join(fields, ",");
 }
 
 Record Record::fromCSV(const string& line) {
-    vector<string> values = Utils::split(line, ',');
-    return Record(values);
+    Record record;
+    for (const auto& field : Utils::split(line, ',')) {
+        record.values.push_back(Value::fromText(field));
+    }
+    return record;
+}
+
+// [u16 count | 0x8000] then per value a type tag and its payload: a
+// zigzag varint for INT, 8 bytes for DOUBLE, varint length + bytes for TEXT
+string Record::serialize() const {
+    string out;
+    ByteWriter writer(out);
+    writer.put<uint16_t>(static_cast<uint16_t>(values.size()) | TYPED_FORMAT);
+    for (const auto& value : values) {
+        writer.put<uint8_t>(static_cast<uint8_t>(value.getType()));
+        switch (value.getType()) {
+            case ColumnType::INT: {
+                int64_t number = value.asInt();
+                writer.putVarint((static_cast<uint64_t>(number) << 1) ^ static_cast<uint64_t>(number >> 63));
+                break;
+            }
+            case ColumnType::DOUBLE:
+                writer.put<double>(value.asDouble());
+                break;
+            default:
+                writer.putVarint(value.asText().size());
+                out.append(value.asText());
+                break;
+        }
+    }
+    return out;
+}
+
+Record Record::deserialize(const char* data, int length) {
+    Record record;
+    ByteReader reader(data, length);
+    uint16_t count = reader.get<uint16_t>();
+    bool typed = (count & TYPED_FORMAT) != 0;
+    count &= ~TYPED_FORMAT;
+    record.values.reserve(count);
+    for (uint16_t i = 0; i < count && reader.ok; ++i) {
+        if (!typed) {
+            uint16_t size = reader.get<uint16_t>();
+            record.values.push_back(Value::fromText(reader.getBytes(size)));
+            continue;
+        }
+        switch (static_cast<ColumnType>(reader.get<uint8_t>())) {
+            case ColumnType::INT: {
+                uint64_t zigzag = reader.getVarint();
+                record.values.push_back(Value::fromInt(static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1)));
+                break;
+            }
+            case ColumnType::DOUBLE:
+                record.values.push_back(Value::fromDouble(reader.get<double>()));
+                break;
+            default:
+                record.values.push_back(Value::fromText(reader.getBytes(static_cast<size_t>(reader.getVarint()))));
+                break;
+        }
+    }
+    return record;
 }
@@ -0,0 +1,68 @@
+#include "RecordBitmap.h"
+#include <algorithm>
+using namespace std;
+
+void RecordBitmap::add(RecordID rid) {
+    vector<uint64_t>& words = pages[recordPage(rid)];
+    size_t slot = static_cast<size_t>(recordSlot(rid));
+    if (words.size() <= slot / 64) {
+        words.resize(slot / 64 + 1, 0);
+    }
+    words[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void RecordBitmap::add(const vector<RecordID>& rids) {
+    for (RecordID rid : rids) {
+        add(rid);
+    }
+}
+
+// Pages left without a bit are dropped, so empty() stays exact
+void RecordBitmap::intersectWith(const RecordBitmap& other) {
+    for (auto it = pages.begin(); it != pages.end();) {
+        auto match = other.pages.find(it->first);
+        bool any = false;
+        if (match != other.pages.end()) {
+            vector<uint64_t>& words = it->second;
+            const vector<uint64_t>& mask = match->second;
+            words.resize(min(words.size(), mask.size()));
+            for (size_t i = 0; i < words.size(); ++i) {
+                words[i] &= mask[i];
+                any = any || words[i] != 0;
+            }
+        }
+        it = any ? next(it) : pages.erase(it);
+    }
+}
+
+void RecordBitmap::unionWith(const RecordBitmap& other) {
+    for (const auto& page : other.pages) {
+        vector<uint64_t>& words = pages[page.first];
+        if (words.size() < page.second.size()) {
+            words.resize(page.second.size(), 0);
+        }
+        for (size_t i = 0; i < page.second.size(); ++i) {
+            words[i] |= page.second[i];
+        }
+    }
+}
+
+size_t RecordBitmap::count() const {
+    size_t total = 0;
+    for (const auto& page : pages) {
+        for (uint64_t word : page.second) {
+            total += __builtin_popcountll(word);
+        }
+    }
+    return total;
+}
+
+void RecordBitmap::toVector(vector<RecordID>& rids) const {
+    for (const auto& page : pages) {
+        for (size_t i = 0; i < page.second.size(); ++i) {
+            for (uint64_t bits = page.second[i]; bits; bits &= bits - 1) {
+                rids.push_back(makeRecordID(page.first, static_cast<int>(i * 64 + __builtin_ctzll(bits))));
+            }
+        }
+    }
+}
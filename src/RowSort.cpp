@@ -0,0 +1,220 @@
+#include "RowSort.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+// False when the column mixes numbers and text, which have no shared
+// prefix. exact is set when equal prefixes mean equal values.
+bool RowSort::prefixKeys(const vector<Record>& rows, const SortKey& key, vector<uint64_t>& prefixes, bool& exact) {
+    bool anyText = false, anyDouble = false, anyInt = false;
+    for (const auto& row : rows) {
+        ColumnType type = row.get(key.column).getType();
+        anyText = anyText || type == ColumnType::TEXT;
+        anyDouble = anyDouble || type == ColumnType::DOUBLE;
+        anyInt = anyInt || type == ColumnType::INT;
+    }
+    if (anyText && (anyDouble || anyInt)) {
+        return false;
+    }
+    exact = !anyText && !(anyDouble && anyInt);
+
+    prefixes.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const Value& value = rows[i].get(key.column);
+        uint64_t bits;
+        if (anyText) {
+            // Big-endian first bytes; longer strings sharing them tie here
+            const string& text = value.asText();
+            bits = 0;
+            for (size_t b = 0; b < 8; ++b) {
+                bits = (bits << 8) | (b < text.size() ? static_cast<uint8_t>(text[b]) : 0);
+            }
+        } else if (anyDouble) {
+            double number = value.asDouble() == 0 ? 0.0 : value.asDouble();
+            memcpy(&bits, &number, sizeof(bits));
+            bits = (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL;
+        } else {
+            bits = static_cast<uint64_t>(value.asInt()) ^ 0x8000000000000000ULL;
+        }
+        prefixes[i] = key.descending ? ~bits : bits;
+    }
+    return true;
+}
+
+// LSD radix sort, a byte per pass; passes where every row has the same
+// byte are skipped. Stable, so equal prefixes keep their order.
+void RowSort::radixSort(vector<uint64_t>& prefixes, vector<uint32_t>& order) {
+    size_t n = order.size();
+    vector<size_t> counts(8 * 256, 0);
+    for (uint64_t prefix : prefixes) {
+        for (int pass = 0; pass < 8; ++pass) {
+            counts[pass * 256 + ((prefix >> (pass * 8)) & 0xFF)]++;
+        }
+    }
+
+    vector<uint64_t> prefixTemp(n);
+    vector<uint32_t> orderTemp(n);
+    for (int pass = 0; pass < 8; ++pass) {
+        size_t* count = &counts[pass * 256];
+        if (count[(prefixes[0] >> (pass * 8)) & 0xFF] == n) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t target = count[(prefixes[i] >> (pass * 8)) & 0xFF]++;
+            prefixTemp[target] = prefixes[i];
+            orderTemp[target] = order[i];
+        }
+        prefixes.swap(prefixTemp);
+        order.swap(orderTemp);
+    }
+}
+
+vector<uint32_t> RowSort::order(const vector<Record>& rows, const vector<SortKey>& keys) {
+    vector<uint32_t> order(rows.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    if (rows.size() < 2 || keys.empty()) {
+        return order;
+    }
+
+    auto less = [&rows, &keys](uint32_t a, uint32_t b) {
+        for (const auto& key : keys) {
+            int c = rows[a].get(key.column).compare(rows[b].get(key.column));
+            if (c != 0) {
+                return key.descending ? c > 0 : c < 0;
+            }
+        }
+        return false;
+    };
+
+    vector<uint64_t> prefixes;
+    bool exact = false;
+    if (!prefixKeys(rows, keys[0], prefixes, exact)) {
+        stable_sort(order.begin(), order.end(), less);
+        return order;
+    }
+    radixSort(prefixes, order);
+
+    // Runs of equal prefixes are finished on the full values; an exact
+    // prefix leaves only the later keys to compare
+    for (size_t start = 0; start < order.size();) {
+        size_t end = start + 1;
+        while (end < order.size() && prefixes[end] == prefixes[start]) {
+            ++end;
+        }
+        if (end - start > 1 && (keys.size() > 1 || !exact)) {
+            stable_sort(order.begin() + start, order.begin() + end, less);
+        }
+        start = end;
+    }
+    return order;
+}
+
+void RowSort::sort(vector<Record>& rows, const vector<SortKey>& keys) {
+    vector<uint32_t> positions = order(rows, keys);
+    vector<Record> sorted;
+    sorted.reserve(rows.size());
+    for (uint32_t position : positions) {
+        sorted.push_back(move(rows[position]));
+    }
+    rows.swap(sorted);
+}
+
+int RowSort::compare(const Record& a, const Record& b, const vector<SortKey>& keys) {
+    for (const auto& key : keys) {
+        int c = a.get(key.column).compare(b.get(key.column));
+        if (c != 0) {
+            return key.descending ? -c : c;
+        }
+    }
+    return 0;
+}
+
+LoserTree::LoserTree(const vector<SortKey>& sortKeys, size_t runs)
+    : keys(sortKeys), heads(runs), exhausted(runs, false), nodes(max<size_t>(runs, 1), 0) {}
+
+// Exhausted runs lose to every other run
+bool LoserTree::beats(size_t a, size_t b) const {
+    if (exhausted[a] || exhausted[b]) {
+        return exhausted[a] == exhausted[b] ? a < b : exhausted[b];
+    }
+    int c = RowSort::compare(heads[a], heads[b], keys);
+    return c != 0 ? c < 0 : a < b;
+}
+
+// Leaves are nodes k .. 2k-1; returns the winner below node
+size_t LoserTree::play(size_t node) {
+    if (node >= heads.size()) {
+        return node - heads.size();
+    }
+    size_t left = play(2 * node), right = play(2 * node + 1);
+    if (beats(left, right)) {
+        nodes[node] = right;
+        return left;
+    }
+    nodes[node] = left;
+    return right;
+}
+
+void LoserTree::build() {
+    if (heads.size() > 1) {
+        nodes[0] = play(1);
+    }
+}
+
+void LoserTree::replay() {
+    size_t winner = nodes[0];
+    for (size_t node = (winner + heads.size()) / 2; node >= 1; node /= 2) {
+        if (beats(nodes[node], winner)) {
+            swap(nodes[node], winner);
+        }
+    }
+    nodes[0] = winner;
+}
+
+TopN::TopN(const vector<SortKey>& sortKeys, size_t maxRows)
+    : keys(sortKeys), limit(maxRows), added(0) {}
+
+bool TopN::before(const Entry& a, const Entry& b) const {
+    int c = RowSort::compare(a.record, b.record, keys);
+    return c != 0 ? c < 0 : a.sequence < b.sequence;
+}
+
+void TopN::add(const Record& record) {
+    uint64_t sequence = added++;
+    if (limit == 0) {
+        return;
+    }
+    auto worstFirst = [this](const Entry& a, const Entry& b) { return before(a, b); };
+    if (heap.size() < limit) {
+        heap.push_back({record, sequence});
+        push_heap(heap.begin(), heap.end(), worstFirst);
+        return;
+    }
+    // A later row that only ties the worst kept row loses to it
+    if (RowSort::compare(record, heap.front().record, keys) >= 0) {
+        return;
+    }
+    pop_heap(heap.begin(), heap.end(), worstFirst);
+    heap.back() = {record, sequence};
+    push_heap(heap.begin(), heap.end(), worstFirst);
+}
+
+vector<Record> TopN::finish() {
+    auto worstFirst = [this](const Entry& a, const Entry& b) { return before(a, b); };
+    sort_heap(heap.begin(), heap.end(), worstFirst);
+    vector<Record> rows;
+    rows.reserve(heap.size());
+    for (auto& entry : heap) {
+        rows.push_back(move(entry.record));
+    }
+    heap.clear();
+    return rows;
+}
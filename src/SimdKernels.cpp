@@ -0,0 +1,211 @@
+#include "SimdKernels.h"
+#include <cstring>
+#include <functional>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+using namespace std;
+
+typedef BoundCondition::Op Op;
+
+namespace {
+
+enum class Level { SCALAR, SSE42, AVX2 };
+
+Level detectLevel() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return Level::SSE42;
+#endif
+    return Level::SCALAR;
+}
+
+Level level() {
+    static const Level detected = detectLevel();
+    return detected;
+}
+
+// Mask words from firstWord on; vector kernels use it for their tail
+template <typename T, typename Compare>
+void scalarLoop(const T* values, size_t n, T constant, uint64_t* mask, size_t firstWord, Compare compare) {
+    for (size_t word = firstWord; word * 64 < n; ++word) {
+        size_t begin = word * 64;
+        size_t count = n - begin < 64 ? n - begin : 64;
+        uint64_t bits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            bits |= static_cast<uint64_t>(compare(values[begin + i], constant)) << i;
+        }
+        mask[word] = bits;
+    }
+}
+
+template <typename T>
+void compareScalar(const T* values, size_t n, Op op, T constant, uint64_t* mask, size_t firstWord) {
+    switch (op) {
+        case Op::EQ: scalarLoop(values, n, constant, mask, firstWord, equal_to<T>()); break;
+        case Op::NE: scalarLoop(values, n, constant, mask, firstWord, not_equal_to<T>()); break;
+        case Op::LT: scalarLoop(values, n, constant, mask, firstWord, less<T>()); break;
+        case Op::LE: scalarLoop(values, n, constant, mask, firstWord, less_equal<T>()); break;
+        case Op::GT: scalarLoop(values, n, constant, mask, firstWord, greater<T>()); break;
+        case Op::GE: scalarLoop(values, n, constant, mask, firstWord, greater_equal<T>()); break;
+        default:
+            for (size_t word = firstWord; word * 64 < n; ++word) mask[word] = 0;
+            break;
+    }
+}
+
+#ifdef SIMD_X86
+
+// Integers only have "equal" and "greater than" instructions: LT swaps the
+// operands, and NE, LE and GE invert EQ, GT and LT
+struct IntCompareShape {
+    bool equality;
+    bool swap;
+    bool invert;
+
+    explicit IntCompareShape(Op op)
+        : equality(op == Op::EQ || op == Op::NE),
+          swap(op == Op::LT || op == Op::GE),
+          invert(op == Op::NE || op == Op::LE || op == Op::GE) {}
+};
+
+__attribute__((target("avx2")))
+void compareIntsAvx2(const int64_t* values, size_t n, Op op, int64_t constant, uint64_t* mask) {
+    IntCompareShape shape(op);
+    __m256i c = _mm256_set1_epi64x(constant);
+    size_t words = n / 64;
+    for (size_t word = 0; word < words; ++word) {
+        const int64_t* block = values + word * 64;
+        uint64_t bits = 0;
+        for (size_t k = 0; k < 16; ++k) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + k * 4));
+            __m256i r = shape.equality ? _mm256_cmpeq_epi64(v, c)
+                      : shape.swap ? _mm256_cmpgt_epi64(c, v) : _mm256_cmpgt_epi64(v, c);
+            bits |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(r))) << (k * 4);
+        }
+        mask[word] = shape.invert ? ~bits : bits;
+    }
+    compareScalar(values, n, op, constant, mask, words);
+}
+
+__attribute__((target("sse4.2")))
+void compareIntsSse42(const int64_t* values, size_t n, Op op, int64_t constant, uint64_t* mask) {
+    IntCompareShape shape(op);
+    __m128i c = _mm_set1_epi64x(constant);
+    size_t words = n / 64;
+    for (size_t word = 0; word < words; ++word) {
+        const int64_t* block = values + word * 64;
+        uint64_t bits = 0;
+        for (size_t k = 0; k < 32; ++k) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + k * 2));
+            __m128i r = shape.equality ? _mm_cmpeq_epi64(v, c)
+                      : shape.swap ? _mm_cmpgt_epi64(c, v) : _mm_cmpgt_epi64(v, c);
+            bits |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(r))) << (k * 2);
+        }
+        mask[word] = shape.invert ? ~bits : bits;
+    }
+    compareScalar(values, n, op, constant, mask, words);
+}
+
+// The predicate is an immediate operand, hence one instantiation per operator
+template <int Predicate>
+__attribute__((target("avx2")))
+void compareDoublesAvx2(const double* values, size_t n, double constant, uint64_t* mask) {
+    __m256d c = _mm256_set1_pd(constant);
+    size_t words = n / 64;
+    for (size_t word = 0; word < words; ++word) {
+        const double* block = values + word * 64;
+        uint64_t bits = 0;
+        for (size_t k = 0; k < 16; ++k) {
+            __m256d r = _mm256_cmp_pd(_mm256_loadu_pd(block + k * 4), c, Predicate);
+            bits |= static_cast<uint64_t>(_mm256_movemask_pd(r)) << (k * 4);
+        }
+        mask[word] = bits;
+    }
+}
+
+// SSE2 has every double comparison, so this is also the SSE4.2 version
+template <typename Compare>
+void compareDoublesSse(const double* values, size_t n, double constant, uint64_t* mask, Compare compare) {
+    __m128d c = _mm_set1_pd(constant);
+    size_t words = n / 64;
+    for (size_t word = 0; word < words; ++word) {
+        const double* block = values + word * 64;
+        uint64_t bits = 0;
+        for (size_t k = 0; k < 32; ++k) {
+            bits |= static_cast<uint64_t>(_mm_movemask_pd(compare(_mm_loadu_pd(block + k * 2), c))) << (k * 2);
+        }
+        mask[word] = bits;
+    }
+}
+
+#endif
+
+}  // namespace
+
+void SimdKernels::compareInts(const int64_t* values, size_t n, Op op, int64_t constant, uint64_t* mask) {
+#ifdef SIMD_X86
+    if (op != Op::INVALID) {
+        if (level() == Level::AVX2) return compareIntsAvx2(values, n, op, constant, mask);
+        if (level() == Level::SSE42) return compareIntsSse42(values, n, op, constant, mask);
+    }
+#endif
+    compareScalar(values, n, op, constant, mask, 0);
+}
+
+void SimdKernels::compareDoubles(const double* values, size_t n, Op op, double constant, uint64_t* mask) {
+#ifdef SIMD_X86
+    // Ordered predicates, except NE: column values are never NaN
+    if (level() == Level::AVX2) {
+        switch (op) {
+            case Op::EQ: compareDoublesAvx2<_CMP_EQ_OQ>(values, n, constant, mask); break;
+            case Op::NE: compareDoublesAvx2<_CMP_NEQ_UQ>(values, n, constant, mask); break;
+            case Op::LT: compareDoublesAvx2<_CMP_LT_OQ>(values, n, constant, mask); break;
+            case Op::LE: compareDoublesAvx2<_CMP_LE_OQ>(values, n, constant, mask); break;
+            case Op::GT: compareDoublesAvx2<_CMP_GT_OQ>(values, n, constant, mask); break;
+            case Op::GE: compareDoublesAvx2<_CMP_GE_OQ>(values, n, constant, mask); break;
+            default: return compareScalar(values, n, op, constant, mask, 0);
+        }
+        return compareScalar(values, n, op, constant, mask, n / 64);
+    }
+    if (level() == Level::SSE42) {
+        switch (op) {
+            case Op::EQ: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmpeq_pd(a, b); }); break;
+            case Op::NE: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmpneq_pd(a, b); }); break;
+            case Op::LT: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmplt_pd(a, b); }); break;
+            case Op::LE: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmple_pd(a, b); }); break;
+            case Op::GT: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); }); break;
+            case Op::GE: compareDoublesSse(values, n, constant, mask, [](__m128d a, __m128d b) { return _mm_cmpge_pd(a, b); }); break;
+            default: return compareScalar(values, n, op, constant, mask, 0);
+        }
+        return compareScalar(values, n, op, constant, mask, n / 64);
+    }
+#endif
+    compareScalar(values, n, op, constant, mask, 0);
+}
+
+void SimdKernels::equalTexts(const string* values, size_t n, const string& constant, uint64_t* mask) {
+    size_t length = constant.size();
+    const char* data = constant.data();
+    for (size_t word = 0; word * 64 < n; ++word) {
+        size_t begin = word * 64;
+        size_t count = n - begin < 64 ? n - begin : 64;
+        uint64_t bits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const string& value = values[begin + i];
+            bool equal = value.size() == length && memcmp(value.data(), data, length) == 0;
+            bits |= static_cast<uint64_t>(equal) << i;
+        }
+        mask[word] = bits;
+    }
+}
+
+const char* SimdKernels::instructionSet() {
+    switch (level()) {
+        case Level::AVX2: return "avx2";
+        case Level::SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,93 @@
+#include "SpillFile.h"
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+using namespace std;
+
+static const char SPILL_PREFIX[] = "spill_";
+static const char SPILL_SUFFIX[] = ".tmp";
+
+SpillFile::SpillFile(const string& directory, size_t bufferBytes) : file(nullptr), rows(0), bytes(0) {
+    if (directory.empty()) {
+        file = tmpfile();
+    } else {
+        string name = directory + "/" + SPILL_PREFIX + "XXXXXX" + SPILL_SUFFIX;
+        int fd = mkstemps(&name[0], static_cast<int>(sizeof(SPILL_SUFFIX) - 1));
+        if (fd >= 0) {
+            file = fdopen(fd, "w+b");
+            if (file) {
+                path = name;
+            } else {
+                close(fd);
+                unlink(name.c_str());
+            }
+        }
+    }
+    if (file && bufferBytes > 0) {
+        ioBuffer.reset(new char[bufferBytes]);
+        setvbuf(file, ioBuffer.get(), _IOFBF, bufferBytes);
+    }
+}
+
+SpillFile::~SpillFile() {
+    if (file) {
+        fclose(file);
+    }
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+}
+
+// Each row is its serialized form after a 4-byte length
+bool SpillFile::write(const Record& row) {
+    if (!file) {
+        return false;
+    }
+    string data = row.serialize();
+    uint32_t length = static_cast<uint32_t>(data.size());
+    if (fwrite(&length, sizeof(length), 1, file) != 1 ||
+        (length > 0 && fwrite(data.data(), length, 1, file) != 1)) {
+        return false;
+    }
+    ++rows;
+    bytes += sizeof(length) + length;
+    return true;
+}
+
+void SpillFile::rewind() {
+    if (file) {
+        fflush(file);
+        fseek(file, 0, SEEK_SET);
+    }
+}
+
+bool SpillFile::read(Record& row) {
+    uint32_t length;
+    if (!file || fread(&length, sizeof(length), 1, file) != 1) {
+        return false;
+    }
+    buffer.resize(length);
+    if (length > 0 && fread(&buffer[0], length, 1, file) != 1) {
+        return false;
+    }
+    row = Record::deserialize(buffer.data(), static_cast<int>(length));
+    return true;
+}
+
+void SpillFile::removeLeftovers(const string& directory) {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    const size_t prefix = sizeof(SPILL_PREFIX) - 1, suffix = sizeof(SPILL_SUFFIX) - 1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string filename = entry->d_name;
+        if (filename.size() > prefix + suffix && filename.compare(0, prefix, SPILL_PREFIX) == 0 &&
+            filename.compare(filename.size() - suffix, suffix, SPILL_SUFFIX) == 0) {
+            unlink((directory + "/" + filename).c_str());
+        }
+    }
+    closedir(dir);
+}
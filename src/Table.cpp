@@ -2,17 +2,49 @@
 #include "Table.h"
 #include "FileManager.h"
 #include "Utils.h"
-#include "AVLTree.h"
+#include "ByteBuffer.h"
 #include <iostream>
 #include <algorithm>
 #include <memory>   // for make_unique (optional but explicit)
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <dirent.h>
+#include <unistd.h>
 using namespace std;
 
-Table::Table(const string& name, const vector<string>& cols, const string& primaryKey)
-    : tableName(name), columns(cols), primaryKeyColumn(primaryKey) {
-    // create primary index (B+ tree) even if no primaryKey specified;
-    // the BPlusTree implementation can ignore inserts if primaryKey is empty.
-    primaryIndex = make_unique<BPlusTree>();
+Table::Table(const string& name, const vector<string>& cols, const vector<ColumnType>& types,
+             const string& filename, shared_ptr<BufferPool> pool, const string& primaryKey,
+             int indexFanout, int indexFillFactor)
+    : tableName(name), columns(cols), columnTypes(types), bufferPool(pool),
+      primaryKeyColumn(primaryKey), createLSN(0), indexesStale(false) {
+    columnTypes.resize(columns.size(), ColumnType::TEXT);
+    if (getColumnIndex(primaryKeyColumn) < 0) {
+        primaryKeyColumn.clear();
+    }
+    heap = make_unique<PageManager>(filename, pool);
+    heap->create();
+    heap->setHeader(serializeHeader());
+    if (!primaryKeyColumn.empty()) {
+        primaryIndex = make_unique<BPlusTree>(indexFileFor(filename, "pk"), pool);
+        primaryIndex->create(indexFanout, indexFillFactor);
+    }
+}
+
+Table::Table(const string& name, shared_ptr<BufferPool> pool, unique_ptr<PageManager> existingHeap)
+    : tableName(name), bufferPool(pool), heap(move(existingHeap)), createLSN(0), indexesStale(false) {}
+
+// Index files sit next to the table file: users.tbl -> users.pk.idx
+string Table::indexFileFor(const string& tableFile, const string& indexName) {
+    string base = tableFile;
+    const string suffix = ".tbl";
+    if (base.size() >= suffix.size() && base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        base.erase(base.size() - suffix.size());
+    }
+    return base + "." + indexName + ".idx";
 }
 
 const string& Table::getTableName() const {
@@ -23,14 +55,128 @@ const vector<string>& Table::getColumns() const {
     return columns;
 }
 
-// const getter (declared in header)
-const vector<Record>& Table::getRows() const {
-    return rows;
+const vector<ColumnType>& Table::getColumnTypes() const {
+    return columnTypes;
+}
+
+const string& Table::getFileName() const {
+    return heap->getFileName();
+}
+
+const string& Table::getPrimaryKeyColumn() const {
+    return primaryKeyColumn;
+}
+
+bool Table::createIndex(const string& name, const string& column, int fanout, int fillFactor) {
+    if (name == "pk" || hasIndex(name) || getColumnIndex(column) < 0) {
+        return false;
+    }
+
+    SecondaryIndex index;
+    index.name = name;
+    index.column = columns[getColumnIndex(column)];
+    index.tree.reset(new BPlusTree(indexFileFor(heap->getFileName(), name), bufferPool));
+    if (!index.tree->create(fanout, fillFactor)) {
+        return false;
+    }
+
+    vector<pair<string, RecordID>> keys;
+    scan([&](RecordID rid, const Record& record) {
+        keys.push_back({secondaryKey(columnValue(record, index.column), rid), rid});
+    });
+    sort(keys.begin(), keys.end());
+    if (!index.tree->bulkLoad(keys)) {
+        // a value too long to index
+        string file = index.tree->getFileName();
+        index.tree.reset();
+        remove(file.c_str());
+        return false;
+    }
+
+    secondaryIndexes.push_back(move(index));
+    if (!heap->setHeader(serializeHeader())) {
+        // its definition does not fit the table header
+        string file = secondaryIndexes.back().tree->getFileName();
+        secondaryIndexes.pop_back();
+        remove(file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Table::dropIndex(const string& name) {
+    for (auto it = secondaryIndexes.begin(); it != secondaryIndexes.end(); ++it) {
+        if (it->name == name) {
+            string file = it->tree->getFileName();
+            secondaryIndexes.erase(it);
+            remove(file.c_str());
+            heap->setHeader(serializeHeader());
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Table::hasIndex(const string& name) const {
+    for (const auto& index : secondaryIndexes) {
+        if (index.name == name) return true;
+    }
+    return false;
+}
+
+vector<pair<string, string>> Table::getIndexes() const {
+    vector<pair<string, string>> result;
+    for (const auto& index : secondaryIndexes) {
+        result.push_back({index.name, index.column});
+    }
+    return result;
+}
+
+void Table::scan(const function<void(RecordID, const Record&)>& visit) const {
+    heap->scan([&visit](RecordID rid, const char* bytes, int length) {
+        visit(rid, Record::deserialize(bytes, length));
+        return true;
+    });
+}
+
+void Table::scanWhile(const function<bool(RecordID, const Record&)>& visit) const {
+    heap->scan([&visit](RecordID rid, const char* bytes, int length) {
+        return visit(rid, Record::deserialize(bytes, length));
+    });
+}
+
+bool Table::makeRecord(const vector<string>& values, Record& record) const {
+    if (values.size() != columns.size()) {
+        return false;
+    }
+    record = Record();
+    for (size_t i = 0; i < values.size(); ++i) {
+        Value value;
+        if (!Value::parse(values[i], columnTypes[i], value)) {
+            return false;
+        }
+        record.addValue(value);
+    }
+    return true;
+}
+
+int Table::getPageCount() const {
+    return heap->getPageCount();
 }
 
-// non-const getter (implementation was missing and caused linker errors)
-vector<Record>& Table::getRows() {
-    return rows;
+void Table::scanPage(int pageID, const function<void(RecordID, const Record&)>& visit) const {
+    heap->scanPage(pageID, [&visit](RecordID rid, const char* bytes, int length) {
+        visit(rid, Record::deserialize(bytes, length));
+    });
+}
+
+bool Table::readRow(RecordID rid, Record& record) const {
+    string bytes;
+    if (!heap->readRecord(rid, bytes)) {
+        return false;
+    }
+    record = Record::deserialize(bytes.data(), static_cast<int>(bytes.size()));
+    return true;
 }
 
 int Table::getColumnIndex(const string& columnName) const {
@@ -42,155 +188,810 @@ int Table::getColumnIndex(const string& columnName) const {
     return -1;
 }
 
-double Table::toNumber(const string& val) const {
-    try {
-        return stod(val);
-    } catch (...) {
-        return 0.0;
+unique_ptr<BoundExpression> Table::bindCondition(const Condition& condition) const {
+    return BoundExpression::bind(*condition.toExpression(), columns, columnTypes);
+}
+
+// Big-endian so that memcmp order is numeric order: INT flips the sign bit;
+// DOUBLE flips the sign bit of positives and every bit of negatives. TEXT
+// escapes 0x00 as 00 FF and ends with 00 00, so no key is a prefix of
+// another and a record id can follow it.
+string Table::indexKey(const Value& value) {
+    uint64_t bits;
+    switch (value.getType()) {
+        case ColumnType::INT:
+            bits = static_cast<uint64_t>(value.asInt()) ^ 0x8000000000000000ULL;
+            break;
+        case ColumnType::DOUBLE: {
+            double number = value.asDouble() == 0 ? 0.0 : value.asDouble();  // -0.0 == 0.0
+            memcpy(&bits, &number, sizeof(bits));
+            bits = (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL;
+            break;
+        }
+        default: {
+            string key;
+            key.reserve(value.asText().size() + 2);
+            for (char c : value.asText()) {
+                key.push_back(c);
+                if (c == '\x00') key.push_back('\xff');
+            }
+            key.append(2, '\x00');
+            return key;
+        }
+    }
+    string key;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        key.push_back(static_cast<char>((bits >> shift) & 0xFF));
+    }
+    return key;
+}
+
+string Table::secondaryKey(const Value& value, RecordID rid) {
+    string key = indexKey(value);
+    appendRecordID(key, rid);
+    return key;
+}
+
+void Table::appendRecordID(string& key, RecordID rid) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        key.push_back(static_cast<char>((static_cast<uint64_t>(rid) >> shift) & 0xFF));
     }
 }
 
-bool Table::evaluateCondition(const Record& record, const Condition& condition) const {
-    int colIndex = getColumnIndex(condition.columnName);
-    if (colIndex < 0 || colIndex >= static_cast<int>(record.getSize())) {
+const Value& Table::columnValue(const Record& record, const string& column) const {
+    return record.get(static_cast<size_t>(getColumnIndex(column)));
+}
+
+string Table::primaryKeyOf(const Record& record) const {
+    return indexKey(columnValue(record, primaryKeyColumn));
+}
+
+bool Table::indexKeysFit(const Record& record) const {
+    const size_t limit = BPlusTreeNode::MAX_KEY_SIZE;
+    if (primaryIndex && primaryKeyOf(record).size() > limit) {
         return false;
     }
+    for (const auto& index : secondaryIndexes) {
+        if (indexKey(columnValue(record, index.column)).size() + 8 > limit) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    string recordValue = record.getValue(colIndex);
-    string conditionValue = condition.value;
+void Table::indexRow(RecordID rid, const Record& record) {
+    if (primaryIndex) {
+        string key = primaryKeyOf(record);
+        // an update may take over a key another row of the statement gives up
+        if (!primaryIndex->insert(key, rid)) {
+            primaryIndex->remove(key);
+            primaryIndex->insert(key, rid);
+        }
+    }
+    for (auto& index : secondaryIndexes) {
+        index.tree->insert(secondaryKey(columnValue(record, index.column), rid), rid);
+    }
+}
 
-    if (condition.op == "=" || condition.op == "==") {
-        return recordValue == conditionValue;
-    } else if (condition.op == "!=") {
-        return recordValue != conditionValue;
-    } else if (condition.op == ">") {
-        return toNumber(recordValue) > toNumber(conditionValue);
-    } else if (condition.op == "<") {
-        return toNumber(recordValue) < toNumber(conditionValue);
-    } else if (condition.op == ">=") {
-        return toNumber(recordValue) >= toNumber(conditionValue);
-    } else if (condition.op == "<=") {
-        return toNumber(recordValue) <= toNumber(conditionValue);
+void Table::unindexRow(RecordID rid, const Record& record) {
+    if (primaryIndex) {
+        string key = primaryKeyOf(record);
+        if (primaryIndex->search(key) == rid) {
+            primaryIndex->remove(key);
+        }
     }
-    return false;
+    for (auto& index : secondaryIndexes) {
+        index.tree->remove(secondaryKey(columnValue(record, index.column), rid));
+    }
+}
+
+// Candidate record ids for a predicate on an indexed column. Ranges may
+// return extra rows, so callers still check the condition.
+const BPlusTree* Table::indexFor(const BoundCondition& condition, bool& unique) const {
+    unique = false;
+    if (condition.column < 0 || condition.op == BoundCondition::Op::NE ||
+        condition.op == BoundCondition::Op::INVALID ||
+        condition.constant.getType() != columnTypes[condition.column]) {
+        return nullptr;
+    }
+    return indexOn(condition.column, unique);
 }
 
-void Table::insertRow(const Record& record) {
-    rows.push_back(record);
-    if (!primaryKeyColumn.empty() && record.getSize() > 0) {
-        int pkIndex = getColumnIndex(primaryKeyColumn);
-        if (pkIndex >= 0) {
-            // store pointer/row index in B+ tree leaf
-            primaryIndex->insert(record.getValue(pkIndex), static_cast<int>(rows.size() - 1));
+const BPlusTree* Table::indexOn(int position, bool& unique) const {
+    unique = false;
+    if (position < 0 || position >= static_cast<int>(columns.size())) {
+        return nullptr;
+    }
+    string column = Utils::toLower(columns[position]);
+    if (primaryIndex && column == Utils::toLower(primaryKeyColumn)) {
+        unique = true;
+        return primaryIndex.get();
+    }
+    for (const auto& index : secondaryIndexes) {
+        if (column == Utils::toLower(index.column)) {
+            return index.tree.get();
         }
     }
+    return nullptr;
 }
 
-void Table::deleteWhere(const Condition& condition) {
-    // If you want the primaryIndex to remain consistent, you'd need to rebuild it
-    // after deletion (or update it on each deletion). For now, do a simple erase-by-condition.
-    rows.erase(
-        remove_if(rows.begin(), rows.end(),
-                       [this, &condition](const Record& r) {
-                           return evaluateCondition(r, condition);
-                       }),
-        rows.end()
-    );
+bool Table::hasIndexOn(int column) const {
+    bool unique;
+    return indexOn(column, unique) != nullptr;
+}
 
-    // NOTE: primaryIndex is not updated here. If you rely on the index after deletes,
-    // you should rebuild it (iterate rows and re-insert keys) or mark deleted entries in data pages.
+// Index keys sort as the values they encode, so this is the column's order
+bool Table::indexOrder(int column, vector<RecordID>& rids) const {
+    bool unique;
+    const BPlusTree* tree = indexOn(column, unique);
+    if (!tree) {
+        return false;
+    }
+    tree->scanFrom("", [&rids](const string&, RecordID rid) {
+        rids.push_back(rid);
+        return true;
+    });
+    return true;
+}
+
+bool Table::canUseIndex(const BoundCondition& condition) const {
+    bool unique;
+    return indexFor(condition, unique) != nullptr;
 }
 
-vector<Record> Table::selectWhere(const Condition& condition) const {
-    vector<Record> result;
-    for (const auto& record : rows) {
-        if (evaluateCondition(record, condition)) {
-            result.push_back(record);
+bool Table::indexLookup(const BoundCondition& condition, vector<RecordID>& rids) const {
+    bool unique;
+    const BPlusTree* tree = indexFor(condition, unique);
+    if (!tree) {
+        return false;
+    }
+
+    string key = indexKey(condition.constant);
+    if (condition.op == BoundCondition::Op::EQ) {
+        if (unique) {
+            RecordID rid = tree->search(key);
+            if (rid >= 0) {
+                rids.push_back(rid);
+            }
+        } else {
+            // Every duplicate is the key plus an 8-byte record id
+            tree->scanFrom(key, [&](const string& entry, RecordID rid) {
+                if (entry.compare(0, key.size(), key) != 0) return false;
+                rids.push_back(rid);
+                return true;
+            });
         }
+        return true;
     }
-    return result;
+
+    // Both bounds are inclusive; the record id suffix sorts after the key
+    string low, high = key + string(8, '\xff');
+    bool bounded;
+    switch (condition.op) {
+        case BoundCondition::Op::GT:
+        case BoundCondition::Op::GE:
+            low = key;
+            bounded = false;
+            break;
+        case BoundCondition::Op::LT:
+        case BoundCondition::Op::LE:
+            bounded = true;
+            break;
+        default:
+            return false;
+    }
+    tree->scanFrom(low, [&](const string& entry, RecordID rid) {
+        if (bounded && entry > high) return false;
+        rids.push_back(rid);
+        return true;
+    });
+    return true;
 }
 
-vector<Record> Table::selectAll() const {
-    return rows;
+bool Table::canUseIndex(const BoundExpression& predicate) const {
+    BoundCondition condition;
+    bool conjunction;
+    vector<const BoundExpression*> terms;
+    if (predicate.asCondition(condition)) {
+        return canUseIndex(condition);
+    }
+    if (!predicate.asJunction(conjunction, terms)) {
+        return false;
+    }
+    for (const BoundExpression* term : terms) {
+        if (canUseIndex(*term) == conjunction) {
+            return conjunction;
+        }
+    }
+    return !conjunction;
 }
 
-vector<Record> Table::selectOrderBy(const string& columnName, bool descending) const {
-    int colIndex = getColumnIndex(columnName);
-    if (colIndex < 0) return rows;
+// Once an AND is down to this many candidates, rechecking the rows costs
+// less than another index lookup
+static const size_t FEW_CANDIDATES = 32;
 
-    AVLTree<string> avlTree;
-    vector<Record> result;
+bool Table::indexCandidates(const BoundExpression& predicate, RecordBitmap& candidates) const {
+    BoundCondition condition;
+    bool conjunction;
+    vector<const BoundExpression*> terms;
+    if (predicate.asCondition(condition)) {
+        vector<RecordID> rids;
+        if (!indexLookup(condition, rids)) {
+            return false;
+        }
+        candidates.add(rids);
+        return true;
+    }
+    if (!predicate.asJunction(conjunction, terms) || !canUseIndex(predicate)) {
+        return false;
+    }
 
-    // Insert row indices keyed by the column value. If multiple rows share same key,
-    // the AVL implementation should handle duplicate keys (e.g., store a list).
-    for (size_t i = 0; i < rows.size(); ++i) {
-        avlTree.insert(rows[i].getValue(colIndex), to_string(static_cast<int>(i)));
+    // Terms come most selective first
+    bool found = false;
+    for (const BoundExpression* term : terms) {
+        RecordBitmap part;
+        if (!conjunction) {
+            indexCandidates(*term, part);
+            candidates.unionWith(part);
+        } else if (canUseIndex(*term) && indexCandidates(*term, part)) {
+            if (found) candidates.intersectWith(part);
+            else candidates = move(part);
+            found = true;
+            if (candidates.count() <= FEW_CANDIDATES) break;
+        }
     }
+    return true;
+}
 
-    auto sortedIndices = avlTree.getInOrder();
-    for (const auto& indexStr : sortedIndices) {
-        try {
-            int idx = stoi(indexStr);
-            if (idx >= 0 && static_cast<size_t>(idx) < rows.size()) {
-                result.push_back(rows[idx]);
+bool Table::indexLookup(const BoundExpression& predicate, vector<RecordID>& rids) const {
+    // A single condition keeps the index's order
+    BoundCondition condition;
+    if (predicate.asCondition(condition)) {
+        return indexLookup(condition, rids);
+    }
+    RecordBitmap candidates;
+    if (!indexCandidates(predicate, candidates)) {
+        return false;
+    }
+    candidates.toVector(rids);
+    return true;
+}
+
+vector<pair<RecordID, Record>> Table::findWhere(const BoundExpression& predicate, size_t limit) const {
+    vector<pair<RecordID, Record>> matches;
+    if (limit == 0) {
+        return matches;
+    }
+    vector<RecordID> candidates;
+    if (indexLookup(predicate, candidates)) {
+        Record record;
+        for (RecordID rid : candidates) {
+            if (readRow(rid, record) && predicate.test(record)) {
+                matches.push_back({rid, record});
+                if (matches.size() == limit) break;
             }
-        } catch (...) {
-            // ignore parse errors
         }
+        return matches;
     }
 
-    if (descending) {
-        reverse(result.begin(), result.end());
+    scanWhile([&](RecordID rid, const Record& record) {
+        if (predicate.test(record)) {
+            matches.push_back({rid, record});
+        }
+        return matches.size() < limit;
+    });
+    return matches;
+}
+
+// True if writing these rows would leave two rows with the same primary key,
+// or a value too long to index
+bool Table::violatesPrimaryKey(const vector<pair<RecordID, Record>>& updated) const {
+    unordered_map<string, RecordID> newKeys;
+    unordered_set<RecordID> updatedRids;
+    for (const auto& row : updated) {
+        if (!indexKeysFit(row.second)) {
+            return true;
+        }
+        if (primaryIndex && !newKeys.insert({primaryKeyOf(row.second), row.first}).second) {
+            return true;
+        }
+        updatedRids.insert(row.first);
+    }
+    // Rows outside the update keep their keys
+    for (const auto& entry : newKeys) {
+        RecordID owner = primaryIndex->search(entry.first);
+        if (owner >= 0 && updatedRids.count(owner) == 0) {
+            return true;
+        }
     }
+    return false;
+}
 
-    return result;
+bool Table::rowFits(const Record& record) const {
+    return indexKeysFit(record) && record.serialize().size() <= static_cast<size_t>(Page::MAX_RECORD_SIZE);
 }
 
-vector<Record> Table::selectGroupBy(const string& columnName) const {
-    int colIndex = getColumnIndex(columnName);
-    if (colIndex < 0) return {};
+RecordID Table::insertRow(const Record& record, uint64_t lsn) {
+    if (!indexKeysFit(record) || (primaryIndex && primaryIndex->exists(primaryKeyOf(record)))) {
+        return -1;
+    }
 
-    AVLTree<string> groupTree;
-    vector<Record> result;
+    RecordID rid = heap->insertRecord(record.serialize(), lsn);
+    if (rid >= 0) {
+        indexRow(rid, record);
+    }
+    return rid;
+}
 
-    // Build tree of unique keys
-    for (const auto& record : rows) {
-        string key = record.getValue(colIndex);
-        groupTree.insert(key, key); // value not important here - we just want keys unique and sorted
+bool Table::insertRows(const vector<Record>& records, uint64_t lsn, vector<RecordID>& rids) {
+    vector<string> rows;
+    unordered_set<string> keys;
+    for (const auto& record : records) {
+        rows.push_back(record.serialize());
+        if (rows.back().size() > static_cast<size_t>(Page::MAX_RECORD_SIZE) || !indexKeysFit(record)) {
+            return false;
+        }
+        if (primaryIndex) {
+            string key = primaryKeyOf(record);
+            if (!keys.insert(key).second || primaryIndex->exists(key)) {
+                return false;
+            }
+        }
     }
 
-    auto uniqueKeys = groupTree.getInOrder();
-    for (const auto& key : uniqueKeys) {
-        Record groupRecord;
-        groupRecord.addValue(key);
-        int count = 0;
-        for (const auto& record : rows) {
-            if (record.getValue(colIndex) == key) count++;
+    size_t first = rids.size();
+    for (size_t i = 0; i < records.size(); ++i) {
+        RecordID rid = heap->insertRecord(rows[i], lsn);
+        if (rid < 0) {
+            while (rids.size() > first) {
+                deleteRow(rids.back(), lsn);
+                rids.pop_back();
+            }
+            return false;
         }
-        groupRecord.addValue(to_string(count));
-        result.push_back(groupRecord);
+        indexRow(rid, records[i]);
+        rids.push_back(rid);
     }
+    return true;
+}
 
-    return result;
+bool Table::prepareRow(const Record& record, string& bytes, vector<string>& keys) const {
+    if (!indexKeysFit(record)) {
+        return false;
+    }
+    bytes = record.serialize();
+    keys.clear();
+    if (primaryIndex) {
+        keys.push_back(primaryKeyOf(record));
+    }
+    for (const auto& index : secondaryIndexes) {
+        keys.push_back(indexKey(columnValue(record, index.column)));
+    }
+    return bytes.size() <= static_cast<size_t>(Page::MAX_RECORD_SIZE);
 }
 
-bool Table::saveToFile(const string& filename) const {
-    vector<string> lines;
-    lines.push_back(Utils::join(columns, ","));
-    for (const auto& record : rows) {
-        lines.push_back(record.toCSV());
+// keys holds the prepared keys of each row in turn
+bool Table::appendRows(const vector<string>& rows, const vector<string>& keys, uint64_t lsn,
+                       vector<RecordID>& rids) {
+    size_t indexCount = secondaryIndexes.size() + (primaryIndex ? 1 : 0);
+    if (bulkKeys.empty()) {
+        // The rows reach disk before their keys do
+        bulkKeys.resize(indexCount);
+        if (primaryIndex) {
+            primaryIndex->markModified();
+        }
+        for (auto& index : secondaryIndexes) {
+            index.tree->markModified();
+        }
+    }
+
+    size_t first = rids.size();
+    bool ok = heap->appendRecords(rows, lsn, rids);
+    for (size_t row = 0; first + row < rids.size(); ++row) {
+        RecordID rid = rids[first + row];
+        for (size_t i = 0; i < indexCount; ++i) {
+            string key = keys[row * indexCount + i];
+            if (i > 0 || !primaryIndex) {
+                appendRecordID(key, rid);
+            }
+            bulkKeys[i].push_back({move(key), rid});
+        }
     }
-    return FileManager::writeLines(filename, lines);
+    return ok;
 }
 
-Table* Table::loadFromFile(const string& filename) {
-    if (!FileManager::fileExists(filename)) {
-        return nullptr;
+bool Table::finishBulkLoad() {
+    for (auto& keys : bulkKeys) {
+        sort(keys.begin(), keys.end());
+    }
+
+    if (primaryIndex && !bulkKeys.empty() && !bulkKeys[0].empty()) {
+        // Adjacent once sorted, and met in order by a walk of the index
+        const auto& keys = bulkKeys[0];
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (keys[i].first == keys[i - 1].first) {
+                bulkKeys.clear();
+                return false;
+            }
+        }
+        size_t next = 0;
+        bool repeated = false;
+        primaryIndex->scanFrom(keys[0].first, [&](const string& key, RecordID) {
+            while (next < keys.size() && keys[next].first < key) {
+                next++;
+            }
+            repeated = next < keys.size() && keys[next].first == key;
+            return !repeated && next < keys.size();
+        });
+        if (repeated) {
+            bulkKeys.clear();
+            return false;
+        }
+    }
+
+    size_t i = 0;
+    if (primaryIndex && !bulkKeys.empty()) {
+        addSortedKeys(*primaryIndex, bulkKeys[i++]);
+    }
+    for (auto& index : secondaryIndexes) {
+        if (i >= bulkKeys.size()) break;
+        addSortedKeys(*index.tree, bulkKeys[i++]);
+    }
+    bulkKeys.clear();
+    return true;
+}
+
+// New keys, sorted, go into the index one at a time, unless it holds fewer
+// keys than they are: then it is built again from both
+void Table::addSortedKeys(BPlusTree& tree, vector<pair<string, RecordID>>& keys) {
+    vector<pair<string, RecordID>> merged;
+    bool small = true;
+    tree.scanFrom("", [&](const string& key, RecordID rid) {
+        small = merged.size() < keys.size();
+        if (small) {
+            merged.push_back({key, rid});
+        }
+        return small;
+    });
+    if (small) {
+        size_t existing = merged.size();
+        merged.insert(merged.end(), make_move_iterator(keys.begin()), make_move_iterator(keys.end()));
+        inplace_merge(merged.begin(), merged.begin() + existing, merged.end());
+        if (tree.bulkLoad(merged)) {
+            return;
+        }
+        keys.assign(make_move_iterator(merged.begin() + existing), make_move_iterator(merged.end()));
+    }
+    for (const auto& entry : keys) {
+        tree.insert(entry.first, entry.second);
+    }
+}
+
+void Table::abortBulkLoad(const vector<RecordID>& rids, uint64_t lsn) {
+    for (RecordID rid : rids) {
+        heap->deleteRecord(rid, lsn);
+    }
+    bulkKeys.clear();
+}
+
+RecordID Table::updateRow(RecordID rid, const Record& record, uint64_t lsn) {
+    bool indexed = primaryIndex || !secondaryIndexes.empty();
+    Record old;
+    if (indexed && (!readRow(rid, old) || !indexKeysFit(record))) {
+        return -1;
+    }
+
+    RecordID newRid = heap->updateRecord(rid, record.serialize(), lsn);
+    if (newRid < 0 || !indexed) {
+        return newRid;
+    }
+
+    // Only entries whose key or record id changed are touched
+    bool moved = newRid != rid;
+    if (primaryIndex && (moved || primaryKeyOf(old) != primaryKeyOf(record))) {
+        string oldKey = primaryKeyOf(old);
+        if (primaryIndex->search(oldKey) == rid) {
+            primaryIndex->remove(oldKey);
+        }
+        string newKey = primaryKeyOf(record);
+        primaryIndex->remove(newKey);
+        primaryIndex->insert(newKey, newRid);
+    }
+    for (auto& index : secondaryIndexes) {
+        const Value& oldValue = columnValue(old, index.column);
+        const Value& newValue = columnValue(record, index.column);
+        if (moved || indexKey(oldValue) != indexKey(newValue)) {
+            index.tree->remove(secondaryKey(oldValue, rid));
+            index.tree->insert(secondaryKey(newValue, newRid), newRid);
+        }
+    }
+    return newRid;
+}
+
+bool Table::deleteRow(RecordID rid, uint64_t lsn) {
+    Record old;
+    if ((primaryIndex || !secondaryIndexes.empty()) && readRow(rid, old)) {
+        unindexRow(rid, old);
+    }
+    return heap->deleteRecord(rid, lsn);
+}
+
+vector<pair<RecordID, Record>> Table::deleteWhere(const BoundExpression& predicate, uint64_t lsn) {
+    vector<pair<RecordID, Record>> deleted;
+    for (auto& match : findWhere(predicate)) {
+        if (deleteRow(match.first, lsn)) {
+            deleted.push_back(move(match));
+        }
     }
+    return deleted;
+}
+
+void Table::redoInsert(RecordID rid, const Record& record, uint64_t lsn) {
+    indexesStale = true;
+    heap->redoInsert(rid, record.serialize(), lsn);
+}
+
+void Table::redoUpdate(RecordID rid, RecordID movedTo, const Record& record, uint64_t lsn) {
+    indexesStale = true;
+    if (movedTo == rid) {
+        heap->redoUpdate(rid, record.serialize(), lsn);
+    } else {
+        heap->redoDelete(rid, lsn);
+        heap->redoInsert(movedTo, record.serialize(), lsn);
+    }
+}
+
+void Table::redoDelete(RecordID rid, uint64_t lsn) {
+    indexesStale = true;
+    heap->redoDelete(rid, lsn);
+}
+
+void Table::undoUpdate(RecordID rid, RecordID movedTo, const Record& old, uint64_t lsn) {
+    Record current;
+    if ((primaryIndex || !secondaryIndexes.empty()) && readRow(movedTo, current)) {
+        unindexRow(movedTo, current);
+    }
+    if (movedTo != rid) {
+        heap->deleteRecord(movedTo, lsn);
+        heap->redoInsert(rid, old.serialize(), lsn);
+    } else {
+        heap->redoUpdate(rid, old.serialize(), lsn);
+    }
+    indexRow(rid, old);
+}
+
+void Table::undoDelete(RecordID rid, const Record& old, uint64_t lsn) {
+    heap->redoInsert(rid, old.serialize(), lsn);
+    indexRow(rid, old);
+}
+
+// One pass over the heap gathers the keys of every index; each index is
+// then built bottom-up from its keys in order
+void Table::rebuildIndexes() {
+    vector<vector<pair<string, RecordID>>> keys(secondaryIndexes.size() + 1);
+    scan([&](RecordID rid, const Record& record) {
+        if (primaryIndex) {
+            keys[0].push_back({primaryKeyOf(record), rid});
+        }
+        for (size_t i = 0; i < secondaryIndexes.size(); ++i) {
+            keys[i + 1].push_back({secondaryKey(columnValue(record, secondaryIndexes[i].column), rid), rid});
+        }
+    });
+
+    if (primaryIndex) {
+        // Of rows sharing a key the one scanned last keeps it, as when the
+        // rows were indexed one at a time
+        auto& primary = keys[0];
+        stable_sort(primary.begin(), primary.end(),
+                    [](const pair<string, RecordID>& a, const pair<string, RecordID>& b) { return a.first < b.first; });
+        size_t kept = 0;
+        for (size_t i = 0; i < primary.size(); ++i) {
+            if (i + 1 < primary.size() && primary[i + 1].first == primary[i].first) {
+                continue;
+            }
+            if (kept != i) {
+                primary[kept] = move(primary[i]);
+            }
+            kept++;
+        }
+        primary.resize(kept);
+    }
+    for (size_t i = 1; i < keys.size(); ++i) {
+        sort(keys[i].begin(), keys[i].end());
+    }
+
+    // A key too long for a page leaves the bulk load to the row-at-a-time
+    // inserts, which pass over it
+    for (size_t i = 0; i < keys.size(); ++i) {
+        BPlusTree* tree = i == 0 ? primaryIndex.get() : secondaryIndexes[i - 1].tree.get();
+        if (tree && !tree->bulkLoad(keys[i])) {
+            tree->clear();
+            for (const auto& entry : keys[i]) {
+                tree->insert(entry.first, entry.second);
+            }
+        }
+    }
+    indexesStale = false;
+}
 
+void Table::recoverIndexes() {
+    if (indexesStale) {
+        rebuildIndexes();
+    }
+}
+
+bool Table::flushIndexes() {
+    bool ok = !primaryIndex || primaryIndex->flush();
+    for (auto& index : secondaryIndexes) {
+        ok = index.tree->flush() && ok;
+    }
+    return ok;
+}
+
+void Table::markIndexesModified() {
+    if (primaryIndex) {
+        primaryIndex->markModified();
+    }
+    for (auto& index : secondaryIndexes) {
+        index.tree->markModified();
+    }
+}
+
+vector<string> Table::getIndexFiles() const {
+    vector<string> files;
+    if (primaryIndex) {
+        files.push_back(primaryIndex->getFileName());
+    }
+    for (const auto& index : secondaryIndexes) {
+        files.push_back(index.tree->getFileName());
+    }
+    return files;
+}
+
+uint64_t Table::getCreateLSN() const {
+    return createLSN;
+}
+
+void Table::setCreateLSN(uint64_t lsn) {
+    createLSN = lsn;
+    heap->setHeader(serializeHeader());
+}
+
+vector<pair<int, vector<char>>> Table::takeDirtyPages(bool all) {
+    return heap->takeDirtyPages(all);
+}
+
+bool Table::headerFits() const {
+    return serializeHeader().size() <= static_cast<size_t>(PageManager::MAX_HEADER_SIZE);
+}
+
+// Header page: create LSN, column names, primary key column, the
+// secondary index definitions and the column types
+string Table::serializeHeader() const {
+    string out;
+    ByteWriter writer(out);
+    writer.put<uint64_t>(createLSN);
+    writer.put<uint32_t>(static_cast<uint32_t>(columns.size()));
+    for (const auto& column : columns) {
+        writer.putString(column);
+    }
+    writer.putString(primaryKeyColumn);
+    writer.put<uint32_t>(static_cast<uint32_t>(secondaryIndexes.size()));
+    for (const auto& index : secondaryIndexes) {
+        writer.putString(index.name);
+        writer.putString(index.column);
+    }
+    for (ColumnType type : columnTypes) {
+        writer.put<uint8_t>(static_cast<uint8_t>(type));
+    }
+    return out;
+}
+
+bool Table::deserializeHeader(const string& data) {
+    ByteReader reader(data);
+    createLSN = reader.get<uint64_t>();
+    uint32_t count = reader.get<uint32_t>();
+    columns.clear();
+    for (uint32_t i = 0; i < count && reader.ok; ++i) {
+        columns.push_back(reader.getString());
+    }
+    primaryKeyColumn = reader.getString();
+    secondaryIndexes.clear();
+    uint32_t indexCount = reader.atEnd() ? 0 : reader.get<uint32_t>();
+    for (uint32_t i = 0; i < indexCount && reader.ok; ++i) {
+        SecondaryIndex index;
+        index.name = reader.getString();
+        index.column = reader.getString();
+        secondaryIndexes.push_back(move(index));
+    }
+    // Tables written before columns had types hold only TEXT. Their index
+    // keys used another encoding, so the indexes are rebuilt.
+    columnTypes.assign(columns.size(), ColumnType::TEXT);
+    if (reader.atEnd()) {
+        indexesStale = true;
+    }
+    for (size_t i = 0; i < columns.size() && !reader.atEnd(); ++i) {
+        columnTypes[i] = static_cast<ColumnType>(reader.get<uint8_t>());
+    }
+    return reader.ok;
+}
+
+bool Table::writeSnapshot(const vector<pair<int, vector<char>>>& snapshot) {
+    return heap->writeSnapshot(snapshot);
+}
+
+void Table::setLogFlusher(function<bool(uint64_t)> flushLog) {
+    heap->setLogFlusher(flushLog);
+}
+
+bool Table::saveToFile() {
+    return heap->setHeader(serializeHeader()) && heap->savePages() && flushIndexes();
+}
+
+bool Table::moveToFile(const string& filename) {
+    if (!heap->moveToFile(filename)) {
+        return false;
+    }
+    bool ok = !primaryIndex || primaryIndex->moveToFile(indexFileFor(filename, "pk"));
+    for (auto& index : secondaryIndexes) {
+        ok = index.tree->moveToFile(indexFileFor(filename, index.name)) && ok;
+    }
+    return ok;
+}
+
+// Tables written before the heap format were CSV: an optional "#lsn N"
+// line, the column names, then one line per row. Convert them in place.
+Table* Table::importLegacyFile(const string& filename, const string& name,
+                              shared_ptr<BufferPool> pool) {
     vector<string> lines = FileManager::readLines(filename);
-    if (lines.empty()) {
+    size_t header = (!lines.empty() && lines[0].compare(0, 5, "#lsn ") == 0) ? 1 : 0;
+    if (lines.size() <= header) {
+        return nullptr;
+    }
+
+    vector<string> cols = Utils::split(lines[header], ',');
+    vector<vector<string>> rows;
+    for (size_t i = header + 1; i < lines.size(); ++i) {
+        if (!lines[i].empty()) {
+            rows.push_back(Utils::split(lines[i], ','));
+            rows.back().resize(cols.size());
+        }
+    }
+
+    // A column is INT or DOUBLE when every value in it parses as one
+    vector<ColumnType> types(cols.size(), ColumnType::INT);
+    for (size_t c = 0; c < cols.size(); ++c) {
+        Value value;
+        for (const auto& row : rows) {
+            if (types[c] == ColumnType::INT && !Value::parse(row[c], ColumnType::INT, value)) {
+                types[c] = ColumnType::DOUBLE;
+            }
+            if (types[c] == ColumnType::DOUBLE && !Value::parse(row[c], ColumnType::DOUBLE, value)) {
+                types[c] = ColumnType::TEXT;
+                break;
+            }
+        }
+        if (rows.empty()) {
+            types[c] = ColumnType::TEXT;
+        }
+    }
+
+    Table* table = new Table(name, cols, types, filename + ".rebuild", pool);
+    Record record;
+    for (const auto& row : rows) {
+        if (table->makeRecord(row, record)) {
+            table->insertRow(record);
+        }
+    }
+    if (!table->saveToFile() || !table->moveToFile(filename)) {
+        delete table;
+        return nullptr;
+    }
+    return table;
+}
+
+Table* Table::loadFromFile(const string& filename, shared_ptr<BufferPool> pool) {
+    if (!FileManager::fileExists(filename)) {
         return nullptr;
     }
 
@@ -204,15 +1005,52 @@ Table* Table::loadFromFile(const string& filename) {
         tableNameFromFile = tableNameFromFile.substr(0, dotPos);
     }
 
-    vector<string> cols = Utils::split(lines[0], ',');
-    Table* table = new Table(tableNameFromFile, cols);
+    unique_ptr<PageManager> heap(new PageManager(filename, pool));
+    if (!heap->loadPages()) {
+        heap.reset();
+        return importLegacyFile(filename, tableNameFromFile, pool);
+    }
 
-    for (size_t i = 1; i < lines.size(); ++i) {
-        if (!lines[i].empty()) {
-            Record record = Record::fromCSV(lines[i]);
-            table->insertRow(record);
+    Table* table = new Table(tableNameFromFile, pool, move(heap));
+    if (!table->deserializeHeader(table->heap->getHeader())) {
+        delete table;
+        return nullptr;
+    }
+
+    // An index that is missing or was not cleanly closed is rebuilt once
+    // recovery has brought the heap up to date
+    if (!table->primaryKeyColumn.empty()) {
+        table->primaryIndex.reset(new BPlusTree(indexFileFor(filename, "pk"), pool));
+        if (!table->primaryIndex->open() || !table->primaryIndex->isClean()) {
+            table->primaryIndex->create(table->primaryIndex->getFanout(), table->primaryIndex->getFillFactor());
+            table->indexesStale = true;
+        }
+    }
+    for (auto& index : table->secondaryIndexes) {
+        index.tree.reset(new BPlusTree(indexFileFor(filename, index.name), pool));
+        if (!index.tree->open() || !index.tree->isClean()) {
+            index.tree->create(index.tree->getFanout(), index.tree->getFillFactor());
+            table->indexesStale = true;
         }
     }
 
     return table;
 }
+
+// A rebuild writes t.tbl.rebuild and its indexes beside the table, then
+// renames them over it; whatever is left under those names is unused
+void Table::removeLeftovers(const string& directory) {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    const string marker = ".tbl.rebuild";
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string filename = entry->d_name;
+        if (filename.find(marker) != string::npos) {
+            unlink((directory + "/" + filename).c_str());
+        }
+    }
+    closedir(dir);
+}
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threadCount) : queued(0), stopping(false) {
+    threadCount = max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.emplace_back(new Queue());
+    }
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : threads) {
+        worker.join();
+    }
+}
+
+// Own queue from the back, then the other queues from the front
+bool ThreadPool::runOne(size_t self) {
+    function<void(size_t)> task;
+    for (size_t i = 0; i < queues.size() && !task; ++i) {
+        Queue& queue = *queues[(self + i) % queues.size()];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    queued--;
+    task(self);
+    return true;
+}
+
+void ThreadPool::work(size_t self) {
+    while (true) {
+        if (runOne(self)) {
+            continue;
+        }
+        unique_lock<mutex> lock(sleepLock);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::run(size_t count, const function<void(size_t, size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (queues.size() == 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i, 0);
+        }
+        return;
+    }
+
+    size_t left = count;
+    mutex doneLock;
+    condition_variable done;
+    // Dealt round robin, so each thread starts on tasks of its own
+    for (size_t i = 0; i < count; ++i) {
+        Queue& queue = *queues[i % queues.size()];
+        lock_guard<mutex> lock(queue.lock);
+        queue.tasks.push_back([&, i](size_t thread) {
+            task(i, thread);
+            lock_guard<mutex> finished(doneLock);
+            if (--left == 0) {
+                done.notify_one();
+            }
+        });
+        queued++;
+    }
+    {
+        lock_guard<mutex> lock(sleepLock);
+    }
+    wake.notify_all();
+
+    while (runOne(0)) {
+    }
+    unique_lock<mutex> lock(doneLock);
+    done.wait(lock, [&left] { return left == 0; });
+}
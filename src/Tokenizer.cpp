@@ -7,7 +7,7 @@ using namespace std;
 
 
 Tokenizer::Tokenizer(const string& sql)
-    : input(sql), position(0) {}
+    : input(sql), position(0), parameters(0) {}
 
 bool Tokenizer::isWhitespace(char c) {
     return c == ' ' || c == '\t' || c == '\n' || c == '\r';
@@ -42,6 +42,9 @@ Token Tokenizer::readString() {
 
 Token Tokenizer::readNumber() {
     string result;
+    if (input[position] == '-') {
+        result += input[position++];
+    }
     while (position < input.length() && (isDigit(input[position]) || input[position]=='.')) {
         result += input[position];
         position++;
@@ -54,6 +57,11 @@ Token Tokenizer::readIdentifierOrKeyword() {
     while (position < input.length() && (isLetter(input[position]) || isDigit(input[position]))) {
         result += input[position];
         position++;
+        // A column qualified by its table, as in users.id, is one identifier
+        if (position + 1 < input.length() && input[position] == '.' && isLetter(input[position + 1]) &&
+            result.find('.') == string::npos) {
+            result += input[position++];
+        }
     }
     string lower = Utils::toLower(result);
     if (isKeyword(lower)) {
@@ -78,7 +86,14 @@ vector<Token> Tokenizer::tokenize() {
             continue;
         }
 
-        if (isDigit(current)) {
+        // A minus sign directly before a digit starts a negative number,
+        // unless it follows an operand and so subtracts
+        bool afterOperand = !tokens.empty() &&
+                            (tokens.back().type == TokenType::IDENTIFIER || tokens.back().type == TokenType::NUMBER ||
+                             tokens.back().type == TokenType::STRING || tokens.back().type == TokenType::PARAMETER ||
+                             tokens.back().value == ")");
+        if (isDigit(current) ||
+            (current == '-' && !afterOperand && position + 1 < input.length() && isDigit(input[position + 1]))) {
             tokens.push_back(readNumber());
             continue;
         }
@@ -101,12 +116,24 @@ vector<Token> Tokenizer::tokenize() {
             continue;
         }
 
+        if (current == '+' || current == '-' || current == '/' || current == '%') {
+            tokens.push_back(Token(TokenType::OPERATOR, string(1, current)));
+            position++;
+            continue;
+        }
+
         if (current == '(' || current == ')' || current == ',' || current == ';' || current == '*') {
             tokens.push_back(Token(TokenType::PUNCTUATION, string(1, current)));
             position++;
             continue;
         }
 
+        if (current == '?') {
+            tokens.push_back(Token(TokenType::PARAMETER, to_string(parameters++)));
+            position++;
+            continue;
+        }
+
         // unknown char -> skip
         position++;
     }
@@ -115,21 +142,108 @@ vector<Token> Tokenizer::tokenize() {
     return tokens;
 }
 
+// Reads the tokens as tokenize() does, without building them
+bool Tokenizer::normalize(string& key, vector<Token>& literals) {
+    key.clear();
+    literals.clear();
+    size_t word = string::npos;  // where the previous token starts in key, when it is a word
+    bool operand = false;        // the previous token is a literal or ")"
+    bool count = false;          // the previous token is LIMIT or OFFSET
+
+    while (position < input.length()) {
+        char current = input[position];
+
+        if (isWhitespace(current)) {
+            position++;
+            continue;
+        }
+
+        bool literal = current == '"' || current == '\'' || isDigit(current);
+        if (current == '-' && position + 1 < input.length() && isDigit(input[position + 1])) {
+            // Negative unless it follows an operand, a word being one
+            // when it is not a keyword
+            literal = !operand && (word == string::npos || isKeyword(key.substr(word, key.size() - word - 1)));
+        }
+        if (literal) {
+            Token token = isDigit(current) || current == '-' ? readNumber() : readString();
+            if (count) {
+                key += token.value;
+            } else {
+                key += '?';
+                literals.push_back(move(token));
+            }
+            key += ' ';
+            word = string::npos;
+            operand = true;
+            count = false;
+            continue;
+        }
+
+        if (isLetter(current)) {
+            word = key.size();
+            bool qualified = false;
+            while (position < input.length() && (isLetter(input[position]) || isDigit(input[position]))) {
+                key += static_cast<char>(tolower(static_cast<unsigned char>(input[position++])));
+                if (!qualified && position + 1 < input.length() && input[position] == '.' &&
+                    isLetter(input[position + 1])) {
+                    key += input[position++];
+                    qualified = true;
+                }
+            }
+            count = key.compare(word, string::npos, "limit") == 0 || key.compare(word, string::npos, "offset") == 0;
+            key += ' ';
+            operand = false;
+            continue;
+        }
+
+        if (current == '?') {
+            return false;
+        }
+
+        if (isOperator(current)) {
+            key += current;
+            position++;
+            if (position < input.length() && input[position] == '=') {
+                key += input[position++];
+            }
+        } else if (current == '+' || current == '-' || current == '/' || current == '%' || current == '(' ||
+                   current == ')' || current == ',' || current == ';' || current == '*') {
+            key += current;
+            position++;
+        } else {
+            // skipped, as by tokenize()
+            position++;
+            continue;
+        }
+        key += ' ';
+        word = string::npos;
+        operand = current == ')';
+        count = false;
+    }
+    return true;
+}
+
 bool Tokenizer::isKeyword(const string& word) {
     static const vector<string> keywords = {
         // DDL / DML / CONTROL
-        "select", "insert", "create", "delete", "update",
-        "database", "table", "use", "drop", "alter",
+        "select", "insert", "create", "delete", "update", "copy",
+        "database", "table", "index", "on", "use", "drop", "alter", "show",
 
         // clauses / values
         "from", "into", "values", "set", "where",
-        "and", "or", "not",
+        "and", "or", "not", "between", "in", "is", "null",
+
+        // joins
+        "join", "inner", "left", "outer", "as",
 
         // ordering / grouping
-        "order", "by", "group", "desc", "asc",
+        "order", "by", "group", "having", "desc", "asc", "limit", "offset",
 
         // alter helpers
-        "add", "drop", "modify"
+        "add", "drop", "modify",
+
+        // prepared statements
+        "prepare", "execute", "deallocate"
     };
     for (const auto& keyword : keywords) {
         if (word == keyword) return true;
@@ -1,9 +1,13 @@
 #include "Utils.h"
 #include <algorithm>
 #include <cctype>
-#include <sstream>
 using namespace std;
 
+// The characters trim() strips
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
 string Utils::trim(const string& str) {
     size_t start = str.find_first_not_of(" \t\n\r");
     if (start == string::npos) return "";
@@ -20,13 +24,21 @@ string Utils::toLower(const string& str) {
 
 vector<string> Utils::split(const string& str, char delimiter) {
     vector<string> tokens;
-    stringstream ss(str);
-    string token;
-    while (getline(ss, token, delimiter)) {
-        token = trim(token);
-        if (!token.empty()) {
-            tokens.push_back(token);
+    size_t start = 0;
+    while (start <= str.size()) {
+        size_t end = str.find(delimiter, start);
+        if (end == string::npos) {
+            end = str.size();
         }
+        // Trimmed in place rather than through a copy of the field
+        size_t first = start;
+        size_t last = end;
+        while (first < last && isBlank(str[first])) first++;
+        while (last > first && isBlank(str[last - 1])) last--;
+        if (first < last) {
+            tokens.emplace_back(str, first, last - first);
+        }
+        start = end + 1;
     }
     return tokens;
 }
@@ -58,3 +70,24 @@ bool Utils::isValidNumber(const string& str) {
     }
     return true;
 }
+
+uint32_t Utils::crc32(const string& data) {
+    // Built once, safely even when the first calls race on several threads
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char c : data) {
+        crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
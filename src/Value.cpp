@@ -0,0 +1,129 @@
+#include "Value.h"
+#include "Utils.h"
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <cmath>
+using namespace std;
+
+Value Value::fromInt(int64_t value) {
+    Value v;
+    v.type = ColumnType::INT;
+    v.intValue = value;
+    return v;
+}
+
+Value Value::fromDouble(double value) {
+    Value v;
+    v.type = ColumnType::DOUBLE;
+    v.doubleValue = value;
+    return v;
+}
+
+Value Value::fromText(const string& value) {
+    Value v;
+    v.textValue = value;
+    return v;
+}
+
+bool Value::parse(const string& text, ColumnType type, Value& out) {
+    if (type == ColumnType::TEXT) {
+        out = fromText(text);
+        return true;
+    }
+    if (text.empty() || isspace(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+
+    char* end = nullptr;
+    errno = 0;
+    long long integer = strtoll(text.c_str(), &end, 10);
+    if (*end == '\0' && errno == 0) {
+        out = type == ColumnType::INT ? fromInt(integer) : fromDouble(static_cast<double>(integer));
+        return true;
+    }
+
+    errno = 0;
+    double number = strtod(text.c_str(), &end);
+    if (*end != '\0' || errno == ERANGE || std::isnan(number)) {
+        return false;
+    }
+    if (type == ColumnType::DOUBLE) {
+        out = fromDouble(number);
+        return true;
+    }
+    // 5.0 is a valid INT; 5.5 is not
+    if (number != std::floor(number) || std::fabs(number) >= 9.2e18) {
+        return false;
+    }
+    out = fromInt(static_cast<int64_t>(number));
+    return true;
+}
+
+Value Value::fromLiteral(const string& text) {
+    Value value;
+    if (parse(text, ColumnType::INT, value) || parse(text, ColumnType::DOUBLE, value)) {
+        return value;
+    }
+    return fromText(text);
+}
+
+ColumnType Value::parseType(const string& name) {
+    string type = Utils::toLower(name);
+    if (type == "int" || type == "integer" || type == "bigint" || type == "smallint") {
+        return ColumnType::INT;
+    }
+    if (type == "double" || type == "float" || type == "real" ||
+        type == "decimal" || type == "numeric") {
+        return ColumnType::DOUBLE;
+    }
+    return ColumnType::TEXT;
+}
+
+string Value::typeName(ColumnType type) {
+    switch (type) {
+        case ColumnType::INT: return "INT";
+        case ColumnType::DOUBLE: return "DOUBLE";
+        default: return "TEXT";
+    }
+}
+
+Value Value::defaultFor(ColumnType type) {
+    switch (type) {
+        case ColumnType::INT: return fromInt(0);
+        case ColumnType::DOUBLE: return fromDouble(0.0);
+        default: return fromText("");
+    }
+}
+
+string Value::toString() const {
+    switch (type) {
+        case ColumnType::INT:
+            return to_string(intValue);
+        case ColumnType::DOUBLE: {
+            // Shortest form that reads back as the same double
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.15g", doubleValue);
+            if (strtod(buffer, nullptr) != doubleValue) {
+                snprintf(buffer, sizeof(buffer), "%.17g", doubleValue);
+            }
+            return buffer;
+        }
+        default:
+            return textValue;
+    }
+}
+
+int Value::compare(const Value& other) const {
+    if (isNumeric() != other.isNumeric()) {
+        return isNumeric() ? -1 : 1;
+    }
+    if (!isNumeric()) {
+        return textValue.compare(other.textValue) < 0 ? -1 : (textValue == other.textValue ? 0 : 1);
+    }
+    if (type == ColumnType::INT && other.type == ColumnType::INT) {
+        return intValue < other.intValue ? -1 : (intValue > other.intValue ? 1 : 0);
+    }
+    double a = asDouble(), b = other.asDouble();
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
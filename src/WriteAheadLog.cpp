@@ -0,0 +1,249 @@
+#include "WriteAheadLog.h"
+#include "Utils.h"
+#include "ByteBuffer.h"
+#include "FileManager.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+const size_t FRAME_HEADER = 2 * sizeof(uint32_t);  // payload length + crc
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const string& dir, WalSyncMode mode)
+    : directory(dir), fd(-1), segmentNumber(0), nextLSN(1), syncedLSN(0), segmentBytes(0),
+      syncMode(mode), groupCommitSize(64), unsyncedEntries(0) {
+    vector<uint64_t> segments = listSegments();
+    openSegment(segments.empty() ? 1 : segments.back() + 1);
+
+    // Data pages may carry LSNs from entries whose segments are gone
+    string checkpointLSN = Utils::trim(FileManager::readFile(getCheckpointPath()));
+    if (Utils::isValidNumber(checkpointLSN)) {
+        advanceLSN(stoull(checkpointLSN));
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (fd >= 0) {
+        if (syncMode != WalSyncMode::OFF) sync();
+        close(fd);
+    }
+}
+
+string WriteAheadLog::getSegmentPath(uint64_t segment) const {
+    return directory + "/wal." + to_string(segment) + ".log";
+}
+
+string WriteAheadLog::getCheckpointPath() const {
+    return directory + "/wal.checkpoint";
+}
+
+vector<uint64_t> WriteAheadLog::listSegments() const {
+    vector<uint64_t> segments;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) return segments;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string name = entry->d_name;
+        if (name.size() > 8 && name.compare(0, 4, "wal.") == 0 &&
+            name.compare(name.size() - 4, 4, ".log") == 0) {
+            string number = name.substr(4, name.size() - 8);
+            if (Utils::isValidNumber(number)) {
+                segments.push_back(stoull(number));
+            }
+        }
+    }
+    closedir(dir);
+    sort(segments.begin(), segments.end());
+    return segments;
+}
+
+bool WriteAheadLog::openSegment(uint64_t segment) {
+    fd = open(getSegmentPath(segment).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    segmentNumber = segment;
+    segmentBytes = 0;
+    unsyncedEntries = 0;
+    return fd >= 0;
+}
+
+string WriteAheadLog::serialize(const WalEntry& entry) {
+    string out;
+    ByteWriter writer(out);
+    writer.put<uint64_t>(entry.lsn);
+    writer.put<uint8_t>(static_cast<uint8_t>(entry.type));
+    writer.putString(entry.tableName);
+    writer.put<uint32_t>(static_cast<uint32_t>(entry.recordIds.size()));
+    for (size_t i = 0; i < entry.recordIds.size(); ++i) {
+        writer.put<int64_t>(entry.recordIds[i]);
+        if (entry.type == WalEntry::Type::UPDATE) {
+            writer.put<int64_t>(entry.movedTo[i]);
+        }
+        if (entry.type != WalEntry::Type::DELETE) {
+            const auto& values = entry.records[i];
+            writer.put<uint32_t>(static_cast<uint32_t>(values.size()));
+            for (const auto& value : values) {
+                writer.putString(value);
+            }
+        }
+    }
+    return out;
+}
+
+bool WriteAheadLog::deserialize(const string& payload, WalEntry& entry) {
+    ByteReader in(payload);
+    entry.lsn = in.get<uint64_t>();
+    entry.type = static_cast<WalEntry::Type>(in.get<uint8_t>());
+    entry.tableName = in.getString();
+    uint32_t count = in.get<uint32_t>();
+    for (uint32_t i = 0; in.ok && i < count; ++i) {
+        entry.recordIds.push_back(in.get<int64_t>());
+        if (entry.type == WalEntry::Type::UPDATE) {
+            entry.movedTo.push_back(in.get<int64_t>());
+        }
+        if (entry.type != WalEntry::Type::DELETE) {
+            vector<string> values(in.get<uint32_t>());
+            for (auto& value : values) {
+                value = in.getString();
+            }
+            entry.records.push_back(values);
+        }
+    }
+    return in.ok && in.atEnd();
+}
+
+bool WriteAheadLog::append(WalEntry& entry) {
+    if (fd < 0) return false;
+
+    entry.lsn = nextLSN++;
+    string payload = serialize(entry);
+
+    string frame;
+    ByteWriter writer(frame);
+    writer.put<uint32_t>(static_cast<uint32_t>(payload.size()));
+    writer.put<uint32_t>(Utils::crc32(payload));
+    frame += payload;
+
+    off_t start = lseek(fd, 0, SEEK_END);
+    size_t written = 0;
+    bool ok = start >= 0;
+    while (ok && written < frame.size()) {
+        ssize_t n = write(fd, frame.data() + written, frame.size() - written);
+        ok = n >= 0;
+        written += ok ? n : 0;
+    }
+    if (ok && (syncMode == WalSyncMode::ALWAYS ||
+               (syncMode == WalSyncMode::BATCH && ++unsyncedEntries >= groupCommitSize))) {
+        ok = sync();
+    }
+    if (!ok) {
+        // Replay stops at a torn frame, so cut it off, or failing that go
+        // on in a new segment; the LSN is handed out again
+        if (start < 0 || ftruncate(fd, start) != 0) {
+            close(fd);
+            openSegment(segmentNumber + 1);
+        }
+        nextLSN = entry.lsn;
+        return false;
+    }
+    segmentBytes += frame.size();
+    return true;
+}
+
+bool WriteAheadLog::sync() {
+    if (fd < 0 || fdatasync(fd) != 0) {
+        return false;
+    }
+    syncedLSN = nextLSN - 1;
+    unsyncedEntries = 0;
+    return true;
+}
+
+bool WriteAheadLog::syncTo(uint64_t lsn) {
+    // A page stamped for a change not yet appended cannot go out before it
+    if (lsn >= nextLSN) {
+        return false;
+    }
+    return lsn <= syncedLSN || sync();
+}
+
+void WriteAheadLog::replay(const function<void(const WalEntry&)>& apply) const {
+    for (uint64_t segment : listSegments()) {
+        ifstream file(getSegmentPath(segment), ios::binary);
+        string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        // Stop at the first torn or corrupt frame; later segments were
+        // started after a restart and are still valid.
+        size_t pos = 0;
+        while (pos + FRAME_HEADER <= data.size()) {
+            uint32_t len, crc;
+            memcpy(&len, data.data() + pos, sizeof(len));
+            memcpy(&crc, data.data() + pos + sizeof(len), sizeof(crc));
+            if (pos + FRAME_HEADER + len > data.size()) break;
+
+            string payload = data.substr(pos + FRAME_HEADER, len);
+            WalEntry entry;
+            if (Utils::crc32(payload) != crc || !deserialize(payload, entry)) break;
+
+            apply(entry);
+            pos += FRAME_HEADER + len;
+        }
+    }
+}
+
+uint64_t WriteAheadLog::rotate() {
+    uint64_t closed = segmentNumber;
+    if (fd >= 0) {
+        if (!sync()) {
+            return 0;
+        }
+        close(fd);
+    }
+    openSegment(closed + 1);
+    return closed;
+}
+
+void WriteAheadLog::finishCheckpoint(uint64_t segment, uint64_t lsn) {
+    if (!FileManager::writeLinesAtomic(getCheckpointPath(), {to_string(lsn)})) {
+        return;
+    }
+    for (uint64_t s : listSegments()) {
+        if (s <= segment) {
+            unlink(getSegmentPath(s).c_str());
+        }
+    }
+}
+
+uint64_t WriteAheadLog::getLastLSN() const {
+    return nextLSN - 1;
+}
+
+void WriteAheadLog::advanceLSN(uint64_t lsn) {
+    if (lsn >= nextLSN) {
+        nextLSN = lsn + 1;
+    }
+}
+
+uint64_t WriteAheadLog::getNextLSN() const {
+    return nextLSN;
+}
+
+size_t WriteAheadLog::getSegmentBytes() const {
+    return segmentBytes;
+}
+
+WalSyncMode WriteAheadLog::getSyncMode() const {
+    return syncMode;
+}
+
+void WriteAheadLog::setSyncMode(WalSyncMode mode) {
+    syncMode = mode;
+    if (mode == WalSyncMode::ALWAYS) sync();
+}
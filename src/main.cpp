@@ -27,21 +27,40 @@ void displayWelcome()
     cout << Colors::BOLD << Colors::BRIGHT_MAGENTA << "Database Operations:" << Colors::RESET << "\n";
     cout << "  " << Colors::BRIGHT_GREEN << "CREATE DATABASE" << Colors::RESET << " mydb;\n";
     cout << "  " << Colors::BRIGHT_GREEN << "USE" << Colors::RESET << " mydb;\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "DROP TABLE" << Colors::RESET << " tablename;\n\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "DROP TABLE" << Colors::RESET << " tablename;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " wal_sync = batch;  " << Colors::dim("(always | batch | off)") << "\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " buffer_pool_mb = 64;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " vectorized = on;  " << Colors::dim("(on | off)") << "\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " query_memory_kb = 65536;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " memory_limit_mb = 1024;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " index_fill_factor = 90;  " << Colors::dim("(10 - 100)") << "\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " threads = 8;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " table_cache_size = 256;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SET" << Colors::RESET << " statement_cache_size = 256;  " << Colors::dim("(0 = off)") << "\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SHOW STATS" << Colors::RESET << ";\n\n";
 
     cout << Colors::BOLD << Colors::BRIGHT_MAGENTA << "Table Operations:" << Colors::RESET << "\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "CREATE TABLE" << Colors::RESET << " users (id INT, name TEXT, age INT);\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "INSERT INTO" << Colors::RESET << " users VALUES (1, 'Alice', 25);\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "UPDATE" << Colors::RESET << " users SET age = 26 WHERE id = 1;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "CREATE TABLE" << Colors::RESET << " users (id INT PRIMARY KEY, name TEXT, age INT);\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "INSERT INTO" << Colors::RESET << " users VALUES (1, 'Alice', 25), (2, 'Bob', 31);\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "COPY" << Colors::RESET << " users FROM 'users.csv' WITH HEADER;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "UPDATE" << Colors::RESET << " users SET age = age + 1 WHERE id = 1;\n";
     cout << "  " << Colors::BRIGHT_GREEN << "ALTER TABLE" << Colors::RESET << " users ADD email TEXT;\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "ALTER TABLE" << Colors::RESET << " users DROP email;\n\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "ALTER TABLE" << Colors::RESET << " users DROP email;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "ALTER TABLE" << Colors::RESET << " users MODIFY age DOUBLE;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "CREATE INDEX" << Colors::RESET << " users_age ON users (age);\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "DROP INDEX" << Colors::RESET << " users_age;\n\n";
 
     cout << Colors::BOLD << Colors::BRIGHT_MAGENTA << "Query Operations:" << Colors::RESET << "\n";
     cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users;\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users WHERE age > 25;\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users ORDER BY age DESC;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users WHERE age > 25 AND (name = 'Bob' OR NOT age > 40);\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users WHERE age BETWEEN 20 AND 30;  " << Colors::dim("(also IN (...), IS NULL, + - * / %)") << "\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users ORDER BY age DESC, name LIMIT 10 OFFSET 20;\n";
     cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " * FROM users GROUP BY age;\n";
-    cout << "  " << Colors::BRIGHT_GREEN << "DELETE FROM" << Colors::RESET << " users WHERE id = 1;\n\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " age, COUNT(*), AVG(score) FROM users GROUP BY age HAVING COUNT(*) > 1;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "SELECT" << Colors::RESET << " u.name, o.total FROM users u LEFT JOIN orders o ON u.id = o.user_id;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "DELETE FROM" << Colors::RESET << " users WHERE id = 1;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "PREPARE" << Colors::RESET << " by_age AS SELECT * FROM users WHERE age > ? LIMIT 10;\n";
+    cout << "  " << Colors::BRIGHT_GREEN << "EXECUTE" << Colors::RESET << " by_age(30);  " << Colors::dim("(DEALLOCATE by_age; to drop it)") << "\n\n";
 
     cout << Colors::BOLD << Colors::BRIGHT_MAGENTA << "Shell Commands:" << Colors::RESET << "\n";
     cout << "  " << Colors::BRIGHT_YELLOW << "HELP" << Colors::RESET << "   - Show this guide\n";
@@ -155,8 +174,8 @@ int main()
         }
 
         cout << "\n";
-        string result = db.executeQuery(input);
-        cout << result << "\n\n";
+        db.executeQuery(input, cout);
+        cout << "\n\n";
     }
 
     return 0;